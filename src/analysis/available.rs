@@ -1,26 +1,26 @@
 // AVAILABLE VALUE ANALYSIS
 // ========================
 
-use std::collections::HashMap;
-use std::hash::Hash;
+use std::rc::Rc;
 
-use crate::parser::{LabelString, RegSets};
+use crate::cfg::{BasicBlock, BasicBlocks, Cfg, LabelId, NodeId};
+use crate::parser::RegSets;
 use crate::parser::{ParserNode, Register};
-use crate::passes::{CFGError, GenerationPass};
+use crate::passes::{CFGError, GenerationPass, NoStats, Recorder};
 
-use super::{CustomDifference, CustomIntersection, CustomInto, CustomUnion, CustomUnionFilterMap};
-
-#[derive(Clone, Debug, PartialEq, Eq, Hash)]
+use super::{solve, DataflowProblem, Direction, RegValues, StackValues};
 
 /// A value that is available at some point in the program.
 ///
 /// This is used to determine which values at certain locations (registers, memory)
-/// can be used or guaranteed. These are assigned as the value in a `HashMap`.
+/// can be used or guaranteed. These are kept for every register in `RegValues`
+/// and for every known stack slot in `StackValues`.
 ///
 /// The `Original` variants are used to determine whether a value is the same as
 /// the value at the beginning of the function or graph. This is used to determine
 /// whether a value is the same as the value at the beginning of the function or
 /// graph. This is mostly used for stack pointer manipulation.
+#[derive(Clone, Copy, Debug, PartialEq, Eq, Hash)]
 pub enum AvailableValue {
     /// A known constant value.
     Constant(i32),
@@ -28,14 +28,14 @@ pub enum AvailableValue {
     ///
     /// This is used when loading the address from a label. For example, using
     /// the `la` instruction to load the address of a label into a register.
-    Address(LabelString),
+    Address(LabelId),
     /// The value of a memory location at some offset.
     ///
     /// This is a copy of the actual bit of memory that lives at plus some offset.
     /// Note that this offset is not a scalar offset, but an offset to the memory
     /// address. Think of it as the offset in the `lw` instruction. For example,
     /// `lw x10, offset(label)` would be represented as `Memory(label, offset)`.
-    Memory(LabelString, i32),
+    Memory(LabelId, i32),
     /// The value of a register plus some scalar offset.
     ///
     /// This is used when we know the value of a register plus some scalar offset.
@@ -59,41 +59,6 @@ pub enum AvailableValue {
     MemoryAtOriginalRegister(Register, i32), // Actual bit of memory + offset (ex. lw ___), where we are sure it is the same as the original
 }
 
-pub trait AvailableRegisterValues {
-    fn is_original_value(&self, reg: Register) -> bool;
-}
-
-impl AvailableRegisterValues for HashMap<Register, AvailableValue> {
-    fn is_original_value(&self, reg: Register) -> bool {
-        self.get(&reg).map_or(false, |x| match x {
-            AvailableValue::OriginalRegisterWithScalar(reg2, offset) => {
-                &reg == reg2 && offset == &0
-            }
-            _ => false,
-        })
-    }
-}
-
-trait AvailableStackHelpers {
-    /// Returns the offset of the stack pointer if it is known.
-    ///
-    /// This is used to determine the offset of the stack pointer in relation
-    /// to the value it was at the beginning of the function or graph.
-    fn stack_offset(&self) -> Option<i32>;
-}
-
-impl AvailableStackHelpers for HashMap<Register, AvailableValue> {
-    fn stack_offset(&self) -> Option<i32> {
-        if let Some(AvailableValue::OriginalRegisterWithScalar(reg, off)) = self.get(&Register::X2)
-        {
-            if reg == &Register::X2 {
-                return Some(*off);
-            }
-        }
-        None
-    }
-}
-
 /// Performs the available value analysis on the graph.
 ///
 /// This function contains the logic for determining which values are available
@@ -122,80 +87,291 @@ impl AvailableStackHelpers for HashMap<Register, AvailableValue> {
 ///
 pub struct AvailableValuePass;
 impl GenerationPass for AvailableValuePass {
-    fn run(cfg: &mut crate::cfg::Cfg) -> Result<(), Box<CFGError>> {
-        let mut changed = true;
-        while changed {
-            changed = false;
-            for node in cfg.into_iter() {
-                // in[n] = AND out[p] for all p in prev[n]
-                let in_reg_n = node
-                    .prevs()
-                    .clone()
-                    .into_iter()
-                    .map(|x| x.reg_values_out())
-                    .reduce(|acc, x| x.intersection(&acc))
-                    .unwrap_or_default();
-                node.set_reg_values_in(in_reg_n);
-
-                // in_stacks[n] = AND out_stacks[p] for all p in prev[n]
-                let in_stack_n = node
-                    .prevs()
-                    .clone()
-                    .into_iter()
-                    .map(|x| x.stack_values_out())
-                    .reduce(|acc, x| x.intersection(&acc))
-                    .unwrap_or_default();
-                node.set_stack_values_in(in_stack_n);
-
-                // out[n] = gen[n] U (in[n] - kill[n]) U (callee_saved if n is entry)
-                let mut out_reg_n = node
-                    .reg_values_in()
-                    .difference(&node.node().kill_reg_value())
-                    .union(&node.node().gen_reg_value())
-                    .union_if(
-                        &RegSets::callee_saved().into_available(),
-                        node.node().is_any_entry(),
-                    );
+    fn run(cfg: &mut Cfg) -> Result<(), Box<CFGError>> {
+        AvailableValuePass::run_recorded(cfg, &mut NoStats);
+        Ok(())
+    }
+}
 
-                // out_stacks[n] = (gen_stacks[n] if we know the location of the stack pointer) U in_stacks[n]
-                // (There is no kill_stacks[n])
-                let mut out_stack_n = if node.node().is_any_entry() {
-                    HashMap::new()
-                } else {
-                    node.stack_values_in().union_filter_map(
-                        &node.node().gen_stack_value(),
-                        |(off, val)| {
-                            node.reg_values_in()
-                                .stack_offset()
-                                .map(|curr_stack| (curr_stack + off, val.clone()))
+impl AvailableValuePass {
+    /// Run the pass, counting the work of the solver in `recorder`.
+    pub fn run_recorded<R: Recorder>(cfg: &mut Cfg, recorder: &mut R) {
+        let blocks = BasicBlocks::new(cfg);
+        let mut problem = AvailableValues::new(cfg, &blocks);
+        recorder.count(solve(&blocks, &mut problem));
+        problem.materialize(&blocks);
+    }
+}
+
+/// The values going into and out of a basic block.
+#[derive(Clone)]
+struct BlockValues {
+    reg_in: Rc<RegValues>,
+    stack_in: Rc<StackValues>,
+    reg_out: Rc<RegValues>,
+    stack_out: Rc<StackValues>,
+}
+
+/// The available values problem, solved over basic blocks.
+///
+/// Values only have to be met where blocks join, so that is the only place
+/// they are kept while solving. The nodes inside of a block are stepped
+/// through in order, and only nodes that define a register or a stack slot
+/// change anything. Once the values at every block boundary are stable, they
+/// are written to the nodes once by `materialize`, instead of on every visit.
+struct AvailableValues<'a> {
+    cfg: &'a Cfg,
+    values: Vec<BlockValues>,
+    /// Whether the values of a block have been calculated yet.
+    visited: Vec<bool>,
+    /// Shared by every node with nothing known, such as the entries.
+    no_regs: Rc<RegValues>,
+    no_stack: Rc<StackValues>,
+}
+
+/// The values coming out of a node depend on the values going in (for
+/// example, math on known constants), so unlike liveness, a block cannot be
+/// summarised ahead of time. Instead, the nodes of the block are stepped
+/// through in order, and only a change at the tail is passed on to other
+/// blocks.
+impl DataflowProblem for AvailableValues<'_> {
+    const DIRECTION: Direction = Direction::Forward;
+
+    fn transfer(
+        &mut self,
+        blocks: &BasicBlocks,
+        block: &BasicBlock,
+        _affected: &mut Vec<NodeId>,
+    ) -> bool {
+        let id = blocks.block_of(block.head());
+        let prevs = self.cfg.node(block.head()).prevs();
+
+        // The values out of a block only depend on the values going in. If
+        // those would not change, neither would the outs, so there is nothing
+        // to do. This check does not allocate.
+        let reg_in = self.meet_regs(blocks, &prevs);
+        let values = &self.values[id.index()];
+        if self.visited[id.index()]
+            && reg_in == *values.reg_in
+            && is_stack_meet_of(blocks, &self.values, &prevs, &values.stack_in)
+        {
+            return false;
+        }
+        self.visited[id.index()] = true;
+
+        let stack_in = self.meet_stack(blocks, &prevs);
+        // The values going in are most often those out of the first prev
+        let first = prevs.first().map_or(&self.no_regs, |&x| {
+            &self.values[blocks.block_of(x).index()].reg_out
+        });
+        let shared_in = share(reg_in, first);
+        drop(prevs);
+        let mut regs = reg_in;
+        let mut stack = Rc::clone(&stack_in);
+        for node in block.nodes() {
+            self.step(&self.cfg.node(node).node(), &mut regs, &mut stack);
+        }
+
+        let values = &mut self.values[id.index()];
+        values.reg_in = shared_in;
+        values.stack_in = stack_in;
+        let mut changed = false;
+        if regs != *values.reg_out {
+            changed = true;
+            values.reg_out = Rc::new(regs);
+        }
+        if stack != values.stack_out {
+            changed = true;
+            values.stack_out = stack;
+        }
+        changed
+    }
+}
+
+impl<'a> AvailableValues<'a> {
+    fn new(cfg: &'a Cfg, blocks: &BasicBlocks) -> Self {
+        let no_regs = Rc::<RegValues>::default();
+        let no_stack = Rc::<StackValues>::default();
+        // Every block starts out sharing the empty values, instead of
+        // allocating its own
+        let empty = BlockValues {
+            reg_in: Rc::clone(&no_regs),
+            stack_in: Rc::clone(&no_stack),
+            reg_out: Rc::clone(&no_regs),
+            stack_out: Rc::clone(&no_stack),
+        };
+        AvailableValues {
+            cfg,
+            values: (0..blocks.len()).map(|_| empty.clone()).collect(),
+            visited: vec![false; blocks.len()],
+            no_regs,
+            no_stack,
+        }
+    }
+
+    /// in[n] = AND out[p] for all p in prev[n]
+    ///
+    /// Every prev of the head of a block is the tail of another block.
+    /// Registers are met slot by slot into a copy on the stack, so this does
+    /// not allocate.
+    fn meet_regs(&self, blocks: &BasicBlocks, prevs: &[NodeId]) -> RegValues {
+        let out = |x: NodeId| &*self.values[blocks.block_of(x).index()].reg_out;
+        prevs
+            .split_first()
+            .map_or(RegValues::EMPTY, |(&first, rest)| {
+                let mut values = *out(first);
+                for &prev in rest {
+                    values.meet(out(prev));
+                }
+                values
+            })
+    }
+
+    /// in_stacks[n] = AND out_stacks[p] for all p in prev[n]
+    ///
+    /// If every prev agrees with the first, the first is shared.
+    fn meet_stack(&self, blocks: &BasicBlocks, prevs: &[NodeId]) -> Rc<StackValues> {
+        let out = |x: NodeId| &self.values[blocks.block_of(x).index()].stack_out;
+        let Some((&first, rest)) = prevs.split_first() else {
+            return Rc::clone(&self.no_stack);
+        };
+        let first = out(first);
+        if rest.iter().all(|&x| Rc::ptr_eq(first, out(x))) {
+            return Rc::clone(first);
+        }
+        let mut values = (**first).clone();
+        for &prev in rest {
+            values.meet(out(prev));
+        }
+        share(values, first)
+    }
+
+    /// Step the values through a single node, turning its ins into its outs.
+    ///
+    /// Nodes that do not define anything leave the values as they are, and
+    /// the stack values are only copied when a slot changes.
+    fn step(&self, node: &ParserNode, regs: &mut RegValues, stack: &mut Rc<StackValues>) {
+        let reg_in = *regs;
+
+        // out[n] = gen[n] U (in[n] - kill[n]) U (callee_saved if n is entry)
+        regs.remove_all(node.kill_reg_value());
+        if let Some((reg, val)) = node.gen_reg_value(&self.cfg.labels) {
+            regs.insert(reg, val);
+        }
+        if node.is_any_entry() {
+            regs.extend(&RegValues::original(RegSets::callee_saved()));
+        }
+
+        // AVAILABLE VALUE/STACK ESTIMATION
+        // ================================
+        // We use a series of rules to determine new available values
+        // that change our outs. The rules for registers only read the stack
+        // values going in, so they are run before the stack is changed.
+
+        rule_expand_address_for_load(node, regs, &reg_in);
+        rule_perform_math_ops(node, regs, &reg_in);
+        rule_value_from_stack(node, regs, stack);
+
+        // out_stacks[n] = (gen_stacks[n] if we know the location of the stack pointer) U in_stacks[n]
+        // (There is no kill_stacks[n])
+        if node.is_any_entry() {
+            *stack = Rc::clone(&self.no_stack);
+        } else if let (Some((off, val)), Some(curr_stack)) =
+            (node.gen_stack_value(), reg_in.stack_offset())
+        {
+            Rc::make_mut(stack).insert(curr_stack + off, val);
+        }
+        rule_known_values_to_stack(node, stack, &reg_in);
+    }
+
+    /// Write the values going into and out of every node.
+    ///
+    /// An in shares the out of its prev when they are the same, and an out
+    /// shares its in when the node changes nothing, so straight-line code
+    /// stores each set of values only once.
+    fn materialize(&self, blocks: &BasicBlocks) {
+        for (block, values) in blocks.blocks.iter().zip(&self.values) {
+            let prevs = self.cfg.node(block.head()).prevs();
+            let mut reg_in = match prevs.first() {
+                None => Rc::clone(&self.no_regs),
+                Some(&first) => {
+                    let first = &self.values[blocks.block_of(first).index()].reg_out;
+                    if **first == *values.reg_in {
+                        Rc::clone(first)
+                    } else {
+                        Rc::clone(&values.reg_in)
+                    }
+                }
+            };
+            let mut stack_in = Rc::clone(&values.stack_in);
+            drop(prevs);
+
+            for id in block.nodes() {
+                let node = self.cfg.node(id);
+                let mut regs = *reg_in;
+                let mut stack = Rc::clone(&stack_in);
+                self.step(&node.node(), &mut regs, &mut stack);
+
+                // The tail shares the values kept for the block, which the
+                // heads of the blocks after it share in turn
+                let (reg_out, stack) = if id == block.tail() {
+                    (
+                        share(regs, &values.reg_out),
+                        if *stack == *values.stack_out {
+                            Rc::clone(&values.stack_out)
+                        } else {
+                            stack
                         },
                     )
+                } else {
+                    (share(regs, &reg_in), stack)
                 };
+                node.set_reg_values_in(reg_in);
+                node.set_stack_values_in(stack_in);
+                node.set_reg_values_out(Rc::clone(&reg_out));
+                node.set_stack_values_out(Rc::clone(&stack));
+                reg_in = reg_out;
+                stack_in = stack;
+            }
+        }
+    }
+}
 
-                // AVAILABLE VALUE/STACK ESTIMATION
-                // ================================
-                // We use a series of rules to determine new available values
-                // that change our outs.
-
-                rule_expand_address_for_load(&node.node(), &mut out_reg_n, &node.reg_values_in());
-                rule_perform_math_ops(&node.node(), &mut out_reg_n, &node.reg_values_in());
-                rule_known_values_to_stack(&node.node(), &mut out_stack_n, &node.reg_values_in());
-                rule_value_from_stack(&node.node(), &mut out_reg_n, &node.stack_values_in());
-
-                // If either of the outs changed, replace the old outs with the new outs
-                // and mark that we changed something.
-                if out_reg_n != node.reg_values_out() {
-                    changed = true;
-                    node.set_reg_values_out(out_reg_n);
-                }
-                if out_stack_n != node.stack_values_out() {
-                    changed = true;
-                    node.set_stack_values_out(out_stack_n);
-                }
+/// The values in an `Rc`, reusing `like` if they are the same.
+fn share<T: PartialEq>(values: T, like: &Rc<T>) -> Rc<T> {
+    if values == **like {
+        Rc::clone(like)
+    } else {
+        Rc::new(values)
+    }
+}
+
+/// Whether `current` is the meet of the stack values going out of the blocks
+/// of `prevs`.
+///
+/// This is the same as comparing against the result of `meet`, but
+/// without building the meet.
+fn is_stack_meet_of(
+    blocks: &BasicBlocks,
+    values: &[BlockValues],
+    prevs: &[NodeId],
+    current: &StackValues,
+) -> bool {
+    let Some((&first, rest)) = prevs.split_first() else {
+        return current.is_empty();
+    };
+
+    let out = |x: NodeId| &values[blocks.block_of(x).index()].stack_out;
+    let mut len = 0;
+    for (offset, val) in out(first).iter() {
+        if rest.iter().all(|&p| out(p).get(offset) == Some(val)) {
+            if current.get(offset) != Some(val) {
+                return false;
             }
+            len += 1;
         }
-        Ok(())
     }
+    len == current.len()
 }
 
 /// Rule that uses known addresses for load instructions to expand their represenation.
@@ -205,23 +381,25 @@ impl GenerationPass for AvailableValuePass {
 /// with a reference to the specific memory location.
 fn rule_expand_address_for_load(
     node: &ParserNode,
-    available_out: &mut HashMap<Register, AvailableValue>,
-    available_in: &HashMap<Register, AvailableValue>,
+    available_out: &mut RegValues,
+    available_in: &RegValues,
 ) {
     if let Some(store_reg) = node.stores_to() {
         if let ParserNode::Load(load) = node {
-            if let Some(AvailableValue::OriginalRegisterWithScalar(reg, off)) =
-                available_in.get(&load.rs1.data)
-            {
-                available_out.insert(
-                    store_reg.data,
-                    AvailableValue::MemoryAtOriginalRegister(*reg, *off + load.imm.data.0),
-                );
-            } else if let Some(AvailableValue::Address(label)) = available_in.get(&load.rs1.data) {
-                available_out.insert(
-                    store_reg.data,
-                    AvailableValue::Memory(label.clone(), load.imm.data.0),
-                );
+            match available_in.get(load.rs1.data) {
+                Some(AvailableValue::OriginalRegisterWithScalar(reg, off)) => {
+                    available_out.insert(
+                        store_reg.data,
+                        AvailableValue::MemoryAtOriginalRegister(reg, off + load.imm.data.0),
+                    );
+                }
+                Some(AvailableValue::Address(label)) => {
+                    available_out.insert(
+                        store_reg.data,
+                        AvailableValue::Memory(label, load.imm.data.0),
+                    );
+                }
+                _ => {}
             }
         }
     }
@@ -233,24 +411,18 @@ fn rule_expand_address_for_load(
 /// values before and known math operations, store the new value in the register.
 fn rule_perform_math_ops(
     node: &ParserNode,
-    available_out: &mut HashMap<Register, AvailableValue>,
-    available_in: &HashMap<Register, AvailableValue>,
+    available_out: &mut RegValues,
+    available_in: &RegValues,
 ) {
     if let Some(reg) = node.stores_to() {
         let lhs = match node {
-            ParserNode::Arith(expr) => available_in
-                .get(&expr.rs1.data)
-                .map(std::clone::Clone::clone),
-            ParserNode::IArith(expr) => available_in
-                .get(&expr.rs1.data)
-                .map(std::clone::Clone::clone),
+            ParserNode::Arith(expr) => available_in.get(expr.rs1.data),
+            ParserNode::IArith(expr) => available_in.get(expr.rs1.data),
             _ => None,
         };
 
         let rhs = match node {
-            ParserNode::Arith(expr) => available_in
-                .get(&expr.rs2.data)
-                .map(std::clone::Clone::clone),
+            ParserNode::Arith(expr) => available_in.get(expr.rs2.data),
             ParserNode::IArith(expr) => Some(AvailableValue::Constant(expr.imm.data.0)),
             _ => None,
         };
@@ -286,18 +458,14 @@ fn rule_perform_math_ops(
 /// If a register is stored to from a memory location that is the stack, and
 /// the stack contains a value at the offset, then store the value from the
 /// stack into the register.
-fn rule_value_from_stack(
-    node: &ParserNode,
-    available_out: &mut HashMap<Register, AvailableValue>,
-    stack_in: &HashMap<i32, AvailableValue>,
-) {
+fn rule_value_from_stack(node: &ParserNode, available_out: &mut RegValues, stack_in: &StackValues) {
     if let Some(reg) = node.stores_to() {
         if let Some(AvailableValue::MemoryAtOriginalRegister(psp, off)) =
-            available_out.get(&reg.data)
+            available_out.get(reg.data)
         {
             if psp.is_sp() {
                 if let Some(stack_val) = stack_in.get(off) {
-                    available_out.insert(reg.data, stack_val.clone());
+                    available_out.insert(reg.data, stack_val);
                 }
             }
         }
@@ -311,25 +479,100 @@ fn rule_value_from_stack(
 /// value at the entry of the function (B), then replace A with B.
 fn rule_known_values_to_stack(
     _node: &ParserNode,
-    stack_out: &mut HashMap<i32, AvailableValue>,
-    available_in: &HashMap<Register, AvailableValue>,
+    stack_out: &mut Rc<StackValues>,
+    available_in: &RegValues,
 ) {
-    for (pos, val) in stack_out.clone() {
+    let known = |val: AvailableValue| {
         if let AvailableValue::RegisterWithScalar(reg, off) = val {
-            if let Some(item) = available_in.get(&reg) {
-                match item {
-                    AvailableValue::Constant(x) => {
-                        stack_out.insert(pos, AvailableValue::Constant(*x + off));
-                    }
-                    AvailableValue::OriginalRegisterWithScalar(reg2, off3) => {
-                        stack_out.insert(
-                            pos,
-                            AvailableValue::OriginalRegisterWithScalar(*reg2, *off3 + off),
-                        );
-                    }
-                    _ => {}
+            match available_in.get(reg) {
+                Some(AvailableValue::Constant(x)) => {
+                    return Some(AvailableValue::Constant(x + off))
+                }
+                Some(AvailableValue::OriginalRegisterWithScalar(reg2, off3)) => {
+                    return Some(AvailableValue::OriginalRegisterWithScalar(reg2, off3 + off));
                 }
+                _ => {}
             }
         }
+        None
+    };
+
+    // Only copy the values if one of them changes
+    if stack_out.iter().any(|(_, val)| known(val).is_some()) {
+        for (_, val) in Rc::make_mut(stack_out).iter_mut() {
+            if let Some(new) = known(*val) {
+                *val = new;
+            }
+        }
+    }
+}
+
+#[cfg(test)]
+mod test {
+    use super::AvailableValues;
+    use crate::analysis::{solve, AvailableValue, DataflowProblem};
+    use crate::cfg::{BasicBlocks, NodeId};
+    use crate::helpers::{analyse, count_allocations, FACTORIAL_PROGRAM};
+    use crate::parser::Register;
+    use crate::passes::NoStats;
+
+    #[test]
+    fn stable_iteration_does_not_allocate() {
+        let cfg = analyse(FACTORIAL_PROGRAM);
+        let blocks = BasicBlocks::new(&cfg);
+        let mut problem = AvailableValues::new(&cfg, &blocks);
+        solve::<_, NoStats>(&blocks, &mut problem);
+
+        let mut affected = Vec::new();
+        let (changed, allocations) = count_allocations(|| {
+            blocks.blocks.iter().fold(false, |acc, x| {
+                problem.transfer(&blocks, x, &mut affected) || acc
+            })
+        });
+        assert!(!changed);
+        assert!(affected.is_empty());
+        assert_eq!(allocations, 0);
+    }
+
+    #[test]
+    fn unchanged_values_are_shared() {
+        let cfg = analyse(
+            "main:
+                li a0, 1
+                sw a0, 0(sp)
+                mv a1, a0
+                li a7, 1
+                ecall
+            ",
+        );
+        let node = |x: usize| cfg.node(NodeId::new(x));
+
+        // li, sw and mv only define one thing each, so the rest is shared
+        assert!(std::ptr::eq(
+            &*node(1).reg_values_out(),
+            &*node(2).reg_values_in()
+        ));
+        assert!(std::ptr::eq(
+            &*node(2).reg_values_in(),
+            &*node(2).reg_values_out()
+        ));
+        assert!(!std::ptr::eq(
+            &*node(2).stack_values_in(),
+            &*node(2).stack_values_out()
+        ));
+        assert!(std::ptr::eq(
+            &*node(2).stack_values_out(),
+            &*node(3).stack_values_out()
+        ));
+        assert_eq!(
+            node(3).stack_values_out().get(0),
+            Some(AvailableValue::Constant(1))
+        );
+
+        assert_eq!(
+            node(1).reg_values_out().get(Register::X10),
+            Some(AvailableValue::Constant(1))
+        );
+        assert_eq!(node(5).known_ecall(), Some(1));
     }
 }
@@ -0,0 +1,352 @@
+// WORKLIST DATAFLOW SOLVER
+// ========================
+
+use std::collections::BTreeSet;
+
+use crate::cfg::{BasicBlock, BasicBlocks, BlockId, BlockIds, NodeId};
+use crate::passes::{Count, Counters};
+
+/// The direction that facts flow through the graph for a dataflow problem.
+#[derive(Clone, Copy, Debug, PartialEq, Eq)]
+pub enum Direction {
+    /// Facts flow from predecessors to successors (ex. available values).
+    Forward,
+    /// Facts flow from successors to predecessors (ex. liveness).
+    Backward,
+}
+
+/// A dataflow problem that can be solved by [`solve`].
+///
+/// The problem owns the facts (usually in a `NodeTable` per fact) and only
+/// needs to know how to recompute the facts of a single basic block from the
+/// facts of its neighbours.
+pub trait DataflowProblem {
+    const DIRECTION: Direction;
+
+    /// Recompute the facts of `block`.
+    ///
+    /// Returns whether the facts that flow in the problem's direction changed.
+    /// If so, the successors (forward) or predecessors (backward) of the block
+    /// are revisited. Any other node whose facts depend on this block, such as
+    /// the call sites of a function, should be pushed to `affected`; their
+    /// blocks are revisited no matter what is returned.
+    fn transfer(
+        &mut self,
+        blocks: &BasicBlocks,
+        block: &BasicBlock,
+        affected: &mut Vec<NodeId>,
+    ) -> bool;
+}
+
+/// The order that the solver visits blocks in.
+///
+/// Blocks are visited in reverse postorder for forward problems and in
+/// postorder for backward problems. This only depends on the blocks, so it
+/// can be calculated once and shared between many calls to [`solve_within`].
+#[derive(Clone, Debug, PartialEq, Eq)]
+pub struct Schedule {
+    order: Vec<BlockId>,
+    /// rank[b] is the position of block b in `order`
+    rank: Vec<usize>,
+}
+
+impl Schedule {
+    pub fn new(blocks: &BasicBlocks, direction: Direction) -> Self {
+        let mut order = postorder(blocks);
+        if direction == Direction::Forward {
+            order.reverse();
+        }
+
+        let mut rank = vec![0; order.len()];
+        for (pos, id) in order.iter().enumerate() {
+            rank[id.index()] = pos;
+        }
+        Schedule { order, rank }
+    }
+}
+
+/// Solve a dataflow problem over the basic blocks of the graph with a worklist.
+///
+/// Every block is visited once in reverse postorder (forward problems) or
+/// postorder (backward problems). After that, only the blocks that depend on
+/// a change are revisited, always picking the earliest pending block in that
+/// order. The amount of work done is proportional to the amount of change,
+/// rather than the number of nodes times the number of iterations.
+///
+/// Returns the number of times a block was visited, along with how many
+/// nodes were visited and changed, counted with `C`.
+pub fn solve<P: DataflowProblem, C: Count>(blocks: &BasicBlocks, problem: &mut P) -> C {
+    let schedule = Schedule::new(blocks, P::DIRECTION);
+    let mut counter = C::default();
+    solve_within(
+        blocks,
+        &schedule,
+        problem,
+        blocks.ids(),
+        |_| true,
+        &mut Vec::new(),
+        &mut counter,
+    );
+    counter
+}
+
+/// Solve a dataflow problem on part of the graph.
+///
+/// This is the same as [`solve`], except that only the `start` blocks are
+/// visited to begin with, and only blocks for which `within` is true are
+/// ever visited. Any other block that would have been visited is pushed to
+/// `escaped` instead, so that the caller can solve it later. The facts of
+/// blocks outside of the region are read, but never recomputed.
+///
+/// Adds the same counters as [`solve`] returns to `counter`.
+pub fn solve_within<P, C, I, F>(
+    blocks: &BasicBlocks,
+    schedule: &Schedule,
+    problem: &mut P,
+    start: I,
+    within: F,
+    escaped: &mut Vec<BlockId>,
+    counter: &mut C,
+) where
+    P: DataflowProblem,
+    C: Count,
+    I: IntoIterator<Item = BlockId>,
+    F: Fn(BlockId) -> bool,
+{
+    let mut worklist = start
+        .into_iter()
+        .map(|x| schedule.rank[x.index()])
+        .collect::<BTreeSet<usize>>();
+    let mut affected = Vec::new();
+    let mut push = |worklist: &mut BTreeSet<usize>, id: BlockId| {
+        if within(id) {
+            worklist.insert(schedule.rank[id.index()]);
+        } else {
+            escaped.push(id);
+        }
+    };
+
+    while let Some(pos) = worklist.pop_first() {
+        let block = blocks.block(schedule.order[pos]);
+        counter.add(Counters {
+            iterations: 1,
+            visited: block.len(),
+            changed: 0,
+        });
+
+        if problem.transfer(blocks, block, &mut affected) {
+            counter.add(Counters {
+                changed: block.len(),
+                ..Counters::default()
+            });
+            let deps = match P::DIRECTION {
+                Direction::Forward => &block.nexts,
+                Direction::Backward => &block.prevs,
+            };
+            for &dep in deps {
+                push(&mut worklist, dep);
+            }
+        }
+        for node in affected.drain(..) {
+            push(&mut worklist, blocks.block_of(node));
+        }
+    }
+}
+
+/// Calculate the postorder of the blocks over their successor edges.
+///
+/// The search is started from every block in program order, so blocks that
+/// are not reachable from the program entry are still included. Successors
+/// are visited in program order so that the result is deterministic.
+fn postorder(blocks: &BasicBlocks) -> Vec<BlockId> {
+    let successors = |id: BlockId| {
+        let mut nexts = blocks.block(id).nexts.clone();
+        nexts.sort_unstable();
+        nexts
+    };
+
+    let mut visited = vec![false; blocks.len()];
+    let mut order = Vec::with_capacity(blocks.len());
+    let mut stack: Vec<(BlockId, BlockIds, usize)> = Vec::new();
+
+    for root in blocks.ids() {
+        if visited[root.index()] {
+            continue;
+        }
+        visited[root.index()] = true;
+        stack.push((root, successors(root), 0));
+
+        while let Some((id, nexts, pos)) = stack.last_mut() {
+            if let Some(&next) = nexts.get(*pos) {
+                *pos += 1;
+                if !visited[next.index()] {
+                    visited[next.index()] = true;
+                    stack.push((next, successors(next), 0));
+                }
+            } else {
+                order.push(*id);
+                stack.pop();
+            }
+        }
+    }
+
+    order
+}
+
+#[cfg(test)]
+mod test {
+    use std::collections::{HashMap, HashSet};
+    use std::rc::Rc;
+
+    use super::{solve, solve_within, DataflowProblem, Direction, Schedule};
+    use crate::analysis::{LivenessTable, NextUseTable};
+    use crate::cfg::{BasicBlock, BasicBlocks, CFGNode, Cfg, LabelTable, NodeId, NodeTable};
+    use crate::parser::{Info, LabelString, ParserNode, With};
+    use crate::passes::Counters;
+
+    /// Build a graph of `n` nodes with the given edges.
+    fn graph(n: usize, edges: &[(usize, usize)]) -> Cfg {
+        let nodes = (0..n)
+            .map(|i| {
+                let label = With::new(LabelString(format!("n{i}")), Info::default());
+                Rc::new(CFGNode::new(
+                    NodeId::new(i),
+                    ParserNode::new_label(label),
+                    HashSet::new(),
+                ))
+            })
+            .collect::<Vec<_>>();
+        for &(from, to) in edges {
+            nodes[from].insert_next(NodeId::new(to));
+            nodes[to].insert_prev(NodeId::new(from));
+        }
+        Cfg {
+            liveness: LivenessTable::new(n),
+            reachable: NodeTable::new(n, true),
+            nodes,
+            labels: LabelTable::default(),
+            label_function_map: HashMap::new(),
+            summaries: HashMap::new(),
+            next_uses: NextUseTable::default(),
+        }
+    }
+
+    /// Counts the longest distance to a node from the start (forward) or
+    /// to the end (backward), capped to make loops converge.
+    struct Distance<'a, const FORWARD: bool> {
+        cfg: &'a Cfg,
+        dist: NodeTable<Option<usize>>,
+    }
+
+    impl<'a, const FORWARD: bool> Distance<'a, FORWARD> {
+        fn new(cfg: &'a Cfg) -> Self {
+            Distance {
+                cfg,
+                dist: NodeTable::new(cfg.nodes.len(), None),
+            }
+        }
+
+        fn visit(&mut self, node: NodeId) -> bool {
+            let cfg = self.cfg;
+            let deps = if FORWARD {
+                cfg.node(node).prevs()
+            } else {
+                cfg.node(node).nexts()
+            };
+            let new = deps
+                .iter()
+                .map(|&x| self.dist[x].map_or(1, |d| d + 1))
+                .max()
+                .unwrap_or(0)
+                .min(cfg.nodes.len());
+            self.dist[node].replace(new) != Some(new)
+        }
+    }
+
+    impl<const FORWARD: bool> DataflowProblem for Distance<'_, FORWARD> {
+        const DIRECTION: Direction = if FORWARD {
+            Direction::Forward
+        } else {
+            Direction::Backward
+        };
+
+        fn transfer(&mut self, _: &BasicBlocks, block: &BasicBlock, _: &mut Vec<NodeId>) -> bool {
+            if FORWARD {
+                block.nodes().fold(false, |acc, x| self.visit(x) || acc)
+            } else {
+                block
+                    .nodes()
+                    .rev()
+                    .fold(false, |acc, x| self.visit(x) || acc)
+            }
+        }
+    }
+
+    #[test]
+    fn straight_line_is_one_block() {
+        let edges = (0..9).map(|i| (i, i + 1)).collect::<Vec<_>>();
+        let cfg = graph(10, &edges);
+        let blocks = BasicBlocks::new(&cfg);
+
+        let mut forward = Distance::<true>::new(&cfg);
+        assert_eq!(solve::<_, Counters>(&blocks, &mut forward).iterations, 1);
+        assert_eq!(forward.dist[NodeId::new(9)], Some(9));
+
+        let mut backward = Distance::<false>::new(&cfg);
+        assert_eq!(solve::<_, Counters>(&blocks, &mut backward).iterations, 1);
+        assert_eq!(backward.dist[NodeId::new(0)], Some(9));
+    }
+
+    #[test]
+    fn diamond_visits_once() {
+        // 0 -> 1 -> 2 -> 4, 1 -> 3 -> 4
+        let cfg = graph(5, &[(0, 1), (1, 2), (2, 4), (1, 3), (3, 4)]);
+        let blocks = BasicBlocks::new(&cfg);
+        assert_eq!(blocks.len(), 4);
+
+        let mut forward = Distance::<true>::new(&cfg);
+        assert_eq!(solve::<_, Counters>(&blocks, &mut forward).iterations, 4);
+        assert_eq!(forward.dist[NodeId::new(4)], Some(3));
+    }
+
+    #[test]
+    fn loop_converges() {
+        // 0 -> 1 -> 2 -> 3 -> 1, 3 -> 4
+        let cfg = graph(5, &[(0, 1), (1, 2), (2, 3), (3, 1), (3, 4)]);
+        let blocks = BasicBlocks::new(&cfg);
+        let mut forward = Distance::<true>::new(&cfg);
+        let counters: Counters = solve(&blocks, &mut forward);
+        assert!(counters.iterations > blocks.len());
+        assert!(counters.changed < counters.visited);
+        assert_eq!(forward.dist[NodeId::new(4)], Some(5));
+    }
+
+    #[test]
+    fn within_region_escapes() {
+        // 0 -> 1 -> 2 -> 4, 1 -> 3 -> 4, with only {0, 1} and {2} solved
+        let cfg = graph(5, &[(0, 1), (1, 2), (2, 4), (1, 3), (3, 4)]);
+        let blocks = BasicBlocks::new(&cfg);
+        let schedule = Schedule::new(&blocks, Direction::Forward);
+        let region = [0, 2].map(|x| blocks.block_of(NodeId::new(x)));
+
+        let mut forward = Distance::<true>::new(&cfg);
+        let mut escaped = Vec::new();
+        let mut counters = Counters::default();
+        solve_within(
+            &blocks,
+            &schedule,
+            &mut forward,
+            region,
+            |x| region.contains(&x),
+            &mut escaped,
+            &mut counters,
+        );
+        assert_eq!(counters.iterations, 2);
+        assert_eq!(forward.dist[NodeId::new(2)], Some(2));
+        assert_eq!(forward.dist[NodeId::new(4)], None);
+
+        escaped.sort_unstable();
+        let expected = [3, 4].map(|x| blocks.block_of(NodeId::new(x)));
+        assert_eq!(escaped, expected);
+    }
+}
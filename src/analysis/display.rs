@@ -1,11 +1,20 @@
-use super::AvailableValue;
+use itertools::Itertools;
 
-impl std::fmt::Display for AvailableValue {
+use crate::cfg::LabelTable;
+
+use super::{AvailableValue, RegValues, StackValues};
+
+/// An available value along with the labels that it can refer to, so that
+/// it can be displayed.
+pub struct DisplayValue<'a>(pub AvailableValue, pub &'a LabelTable);
+
+impl std::fmt::Display for DisplayValue<'_> {
     fn fmt(&self, f: &mut std::fmt::Formatter<'_>) -> std::fmt::Result {
-        match self {
+        let DisplayValue(value, labels) = self;
+        match value {
             AvailableValue::Constant(v) => write!(f, "{}", v),
-            AvailableValue::Address(a) => write!(f, "{}", a),
-            AvailableValue::Memory(a, off) => write!(f, "{}({})", off, a),
+            AvailableValue::Address(a) => write!(f, "{}", labels.name(*a)),
+            AvailableValue::Memory(a, off) => write!(f, "{}({})", off, labels.name(*a)),
             AvailableValue::OriginalRegisterWithScalar(reg, off) => {
                 if off == &0 {
                     write!(f, "{}", reg)
@@ -27,3 +36,23 @@ impl std::fmt::Display for AvailableValue {
         }
     }
 }
+
+impl RegValues {
+    pub fn str(&self, labels: &LabelTable) -> String {
+        self.iter()
+            .map(|(k, v)| format!("[{}: {}]", k, DisplayValue(v, labels)))
+            .sorted()
+            .collect::<Vec<_>>()
+            .join(", ")
+    }
+}
+
+impl StackValues {
+    pub fn str(&self, labels: &LabelTable) -> String {
+        self.iter()
+            .map(|(k, v)| format!("[{}: {}]", k, DisplayValue(v, labels)))
+            .sorted()
+            .collect::<Vec<_>>()
+            .join(", ")
+    }
+}
@@ -1,12 +1,11 @@
-use std::collections::HashSet;
-
-use crate::parser::{IArithType, ParserNode, RegSets, Register};
+use crate::cfg::LabelTable;
+use crate::parser::{IArithType, ParserNode, RegSet, RegSets, Register};
 
 use super::AvailableValue;
 
 impl ParserNode {
-    pub fn kill_reg_value(&self) -> HashSet<Register> {
-        match self.clone() {
+    pub fn kill_reg_value(&self) -> RegSet {
+        match self {
             ParserNode::FuncEntry(_) => RegSets::caller_saved(),
             ParserNode::JumpLink(x) => {
                 // If a jump and link instruction is a call to a function, denoted
@@ -15,7 +14,7 @@ impl ParserNode {
                 let mut set = if x.rd.data == Register::X1 {
                     RegSets::caller_saved()
                 } else {
-                    HashSet::new()
+                    RegSet::new()
                 };
                 set.insert(x.rd.data);
                 set
@@ -24,28 +23,23 @@ impl ParserNode {
         }
     }
 
-    pub fn kill_reg(&self) -> HashSet<Register> {
-        let regs: HashSet<Register> = match self.clone() {
+    pub fn kill_reg(&self) -> RegSet {
+        let regs: RegSet = match self {
             ParserNode::FuncEntry(_) => RegSets::callee_saved(),
-            ParserNode::JumpLink(_) if self.calls_to().is_some() => HashSet::new(),
-            _ => self
-                .stores_to()
-                .map(|x| vec![x.data].into_iter().collect())
-                .unwrap_or_default(),
+            // A call is the same as `calls_to` being some, without cloning
+            // the label
+            ParserNode::JumpLink(x) if x.rd == Register::X1 => RegSet::new(),
+            _ => self.operands().writes(),
         };
-        regs.into_iter()
-            .filter(|x| *x != Register::X0)
-            .collect::<HashSet<_>>()
+        regs - RegSet::single(Register::X0)
     }
 
-    pub fn gen_reg(&self) -> HashSet<Register> {
-        let regs: HashSet<Register> = match self {
+    pub fn gen_reg(&self) -> RegSet {
+        let regs: RegSet = match self {
             _ if self.is_return() => RegSets::callee_saved(),
-            _ => self.reads_from().into_iter().map(|x| x.data).collect(),
+            _ => self.operands().reads(),
         };
-        regs.into_iter()
-            .filter(|x| *x != Register::X0)
-            .collect::<HashSet<_>>()
+        regs - RegSet::single(Register::X0)
     }
 
     pub fn gen_stack_value(&self) -> Option<(i32, AvailableValue)> {
@@ -63,15 +57,14 @@ impl ParserNode {
             _ => None,
         }
     }
-    pub fn gen_reg_value(&self) -> Option<(Register, AvailableValue)> {
+    pub fn gen_reg_value(&self, labels: &LabelTable) -> Option<(Register, AvailableValue)> {
         // The function entry case and program entry case is handled separately
         // to account for all the "original" registers.
         // TODO do registers need to be saved at program entry?
         match self {
-            ParserNode::LoadAddr(expr) => Some((
-                expr.rd.data,
-                AvailableValue::Address(expr.name.data.clone()),
-            )),
+            ParserNode::LoadAddr(expr) => labels
+                .id(&expr.name.data)
+                .map(|x| (expr.rd.data, AvailableValue::Address(x))),
             ParserNode::Load(expr) => Some((
                 expr.rd.data,
                 AvailableValue::MemoryAtRegister(expr.rs1.data, expr.imm.data.0),
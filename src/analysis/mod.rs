@@ -1,14 +1,23 @@
+mod dataflow;
+pub use dataflow::*;
+
 mod liveness;
 pub use liveness::*;
 
+mod next_use;
+pub use next_use::*;
+
+mod summary;
+pub use summary::*;
+
 mod available;
 pub use available::*;
 
 mod gen_kill;
 pub use gen_kill::*;
 
-mod set_traits;
-pub use set_traits::*;
+mod values;
+pub use values::*;
 
 mod display;
 pub use display::*;
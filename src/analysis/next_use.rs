@@ -0,0 +1,150 @@
+use std::cell::OnceCell;
+
+use crate::cfg::{Cfg, NodeId, NodeTable};
+use crate::parser::Register;
+
+/// The nearest use of a register that can be reached from a node, and how
+/// many edges away it is.
+type NextUse = Option<(u32, NodeId)>;
+
+/// The nearest node that reads each register, for every node of the graph.
+///
+/// Uses are found with one backward search from every node that reads a
+/// register, instead of one forward search for every lookup. The table for
+/// a register is only calculated the first time that it is looked up, as
+/// only the registers that are in a diagnostic ever are. Since it is kept
+/// after that, it must not be looked up before the graph's edges are final.
+#[derive(Clone, Debug, Default, PartialEq, Eq)]
+pub struct NextUseTable {
+    regs: [OnceCell<NodeTable<NextUse>>; 32],
+}
+
+impl NextUseTable {
+    fn calculate(cfg: &Cfg, reg: Register) -> NodeTable<NextUse> {
+        let mut uses = NodeTable::new(cfg.nodes.len(), None);
+
+        // Breadth first from all uses at once, so that nodes are found in
+        // order of their distance to the nearest use
+        let mut order = Vec::new();
+        for node in cfg {
+            if node.node().gen_reg().contains(reg) {
+                uses[node.id()] = Some((0, node.id()));
+                order.push(node.id());
+            }
+        }
+        let mut i = 0;
+        while let Some(&id) = order.get(i) {
+            i += 1;
+            let (dist, used) = uses[id].expect("found nodes have a use");
+            for &prev in cfg.node(id).prevs().iter() {
+                if uses[prev].is_none() {
+                    uses[prev] = Some((dist + 1, used));
+                    order.push(prev);
+                }
+            }
+        }
+
+        // When there are many nearest uses, pick the one that a forward
+        // search would find first: the one through the earliest next.
+        for &id in &order {
+            if let Some((dist, _)) = uses[id].filter(|x| x.0 > 0) {
+                let nearest = cfg
+                    .node(id)
+                    .nexts()
+                    .iter()
+                    .find_map(|&x| uses[x].filter(|x| x.0 == dist - 1));
+                if let Some((_, used)) = nearest {
+                    uses[id] = Some((dist, used));
+                }
+            }
+        }
+        uses
+    }
+}
+
+impl Cfg {
+    /// The nearest node after `node` that reads `reg`, following nexts.
+    ///
+    /// If many uses are as near, the one that a breadth first search
+    /// would visit first is picked.
+    pub fn next_use(&self, node: NodeId, reg: Register) -> Option<NodeId> {
+        let uses = self.next_uses.regs[reg.to_num() as usize]
+            .get_or_init(|| NextUseTable::calculate(self, reg));
+        self.node(node)
+            .nexts()
+            .iter()
+            .filter_map(|&x| uses[x])
+            .reduce(|acc, x| if x.0 < acc.0 { x } else { acc })
+            .map(|x| x.1)
+    }
+}
+
+#[cfg(test)]
+mod test {
+    use crate::cfg::{Cfg, NodeId};
+    use crate::helpers::analyse;
+    use crate::parser::Register;
+
+    /// The index of the node that reads `reg` nearest after the node at `from`.
+    fn next_use(cfg: &Cfg, from: usize, reg: Register) -> Option<usize> {
+        cfg.next_use(NodeId::new(from), reg).map(NodeId::index)
+    }
+
+    #[test]
+    fn nearest_branch_is_picked() {
+        let cfg = analyse(
+            "main:
+                li a0, 1
+                beq a0, zero, far
+                li a1, 2
+                mv a2, a1
+                li a7, 10
+                ecall
+            far:
+                li a3, 1
+                li a4, 1
+                mv a2, a1
+                li a7, 10
+                ecall
+            ",
+        );
+        // 0 is the program entry, so `beq` is node 2
+        assert_eq!(next_use(&cfg, 2, Register::X11), Some(4));
+        assert_eq!(next_use(&cfg, 1, Register::X10), Some(2));
+        assert_eq!(next_use(&cfg, 4, Register::X11), None);
+    }
+
+    #[test]
+    fn equal_uses_follow_the_first_next() {
+        let cfg = analyse(
+            "main:
+                beq a0, zero, other
+                mv a1, a2
+                li a7, 10
+                ecall
+            other:
+                mv a3, a2
+                li a7, 10
+                ecall
+            ",
+        );
+        let first = cfg.node(NodeId::new(1)).nexts()[0].index();
+        assert_eq!(next_use(&cfg, 1, Register::X12), Some(first));
+    }
+
+    #[test]
+    fn uses_are_found_around_loops() {
+        let cfg = analyse(
+            "main:
+                li t0, 3
+            loop:
+                addi t0, t0, -1
+                bne t0, zero, loop
+                li a7, 10
+                ecall
+            ",
+        );
+        assert_eq!(next_use(&cfg, 3, Register::X5), Some(2));
+        assert_eq!(next_use(&cfg, 1, Register::X5), Some(2));
+    }
+}
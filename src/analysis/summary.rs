@@ -0,0 +1,197 @@
+use std::collections::HashMap;
+
+use crate::{
+    cfg::{Cfg, Function},
+    parser::{RegSet, RegSets},
+    passes::{CFGError, GenerationPass},
+};
+
+/// What a function looks like from its call sites.
+///
+/// Summaries are calculated once per function after liveness and
+/// available values have reached their fixpoint, and are then shared by
+/// every lint that looks at a call or at a function as a whole.
+#[derive(Clone, Copy, Debug, Default, PartialEq, Eq)]
+pub struct FunctionSummary {
+    /// The argument registers that are read before they are written
+    pub arguments: RegSet,
+    /// The return registers that are read by any caller
+    pub returns: RegSet,
+    /// Every register that may be written by the function or its callees
+    pub clobbers: RegSet,
+    /// The offset of the stack pointer at the exit, if it is known
+    pub stack_delta: Option<i32>,
+    /// The callee-saved registers that do not have their original value
+    /// at the exit
+    pub overwritten: RegSet,
+}
+
+impl FunctionSummary {
+    /// Summarise a function on its own.
+    ///
+    /// A call only clobbers the registers that the calling convention lets
+    /// the callee write. `FunctionSummaryPass` adds what each callee really
+    /// writes, so summaries from the graph should be preferred.
+    pub fn new(cfg: &Cfg, func: &Function) -> Self {
+        let clobbers = func
+            .nodes
+            .iter()
+            .filter(|x| x.id() != func.entry.id())
+            .fold(RegSet::new(), |acc, x| acc | x.node().kill_reg_value());
+
+        let exit = func.exit.reg_values_in();
+        let overwritten = RegSets::callee_saved()
+            .into_iter()
+            .filter(|&x| !exit.is_original_value(x))
+            .collect();
+
+        FunctionSummary {
+            arguments: cfg.liveness.live_in[func.entry.id()] & RegSets::argument(),
+            returns: cfg.liveness.live_in[func.exit.id()] & RegSets::ret(),
+            clobbers,
+            stack_delta: exit.stack_offset(),
+            overwritten,
+        }
+    }
+}
+
+pub struct FunctionSummaryPass;
+impl GenerationPass for FunctionSummaryPass {
+    fn run(cfg: &mut Cfg) -> Result<(), Box<CFGError>> {
+        // A function with many labels is in the map once for each label
+        let mut summaries = HashMap::new();
+        let mut callees = HashMap::new();
+        for func in cfg.label_function_map.values() {
+            summaries
+                .entry(func.entry.id())
+                .or_insert_with(|| FunctionSummary::new(cfg, func));
+            callees.entry(func.entry.id()).or_insert_with(|| {
+                func.nodes
+                    .iter()
+                    .filter_map(|x| x.calls_to(cfg))
+                    .map(|x| x.entry.id())
+                    .collect::<Vec<_>>()
+            });
+        }
+
+        // A function clobbers whatever its callees do. Clobbers only grow,
+        // so this stops once every cycle of calls agrees.
+        let mut changed = true;
+        while changed {
+            changed = false;
+            for (entry, called) in &callees {
+                let clobbers = called
+                    .iter()
+                    .filter_map(|x| summaries.get(x))
+                    .fold(summaries[entry].clobbers, |acc, x| acc | x.clobbers);
+                if let Some(summary) = summaries.get_mut(entry) {
+                    changed |= summary.clobbers != clobbers;
+                    summary.clobbers = clobbers;
+                }
+            }
+        }
+
+        cfg.summaries = summaries;
+        Ok(())
+    }
+}
+
+#[cfg(test)]
+mod test {
+    use crate::cfg::Cfg;
+    use crate::helpers::{analyse, FACTORIAL_PROGRAM};
+    use crate::parser::{LabelString, RegSet, RegSets, Register};
+
+    use super::FunctionSummary;
+
+    fn summary(cfg: &Cfg, name: &str) -> FunctionSummary {
+        let id = cfg.labels.id(&LabelString(name.to_owned())).unwrap();
+        cfg.summary(cfg.labels.function(id).unwrap())
+    }
+
+    #[test]
+    fn arguments_and_returns_are_summarised() {
+        let cfg = analyse(
+            "main:
+                li a0, 1
+                call f
+                li a7, 1
+                ecall
+                li a7, 10
+                ecall
+            f:
+                addi a0, a0, 1
+                ret
+            ",
+        );
+        let f = summary(&cfg, "f");
+        assert_eq!(f.arguments, RegSet::single(Register::X10));
+        assert_eq!(f.returns, RegSet::single(Register::X10));
+        assert_eq!(f.clobbers, RegSet::single(Register::X10));
+        assert_eq!(f.stack_delta, Some(0));
+        assert!(f.overwritten.is_empty());
+    }
+
+    #[test]
+    fn recursive_function_is_summarised() {
+        let cfg = analyse(FACTORIAL_PROGRAM);
+        let fact = summary(&cfg, "fact");
+        assert_eq!(fact.arguments, RegSet::single(Register::X10));
+        assert_eq!(fact.stack_delta, Some(0));
+        // The saved registers are restored before the return
+        assert!(fact.overwritten.is_empty());
+        // The recursive call clobbers everything the caller has to save
+        let saved = RegSets::caller_saved() | RegSet::from_regs(&[Register::X1, Register::X8]);
+        assert_eq!(fact.clobbers & saved, saved);
+        assert_eq!(cfg.summaries.len(), 1);
+    }
+
+    #[test]
+    fn callee_clobbers_are_included() {
+        let cfg = analyse(
+            "main:
+                call f
+                li a7, 10
+                ecall
+            f:
+                addi sp, sp, -4
+                sw ra, 0(sp)
+                call g
+                lw ra, 0(sp)
+                addi sp, sp, 4
+                ret
+            g:
+                li s1, 1
+                ret
+            ",
+        );
+        // g breaks the convention, and f does too by calling it
+        let g = summary(&cfg, "g");
+        let f = summary(&cfg, "f");
+        assert!(g.clobbers.contains(Register::X9));
+        assert!(f.clobbers.contains(Register::X9));
+    }
+
+    #[test]
+    fn unrestored_registers_are_overwritten() {
+        let cfg = analyse(
+            "main:
+                call f
+                li a7, 10
+                ecall
+            f:
+                addi sp, sp, -4
+                li s1, 1
+                ret
+            ",
+        );
+        let f = summary(&cfg, "f");
+        assert_eq!(f.stack_delta, Some(-4));
+        assert_eq!(
+            f.overwritten,
+            RegSet::from_regs(&[Register::X2, Register::X9])
+        );
+        assert!(f.arguments.is_empty());
+        assert!(f.returns.is_empty());
+    }
+}
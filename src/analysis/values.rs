@@ -0,0 +1,187 @@
+use crate::parser::{RegSet, Register};
+
+use super::AvailableValue;
+
+/// The values available in each register at some point in the program.
+///
+/// There is a slot for every register, so getting, setting and meeting values
+/// never allocates. Nodes keep these behind an `Rc`, so a node whose values
+/// are unchanged from the node before it shares them instead of copying.
+#[derive(Clone, Copy, Debug, PartialEq, Eq, Hash)]
+pub struct RegValues([Option<AvailableValue>; 32]);
+
+impl Default for RegValues {
+    fn default() -> Self {
+        RegValues::EMPTY
+    }
+}
+
+impl RegValues {
+    /// No register has a known value.
+    pub const EMPTY: RegValues = RegValues([None; 32]);
+
+    /// Every register in `regs` has its original value.
+    pub fn original(regs: RegSet) -> Self {
+        let mut values = RegValues::EMPTY;
+        for reg in regs {
+            values.insert(reg, AvailableValue::OriginalRegisterWithScalar(reg, 0));
+        }
+        values
+    }
+
+    #[inline(always)]
+    pub fn get(&self, reg: Register) -> Option<AvailableValue> {
+        self.0[reg.to_num() as usize]
+    }
+
+    #[inline(always)]
+    pub fn insert(&mut self, reg: Register, value: AvailableValue) {
+        self.0[reg.to_num() as usize] = Some(value);
+    }
+
+    /// Forget the values of every register in `regs`.
+    pub fn remove_all(&mut self, regs: RegSet) {
+        for reg in regs {
+            self.0[reg.to_num() as usize] = None;
+        }
+    }
+
+    /// Set the value of every register that has one in `other`.
+    pub fn extend(&mut self, other: &RegValues) {
+        for (slot, value) in self.0.iter_mut().zip(other.0) {
+            if value.is_some() {
+                *slot = value;
+            }
+        }
+    }
+
+    /// Keep only the values that are the same in `other`.
+    pub fn meet(&mut self, other: &RegValues) {
+        for (slot, value) in self.0.iter_mut().zip(other.0) {
+            if *slot != value {
+                *slot = None;
+            }
+        }
+    }
+
+    pub fn iter(&self) -> impl Iterator<Item = (Register, AvailableValue)> + '_ {
+        self.0
+            .iter()
+            .enumerate()
+            .filter_map(|(i, x)| x.map(|x| (Register::from_num(i as u8), x)))
+    }
+
+    pub fn len(&self) -> usize {
+        self.0.iter().filter(|x| x.is_some()).count()
+    }
+
+    pub fn is_empty(&self) -> bool {
+        self.0.iter().all(Option::is_none)
+    }
+
+    pub fn is_original_value(&self, reg: Register) -> bool {
+        self.get(reg) == Some(AvailableValue::OriginalRegisterWithScalar(reg, 0))
+    }
+
+    /// Returns the offset of the stack pointer if it is known.
+    ///
+    /// This is used to determine the offset of the stack pointer in relation
+    /// to the value it was at the beginning of the function or graph.
+    pub fn stack_offset(&self) -> Option<i32> {
+        match self.get(Register::X2) {
+            Some(AvailableValue::OriginalRegisterWithScalar(Register::X2, off)) => Some(off),
+            _ => None,
+        }
+    }
+}
+
+/// The values available in each stack slot at some point in the program.
+///
+/// Slots are kept sorted by their offset from the original stack pointer.
+/// Only a handful of slots are ever known at once, so this is smaller and
+/// faster to meet than a map. Like `RegValues`, nodes share these behind an
+/// `Rc` while they are unchanged.
+#[derive(Clone, Debug, Default, PartialEq, Eq, Hash)]
+pub struct StackValues(Vec<(i32, AvailableValue)>);
+
+impl StackValues {
+    /// No stack slot has a known value.
+    pub const EMPTY: StackValues = StackValues(Vec::new());
+
+    pub fn get(&self, offset: i32) -> Option<AvailableValue> {
+        self.0
+            .binary_search_by_key(&offset, |x| x.0)
+            .ok()
+            .map(|i| self.0[i].1)
+    }
+
+    pub fn insert(&mut self, offset: i32, value: AvailableValue) {
+        match self.0.binary_search_by_key(&offset, |x| x.0) {
+            Ok(i) => self.0[i].1 = value,
+            Err(i) => self.0.insert(i, (offset, value)),
+        }
+    }
+
+    /// Keep only the values that are the same in `other`.
+    pub fn meet(&mut self, other: &StackValues) {
+        self.0
+            .retain(|&(offset, value)| other.get(offset) == Some(value));
+    }
+
+    pub fn iter(&self) -> impl Iterator<Item = (i32, AvailableValue)> + '_ {
+        self.0.iter().copied()
+    }
+
+    pub fn iter_mut(&mut self) -> impl Iterator<Item = (i32, &mut AvailableValue)> + '_ {
+        self.0.iter_mut().map(|(offset, value)| (*offset, value))
+    }
+
+    pub fn len(&self) -> usize {
+        self.0.len()
+    }
+
+    pub fn is_empty(&self) -> bool {
+        self.0.is_empty()
+    }
+}
+
+#[cfg(test)]
+mod test {
+    use super::{RegValues, StackValues};
+    use crate::analysis::AvailableValue::{Constant, OriginalRegisterWithScalar};
+    use crate::parser::{RegSet, Register};
+
+    #[test]
+    fn registers_meet_slotwise() {
+        let mut a = RegValues::original(RegSet::from_regs(&[Register::X1, Register::X2]));
+        let mut b = a;
+        a.insert(Register::X10, Constant(1));
+        b.insert(Register::X10, Constant(2));
+        b.insert(Register::X11, Constant(3));
+        b.insert(Register::X2, OriginalRegisterWithScalar(Register::X2, -4));
+
+        a.meet(&b);
+        assert_eq!(
+            a.iter().collect::<Vec<_>>(),
+            vec![(Register::X1, OriginalRegisterWithScalar(Register::X1, 0))]
+        );
+        assert!(a.is_original_value(Register::X1));
+        assert_eq!(b.stack_offset(), Some(-4));
+    }
+
+    #[test]
+    fn stack_stays_sorted() {
+        let mut a = StackValues::default();
+        for offset in [-4, -12, -8] {
+            a.insert(offset, Constant(offset));
+        }
+        assert_eq!(a.iter().map(|x| x.0).collect::<Vec<_>>(), vec![-12, -8, -4]);
+
+        let mut b = a.clone();
+        b.insert(-8, Constant(0));
+        a.meet(&b);
+        assert_eq!(a.get(-8), None);
+        assert_eq!(a.get(-4), Some(Constant(-4)));
+        assert_eq!(a.len(), 2);
+    }
+}
@@ -0,0 +1,224 @@
+// BATCH LINTING
+// =============
+
+use std::collections::BTreeMap;
+use std::io::BufRead;
+use std::path::{Path, PathBuf};
+use std::sync::atomic::{AtomicUsize, Ordering};
+use std::sync::mpsc;
+
+/// File extensions that are linted when a directory is given as an input.
+const EXTENSIONS: [&str; 2] = ["s", "asm"];
+
+/// Collect the files to lint from the inputs on the command line.
+///
+/// Each input can be:
+/// - a file, which is linted as is,
+/// - a directory, where every assembly file in it (and its subdirectories)
+///   is linted,
+/// - a pattern with `*` or `?` in its last component, like `subs/*.s`,
+///   which lints every matching file in that directory.
+///
+/// A list of files can also be read from `files_from`, one per line, or
+/// from standard input if it is `-`. Files are returned in the order they
+/// were given, and the files of a directory or pattern are sorted by name,
+/// so the output of a batch is always in the same order.
+pub fn collect_inputs(
+    inputs: &[PathBuf],
+    files_from: Option<&Path>,
+) -> std::io::Result<Vec<PathBuf>> {
+    let mut files = Vec::new();
+    for input in inputs {
+        if input.is_dir() {
+            walk(input, &mut files)?;
+        } else if is_pattern(input) {
+            glob(input, &mut files)?;
+        } else {
+            files.push(input.clone());
+        }
+    }
+
+    if let Some(list) = files_from {
+        let lines = if list == Path::new("-") {
+            std::io::stdin()
+                .lock()
+                .lines()
+                .collect::<Result<Vec<_>, _>>()?
+        } else {
+            std::io::BufReader::new(std::fs::File::open(list)?)
+                .lines()
+                .collect::<Result<Vec<_>, _>>()?
+        };
+        files.extend(
+            lines
+                .iter()
+                .map(|x| x.trim())
+                .filter(|x| !x.is_empty())
+                .map(PathBuf::from),
+        );
+    }
+
+    Ok(files)
+}
+
+fn walk(dir: &Path, files: &mut Vec<PathBuf>) -> std::io::Result<()> {
+    let mut entries = std::fs::read_dir(dir)?
+        .map(|x| x.map(|x| x.path()))
+        .collect::<Result<Vec<_>, _>>()?;
+    entries.sort();
+
+    for entry in entries {
+        if entry.is_dir() {
+            walk(&entry, files)?;
+        } else if entry
+            .extension()
+            .and_then(|x| x.to_str())
+            .is_some_and(|x| EXTENSIONS.contains(&x))
+        {
+            files.push(entry);
+        }
+    }
+    Ok(())
+}
+
+fn is_pattern(path: &Path) -> bool {
+    path.file_name()
+        .and_then(|x| x.to_str())
+        .is_some_and(|x| x.contains(['*', '?']))
+}
+
+fn glob(pattern: &Path, files: &mut Vec<PathBuf>) -> std::io::Result<()> {
+    let dir = match pattern.parent() {
+        Some(dir) if !dir.as_os_str().is_empty() => dir,
+        _ => Path::new("."),
+    };
+    let name = pattern
+        .file_name()
+        .and_then(|x| x.to_str())
+        .unwrap_or_default();
+
+    let mut entries = std::fs::read_dir(dir)?
+        .map(|x| x.map(|x| x.path()))
+        .collect::<Result<Vec<_>, _>>()?;
+    entries.retain(|x| {
+        x.is_file()
+            && x.file_name()
+                .and_then(|x| x.to_str())
+                .is_some_and(|x| wildcard_match(name, x))
+    });
+    entries.sort();
+    files.extend(entries);
+    Ok(())
+}
+
+/// Whether `name` matches `pattern`, where `*` matches any number of
+/// characters and `?` matches exactly one.
+fn wildcard_match(pattern: &str, name: &str) -> bool {
+    let pattern = pattern.chars().collect::<Vec<_>>();
+    let name = name.chars().collect::<Vec<_>>();
+    let (mut p, mut n) = (0, 0);
+    // The position of the last `*` and the character it was matched up to
+    let mut star = None;
+
+    while n < name.len() {
+        match pattern.get(p) {
+            Some('*') => {
+                star = Some((p, n));
+                p += 1;
+            }
+            Some(&c) if c == '?' || c == name[n] => {
+                p += 1;
+                n += 1;
+            }
+            _ => match star {
+                // Let the last `*` match one more character
+                Some((sp, sn)) => {
+                    star = Some((sp, sn + 1));
+                    p = sp + 1;
+                    n = sn + 1;
+                }
+                None => return false,
+            },
+        }
+    }
+    pattern[p..].iter().all(|&c| c == '*')
+}
+
+/// Run `f` on every item on `jobs` threads, calling `emit` with each result
+/// in the order of the items.
+///
+/// Threads take the next item as soon as they finish one, so a few large
+/// files do not hold up the rest. A result is emitted as soon as it and
+/// every result before it are ready, so output streams out while the rest
+/// of the items are still being worked on.
+pub fn run_ordered<T, R, F, E>(items: &[T], jobs: usize, f: F, mut emit: E)
+where
+    T: Sync,
+    R: Send,
+    F: Fn(&T) -> R + Sync,
+    E: FnMut(&T, R),
+{
+    let jobs = jobs.clamp(1, items.len().max(1));
+    let next = AtomicUsize::new(0);
+    let (tx, rx) = mpsc::channel();
+
+    std::thread::scope(|s| {
+        for _ in 0..jobs {
+            let (tx, next, f) = (tx.clone(), &next, &f);
+            s.spawn(move || loop {
+                let index = next.fetch_add(1, Ordering::Relaxed);
+                let Some(item) = items.get(index) else {
+                    break;
+                };
+                if tx.send((index, f(item))).is_err() {
+                    break;
+                }
+            });
+        }
+        drop(tx);
+
+        let mut ready = BTreeMap::new();
+        let mut emitted = 0;
+        for (index, result) in rx {
+            ready.insert(index, result);
+            while let Some(result) = ready.remove(&emitted) {
+                emit(&items[emitted], result);
+                emitted += 1;
+            }
+        }
+    });
+}
+
+#[cfg(test)]
+mod test {
+    use super::{run_ordered, wildcard_match};
+
+    #[test]
+    fn wildcards() {
+        assert!(wildcard_match("*.s", "lab1.s"));
+        assert!(wildcard_match("lab?.s", "lab1.s"));
+        assert!(wildcard_match("*", ""));
+        assert!(wildcard_match("a*b*c", "aXbYbZc"));
+        assert!(!wildcard_match("*.s", "lab1.asm"));
+        assert!(!wildcard_match("lab?.s", "lab12.s"));
+        assert!(!wildcard_match("a*b", "aXbY"));
+    }
+
+    #[test]
+    fn results_are_in_order() {
+        let items = (0..100).collect::<Vec<u64>>();
+        let mut seen = Vec::new();
+        run_ordered(
+            &items,
+            8,
+            |&x| {
+                // Make earlier items finish later
+                std::thread::sleep(std::time::Duration::from_micros(100 - x));
+                x * 2
+            },
+            |&item, result| seen.push((item, result)),
+        );
+        let expected = items.iter().map(|&x| (x, x * 2)).collect::<Vec<_>>();
+        assert_eq!(seen, expected);
+    }
+}
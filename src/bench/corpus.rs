@@ -0,0 +1,181 @@
+use std::fmt::Write;
+
+/// The shape of a synthetic program.
+#[derive(Clone, Copy, Debug, PartialEq, Eq)]
+pub struct CorpusShape {
+    /// The number of functions, not counting `main`
+    pub functions: usize,
+    /// How many other functions each function calls
+    pub fanout: usize,
+    /// How deeply the loops in each function are nested
+    pub loops: usize,
+    /// How many files deep the chain of includes is
+    pub includes: usize,
+}
+
+impl CorpusShape {
+    /// Loop counters are kept in the saved registers after `s0`.
+    pub const MAX_LOOPS: usize = 11;
+}
+
+/// A synthetic program split over one or more files.
+///
+/// Function `i` calls the next `fanout` functions from the innermost of its
+/// loops, so the call graph has no cycles and every function is reachable
+/// from `main`. Every function saves and restores the registers it uses,
+/// like a correct submission would.
+#[derive(Clone, Debug, PartialEq, Eq)]
+pub struct Corpus {
+    /// The name and source of each file. The first file is the root, and
+    /// each file includes the one after it.
+    pub files: Vec<(String, String)>,
+}
+
+impl Corpus {
+    pub fn generate(shape: CorpusShape) -> Self {
+        let loops = shape.loops.min(CorpusShape::MAX_LOOPS);
+        let names = (0..=shape.includes)
+            .map(|i| {
+                if i == 0 {
+                    "main.s".to_owned()
+                } else {
+                    format!("part{i}.s")
+                }
+            })
+            .collect::<Vec<_>>();
+
+        let mut sources = vec![main_function(shape)];
+        sources.resize(names.len(), String::new());
+
+        // Spread the functions evenly over the files
+        let per_file = shape.functions.div_ceil(names.len()).max(1);
+        for i in 0..shape.functions {
+            let callees = (i + 1..shape.functions).take(shape.fanout);
+            function(&mut sources[i / per_file], i, loops, callees);
+        }
+        for (source, next) in sources.iter_mut().zip(names.iter().skip(1)) {
+            writeln!(source, ".include \"{next}\"").expect("writing to a string");
+        }
+
+        Corpus {
+            files: names.into_iter().zip(sources).collect(),
+        }
+    }
+
+    pub fn root(&self) -> &str {
+        &self.files[0].0
+    }
+
+    /// The number of lines over all files.
+    pub fn lines(&self) -> usize {
+        self.files.iter().map(|(_, x)| x.lines().count()).sum()
+    }
+}
+
+fn main_function(shape: CorpusShape) -> String {
+    let mut out = String::from("main:\n    li a0, 1\n");
+    // Without fanout, nothing else calls the functions
+    let roots = if shape.fanout == 0 {
+        shape.functions
+    } else {
+        shape.functions.min(1)
+    };
+    for i in 0..roots {
+        out.push_str(&format!("    call f{i}\n"));
+    }
+    out.push_str("    li a7, 1\n    ecall\n    li a7, 10\n    ecall\n\n");
+    out
+}
+
+fn function(out: &mut String, index: usize, loops: usize, callees: impl Iterator<Item = usize>) {
+    // ra, s0 and one saved register for each loop counter
+    let saved = (0..loops + 2)
+        .map(|x| match x {
+            0 => "ra".to_owned(),
+            x => format!("s{}", x - 1),
+        })
+        .collect::<Vec<_>>();
+    let frame = saved.len() * 4;
+
+    let mut lines = vec![format!("f{index}:"), format!("    addi sp, sp, -{frame}")];
+    for (slot, reg) in saved.iter().enumerate() {
+        lines.push(format!("    sw {reg}, {}(sp)", slot * 4));
+    }
+    lines.push("    mv s0, a0".to_owned());
+
+    for depth in 1..=loops {
+        lines.push(format!("    li s{depth}, 4"));
+        lines.push(format!("f{index}_loop{depth}:"));
+    }
+    lines.push("    addi s0, s0, 1".to_owned());
+    for callee in callees {
+        lines.push("    mv a0, s0".to_owned());
+        lines.push(format!("    call f{callee}"));
+        lines.push("    add s0, s0, a0".to_owned());
+    }
+    for depth in (1..=loops).rev() {
+        lines.push(format!("    addi s{depth}, s{depth}, -1"));
+        lines.push(format!("    bne s{depth}, zero, f{index}_loop{depth}"));
+    }
+
+    lines.push("    mv a0, s0".to_owned());
+    for (slot, reg) in saved.iter().enumerate() {
+        lines.push(format!("    lw {reg}, {}(sp)", slot * 4));
+    }
+    lines.push(format!("    addi sp, sp, {frame}"));
+    lines.push("    ret".to_owned());
+
+    for line in lines {
+        out.push_str(&line);
+        out.push('\n');
+    }
+    out.push('\n');
+}
+
+#[cfg(test)]
+mod test {
+    use super::{Corpus, CorpusShape};
+
+    #[test]
+    fn functions_are_split_over_includes() {
+        let shape = CorpusShape {
+            functions: 7,
+            fanout: 2,
+            loops: 2,
+            includes: 2,
+        };
+        let corpus = Corpus::generate(shape);
+        let names = corpus
+            .files
+            .iter()
+            .map(|x| x.0.as_str())
+            .collect::<Vec<_>>();
+        assert_eq!(names, vec!["main.s", "part1.s", "part2.s"]);
+        assert!(corpus.files[0].1.contains(".include \"part1.s\""));
+        assert!(!corpus.files[2].1.contains(".include"));
+        let functions = corpus
+            .files
+            .iter()
+            .flat_map(|x| x.1.lines())
+            .filter(|x| x.starts_with('f') && !x.contains("_loop") && x.ends_with(':'))
+            .count();
+        assert_eq!(functions, 7);
+    }
+
+    #[test]
+    fn loops_and_calls_are_generated() {
+        let corpus = Corpus::generate(CorpusShape {
+            functions: 3,
+            fanout: 5,
+            loops: 3,
+            includes: 0,
+        });
+        let source = &corpus.files[0].1;
+        assert!(source.contains("f0_loop3:"));
+        assert!(source.contains("call f2"));
+        // The last function has nothing after it to call
+        let last = &source[source.find("f2:").unwrap()..];
+        assert!(!last.contains("call"));
+        assert_eq!(corpus.files.len(), 1);
+    }
+}
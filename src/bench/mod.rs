@@ -0,0 +1,285 @@
+// PIPELINE BENCHMARKS
+// ===================
+
+use std::fmt::Write;
+use std::iter::Peekable;
+use std::path::Path;
+use std::time::Duration;
+
+use crate::analysis::{AvailableValuePass, FunctionSummaryPass, LivenessPass};
+use crate::cfg::Cfg;
+use crate::gen::{
+    EcallTerminationPass, EliminateDeadCodeDirectionsPass, FunctionMarkupPass, NodeDirectionPass,
+};
+use crate::lints::{Lint, LintConfig, LintEngine};
+use crate::parser::{FileId, Lexer, ParseError, RVParser};
+use crate::passes::{CFGError, GenerationPass, Stopwatch};
+use crate::reader::{FileReader, FileReaderError};
+
+mod corpus;
+pub use corpus::*;
+
+/// Reads the files of a corpus from memory, so that benchmarks do not
+/// measure the disk.
+struct CorpusReader<'a> {
+    corpus: &'a Corpus,
+}
+
+impl CorpusReader<'_> {
+    fn id(index: usize) -> FileId {
+        FileId::new(index).expect("too many files in corpus")
+    }
+}
+
+impl FileReader for CorpusReader<'_> {
+    fn import_file(
+        &mut self,
+        path: &str,
+        _in_file: Option<FileId>,
+    ) -> Result<(FileId, Peekable<Lexer>), FileReaderError> {
+        let index = self
+            .corpus
+            .files
+            .iter()
+            .position(|(name, _)| name == path)
+            .ok_or(FileReaderError::InvalidPath)?;
+        let id = CorpusReader::id(index);
+        Ok((id, Lexer::new(&self.corpus.files[index].1, id).peekable()))
+    }
+
+    fn get_filename(&self, id: FileId) -> Option<String> {
+        self.corpus.files.get(id.index()).map(|x| x.0.clone())
+    }
+}
+
+/// How long one stage of the pipeline took, and what it allocated.
+///
+/// Allocations are only counted when built with the `bench` feature, which
+/// installs a counting allocator. Counting adds a little to every stage's time.
+#[derive(Clone, Debug, PartialEq, Eq)]
+pub struct Stage {
+    pub name: String,
+    pub time: Duration,
+    pub allocations: Option<usize>,
+    pub peak_bytes: Option<usize>,
+}
+
+#[cfg(feature = "bench")]
+fn allocations<T>(f: impl FnOnce() -> T) -> (T, Option<(usize, usize)>) {
+    let (res, stats) = crate::helpers::measure_allocations(f);
+    (res, Some((stats.allocations, stats.peak_bytes)))
+}
+
+#[cfg(not(feature = "bench"))]
+fn allocations<T>(f: impl FnOnce() -> T) -> (T, Option<(usize, usize)>) {
+    (f(), None)
+}
+
+fn measure<T>(stages: &mut Vec<Stage>, name: &str, f: impl FnOnce() -> T) -> T {
+    let start = Stopwatch::start();
+    let (res, stats) = allocations(f);
+    stages.push(Stage {
+        name: name.to_owned(),
+        time: start.elapsed(),
+        allocations: stats.map(|x| x.0),
+        peak_bytes: stats.map(|x| x.1),
+    });
+    res
+}
+
+/// Run the generation passes in the same order as `Manager`, measuring
+/// each one.
+fn generate(stages: &mut Vec<Stage>, cfg: &mut Cfg) -> Result<(), Box<CFGError>> {
+    measure(stages, "NodeDirectionPass", || NodeDirectionPass::run(cfg))?;
+    measure(stages, "EliminateDeadCodeDirectionsPass", || {
+        EliminateDeadCodeDirectionsPass::run(cfg)
+    })?;
+    measure(stages, "FunctionMarkupPass", || {
+        FunctionMarkupPass::run(cfg)
+    })?;
+    measure(stages, "AvailableValuePass", || {
+        AvailableValuePass::run(cfg)
+    })?;
+    measure(stages, "EcallTerminationPass", || {
+        EcallTerminationPass::run(cfg)
+    })?;
+    measure(stages, "LivenessPass", || LivenessPass::run(cfg))?;
+    measure(stages, "FunctionSummaryPass", || {
+        FunctionSummaryPass::run(cfg)
+    })?;
+    Ok(())
+}
+
+/// Run the whole pipeline on a corpus once, measuring every stage.
+///
+/// Returns the stages along with the generated graph.
+pub fn run_pipeline(corpus: &Corpus) -> Result<(Vec<Stage>, Cfg), Box<CFGError>> {
+    let mut stages = Vec::new();
+
+    measure(&mut stages, "Lexer", || {
+        for (i, (_, source)) in corpus.files.iter().enumerate() {
+            Lexer::new(source, CorpusReader::id(i)).for_each(drop);
+        }
+    });
+    let (nodes, _): (_, Vec<ParseError>) = measure(&mut stages, "RVParser::parse", || {
+        RVParser::new(CorpusReader { corpus }).parse(corpus.root(), false)
+    });
+    let mut cfg = measure(&mut stages, "Cfg::new", || Cfg::new(nodes))?;
+    generate(&mut stages, &mut cfg)?;
+
+    // Each lint is run by itself, so that its time is not mixed with the
+    // others. Together they take longer than the engine's shared walk.
+    for lint in Lint::ALL {
+        let mut config = LintConfig::none();
+        config.enable(lint);
+        let engine = LintEngine::new(&config);
+        measure(&mut stages, &format!("lint {lint}"), || engine.run(&cfg));
+    }
+    Ok((stages, cfg))
+}
+
+/// Run the pipeline `iterations` times, keeping the fastest time of each
+/// stage.
+pub fn best_of(corpus: &Corpus, iterations: usize) -> Result<(Vec<Stage>, Cfg), Box<CFGError>> {
+    let (mut best, mut cfg) = run_pipeline(corpus)?;
+    for _ in 1..iterations {
+        let (stages, next) = run_pipeline(corpus)?;
+        for (best, stage) in best.iter_mut().zip(stages) {
+            best.time = best.time.min(stage.time);
+        }
+        cfg = next;
+    }
+    Ok((best, cfg))
+}
+
+/// The peak resident memory of the process, in bytes, if it is known.
+pub fn peak_rss() -> Option<usize> {
+    let status = std::fs::read_to_string("/proc/self/status").ok()?;
+    let line = status.lines().find(|x| x.starts_with("VmHWM:"))?;
+    let kb = line.split_whitespace().nth(1)?.parse::<usize>().ok()?;
+    Some(kb * 1024)
+}
+
+fn or_dash(value: Option<usize>) -> String {
+    value.map_or_else(|| "-".to_owned(), |x| x.to_string())
+}
+
+/// Measure every shape and format the results, either as a table for each
+/// shape or as comma separated values for plotting.
+pub fn report(
+    shapes: &[CorpusShape],
+    iterations: usize,
+    csv: bool,
+) -> Result<String, Box<CFGError>> {
+    let mut out = String::new();
+    if csv {
+        out.push_str("functions,fanout,loops,includes,nodes,stage,micros,allocations,peak_bytes\n");
+    }
+
+    for &shape in shapes {
+        let corpus = Corpus::generate(shape);
+        let (stages, cfg) = best_of(&corpus, iterations.max(1))?;
+        let total = stages.iter().map(|x| x.time).sum::<Duration>();
+        let CorpusShape {
+            functions,
+            fanout,
+            loops,
+            includes,
+        } = shape;
+        let nodes = cfg.nodes.len();
+
+        if csv {
+            for stage in &stages {
+                let _ = writeln!(
+                    out,
+                    "{functions},{fanout},{loops},{includes},{nodes},{},{},{},{}",
+                    stage.name,
+                    stage.time.as_micros(),
+                    or_dash(stage.allocations),
+                    or_dash(stage.peak_bytes),
+                );
+            }
+            continue;
+        }
+
+        let _ = writeln!(
+            out,
+            "functions={functions} fanout={fanout} loops={loops} includes={includes} \
+             lines={} nodes={nodes}",
+            corpus.lines()
+        );
+        let _ = writeln!(
+            out,
+            "  {:<36} {:>12} {:>12} {:>14}",
+            "stage", "time (us)", "allocations", "peak bytes"
+        );
+        for stage in &stages {
+            let _ = writeln!(
+                out,
+                "  {:<36} {:>12} {:>12} {:>14}",
+                stage.name,
+                stage.time.as_micros(),
+                or_dash(stage.allocations),
+                or_dash(stage.peak_bytes),
+            );
+        }
+        let _ = writeln!(out, "  {:<36} {:>12}", "total", total.as_micros());
+        out.push('\n');
+    }
+
+    if !csv {
+        let _ = writeln!(out, "peak rss: {}", or_dash(peak_rss()));
+    }
+    Ok(out)
+}
+
+/// Write the files of a corpus to `dir`, so that they can be linted.
+pub fn write_corpus(corpus: &Corpus, dir: &Path) -> std::io::Result<()> {
+    std::fs::create_dir_all(dir)?;
+    for (name, source) in &corpus.files {
+        std::fs::write(dir.join(name), source)?;
+    }
+    Ok(())
+}
+
+#[cfg(test)]
+mod test {
+    use super::{run_pipeline, CorpusReader};
+    use super::{Corpus, CorpusShape};
+    use crate::cfg::Cfg;
+    use crate::lints::Lint;
+    use crate::parser::RVParser;
+    use crate::passes::Manager;
+
+    fn corpus() -> Corpus {
+        Corpus::generate(CorpusShape {
+            functions: 12,
+            fanout: 2,
+            loops: 2,
+            includes: 2,
+        })
+    }
+
+    #[test]
+    fn corpus_parses_through_includes() {
+        let corpus = corpus();
+        let (nodes, errors) =
+            RVParser::new(CorpusReader { corpus: &corpus }).parse("main.s", false);
+        assert!(errors.is_empty());
+        let cfg = Manager::gen_full_cfg(Cfg::new(nodes).unwrap()).unwrap();
+        assert_eq!(cfg.summaries.len(), 12);
+    }
+
+    #[test]
+    fn stages_match_the_manager() {
+        let corpus = corpus();
+        let (stages, cfg) = run_pipeline(&corpus).unwrap();
+        let (nodes, _) = RVParser::new(CorpusReader { corpus: &corpus }).parse("main.s", false);
+        let expected = Manager::gen_full_cfg(Cfg::new(nodes).unwrap()).unwrap();
+        assert_eq!(cfg.to_string(), expected.to_string());
+
+        let names = stages.iter().map(|x| x.name.as_str()).collect::<Vec<_>>();
+        assert_eq!(names[..3], ["Lexer", "RVParser::parse", "Cfg::new"]);
+        assert_eq!(stages.len(), 3 + 7 + Lint::ALL.len());
+    }
+}
@@ -0,0 +1,71 @@
+use std::ops::{Index, IndexMut};
+
+use smallvec::SmallVec;
+
+/// The index of a node in the graph.
+///
+/// Nodes are stored in an arena (`Cfg::nodes`) in program order, so a node
+/// can be referred to by its position. This is what edges and analysis
+/// tables are keyed by, instead of hashing the node itself.
+#[derive(Clone, Copy, Debug, PartialEq, Eq, Hash, PartialOrd, Ord)]
+pub struct NodeId(u32);
+
+impl NodeId {
+    pub fn new(index: usize) -> Self {
+        NodeId(u32::try_from(index).expect("too many nodes in graph"))
+    }
+
+    #[inline(always)]
+    pub fn index(self) -> usize {
+        self.0 as usize
+    }
+}
+
+/// List of edges out of (or into) a node.
+///
+/// Almost every node has at most two successors (fall through and a jump),
+/// so these are stored inline without a heap allocation.
+pub type NodeIds = SmallVec<[NodeId; 2]>;
+
+/// A table with one entry for every node in the graph, indexed by `NodeId`.
+///
+/// Analyses keep their facts in these tables, one table per fact, so that
+/// looping over a single fact of all nodes is a linear scan of memory.
+#[derive(Clone, Debug, Default, PartialEq, Eq)]
+pub struct NodeTable<T>(Vec<T>);
+
+impl<T: Clone> NodeTable<T> {
+    pub fn new(len: usize, value: T) -> Self {
+        NodeTable(vec![value; len])
+    }
+}
+
+impl<T> NodeTable<T> {
+    pub fn len(&self) -> usize {
+        self.0.len()
+    }
+
+    pub fn is_empty(&self) -> bool {
+        self.0.is_empty()
+    }
+
+    pub fn iter(&self) -> impl Iterator<Item = (NodeId, &T)> {
+        self.0.iter().enumerate().map(|(i, x)| (NodeId::new(i), x))
+    }
+}
+
+impl<T> Index<NodeId> for NodeTable<T> {
+    type Output = T;
+
+    #[inline(always)]
+    fn index(&self, id: NodeId) -> &Self::Output {
+        &self.0[id.index()]
+    }
+}
+
+impl<T> IndexMut<NodeId> for NodeTable<T> {
+    #[inline(always)]
+    fn index_mut(&mut self, id: NodeId) -> &mut Self::Output {
+        &mut self.0[id.index()]
+    }
+}
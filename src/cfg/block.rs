@@ -0,0 +1,205 @@
+use std::ops::Range;
+
+use smallvec::SmallVec;
+
+use super::{CFGNode, Cfg, NodeId, NodeTable};
+
+/// The index of a basic block in `BasicBlocks::blocks`.
+#[derive(Clone, Copy, Debug, PartialEq, Eq, Hash, PartialOrd, Ord)]
+pub struct BlockId(u32);
+
+impl BlockId {
+    pub fn new(index: usize) -> Self {
+        BlockId(u32::try_from(index).expect("too many blocks in graph"))
+    }
+
+    #[inline(always)]
+    pub fn index(self) -> usize {
+        self.0 as usize
+    }
+}
+
+pub type BlockIds = SmallVec<[BlockId; 2]>;
+
+/// A maximal straight-line run of nodes.
+///
+/// Control can only enter a block at its first node (the head) and only
+/// leave it at its last node (the tail). The nodes of a block are always
+/// next to each other in program order, so they are stored as a range of
+/// node ids.
+#[derive(Clone, Debug, PartialEq, Eq)]
+pub struct BasicBlock {
+    nodes: Range<u32>,
+    pub nexts: BlockIds,
+    pub prevs: BlockIds,
+}
+
+impl BasicBlock {
+    #[inline(always)]
+    pub fn head(&self) -> NodeId {
+        NodeId::new(self.nodes.start as usize)
+    }
+
+    #[inline(always)]
+    pub fn tail(&self) -> NodeId {
+        NodeId::new(self.nodes.end as usize - 1)
+    }
+
+    /// The nodes of the block, from head to tail.
+    #[inline(always)]
+    pub fn nodes(&self) -> impl DoubleEndedIterator<Item = NodeId> + ExactSizeIterator {
+        self.nodes.clone().map(|x| NodeId::new(x as usize))
+    }
+
+    pub fn len(&self) -> usize {
+        self.nodes.len()
+    }
+
+    /// Whether the block contains a single node.
+    pub fn is_single(&self) -> bool {
+        self.nodes.len() == 1
+    }
+}
+
+/// The basic blocks of a graph.
+///
+/// Blocks are calculated from the edges of the graph at the time they are
+/// created, so they need to be recalculated after a pass changes the edges.
+#[derive(Clone, Debug, PartialEq, Eq)]
+pub struct BasicBlocks {
+    pub blocks: Vec<BasicBlock>,
+    block_of: NodeTable<BlockId>,
+}
+
+impl BasicBlocks {
+    pub fn new(cfg: &Cfg) -> Self {
+        let mut blocks: Vec<BasicBlock> = Vec::new();
+        let mut block_of = NodeTable::new(cfg.nodes.len(), BlockId(0));
+
+        let mut prev: Option<&CFGNode> = None;
+        for node in cfg {
+            let continues = prev.is_some_and(|prev| {
+                !stands_alone(prev)
+                    && !stands_alone(node)
+                    && prev.nexts().as_slice() == [node.id()]
+                    && node.prevs().as_slice() == [prev.id()]
+            });
+
+            let index = node.id().index() as u32;
+            match blocks.last_mut() {
+                Some(block) if continues => block.nodes.end = index + 1,
+                _ => blocks.push(BasicBlock {
+                    nodes: index..index + 1,
+                    nexts: BlockIds::new(),
+                    prevs: BlockIds::new(),
+                }),
+            }
+            block_of[node.id()] = BlockId::new(blocks.len() - 1);
+            prev = Some(node);
+        }
+
+        // Block edges are the edges out of the tail and into the head
+        for block in &mut blocks {
+            block.nexts = cfg
+                .node(block.tail())
+                .nexts()
+                .iter()
+                .map(|&x| block_of[x])
+                .collect();
+            block.prevs = cfg
+                .node(block.head())
+                .prevs()
+                .iter()
+                .map(|&x| block_of[x])
+                .collect();
+        }
+
+        BasicBlocks { blocks, block_of }
+    }
+
+    #[inline(always)]
+    pub fn block(&self, id: BlockId) -> &BasicBlock {
+        &self.blocks[id.index()]
+    }
+
+    /// The block that contains a node.
+    #[inline(always)]
+    pub fn block_of(&self, node: NodeId) -> BlockId {
+        self.block_of[node]
+    }
+
+    pub fn len(&self) -> usize {
+        self.blocks.len()
+    }
+
+    pub fn is_empty(&self) -> bool {
+        self.blocks.is_empty()
+    }
+
+    pub fn ids(&self) -> impl Iterator<Item = BlockId> {
+        (0..self.blocks.len()).map(BlockId::new)
+    }
+}
+
+/// Whether a node is always a block by itself.
+///
+/// The analyses have special transfer functions for these nodes, usually
+/// because they depend on some other part of the graph (for example, the
+/// function that is called). Keeping them on their own means every other
+/// block can be summarised by its gen and kill sets.
+fn stands_alone(node: &CFGNode) -> bool {
+    let node = node.node();
+    node.is_any_entry() || node.is_return() || node.is_ecall() || node.calls_to().is_some()
+}
+
+#[cfg(test)]
+mod test {
+    use super::BasicBlocks;
+    use crate::helpers::{analyse, FACTORIAL_PROGRAM};
+
+    #[test]
+    fn blocks_cover_all_nodes() {
+        let cfg = analyse(FACTORIAL_PROGRAM);
+        let blocks = BasicBlocks::new(&cfg);
+
+        assert!(blocks.len() < cfg.nodes.len());
+        let mut covered = 0;
+        for id in blocks.ids() {
+            let block = blocks.block(id);
+            for node in block.nodes() {
+                assert_eq!(blocks.block_of(node), id);
+            }
+            covered += block.len();
+        }
+        assert_eq!(covered, cfg.nodes.len());
+    }
+
+    #[test]
+    fn calls_stand_alone() {
+        let cfg = analyse(FACTORIAL_PROGRAM);
+        let blocks = BasicBlocks::new(&cfg);
+
+        for node in &cfg.nodes {
+            if node.node().calls_to().is_some() || node.node().is_ecall() {
+                assert!(blocks.block(blocks.block_of(node.id())).is_single());
+            }
+        }
+    }
+
+    #[test]
+    fn edges_match_nodes() {
+        let cfg = analyse(FACTORIAL_PROGRAM);
+        let blocks = BasicBlocks::new(&cfg);
+
+        for id in blocks.ids() {
+            let block = blocks.block(id);
+            for next in &block.nexts {
+                assert!(blocks.block(*next).prevs.contains(&id));
+            }
+            // Only the head and tail have edges outside of the block
+            for node in block.nodes().skip(1) {
+                assert_eq!(cfg.node(node).prevs().len(), 1);
+            }
+        }
+    }
+}
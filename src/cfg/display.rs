@@ -5,7 +5,9 @@ use std::{
 
 use itertools::Itertools;
 
-use super::{CFGNode, Cfg};
+use crate::parser::RegSet;
+
+use super::Cfg;
 
 pub trait SetListString {
     fn str(&self) -> String;
@@ -24,6 +26,16 @@ where
     }
 }
 
+impl SetListString for RegSet {
+    fn str(&self) -> String {
+        self.iter()
+            .map(|x| x.to_string())
+            .sorted()
+            .collect::<Vec<_>>()
+            .join(", ")
+    }
+}
+
 impl<T, U> SetListString for HashMap<T, U>
 where
     T: Display,
@@ -38,25 +50,28 @@ where
     }
 }
 
-impl Display for CFGNode {
-    fn fmt(&self, f: &mut std::fmt::Formatter<'_>) -> std::fmt::Result {
-        f.write_fmt(format_args!("{}\n", self.node()))?;
-        f.write_fmt(format_args!("  | LIVE | {}\n", self.live_out().str()))?;
-        f.write_fmt(format_args!("  | VALS | {}\n", self.reg_values_out().str()))?;
-        f.write_fmt(format_args!(
-            "  | STCK | {}\n",
-            self.stack_values_out().str()
-        ))?;
-        f.write_fmt(format_args!("  | UDEF | {}\n", self.u_def().str()))?;
-
-        Ok(())
-    }
-}
-
 impl Display for Cfg {
     fn fmt(&self, f: &mut std::fmt::Formatter<'_>) -> std::fmt::Result {
         for node in &self.nodes {
-            f.write_fmt(format_args!("{}\n", node))?;
+            let id = node.id();
+            f.write_fmt(format_args!("{}\n", node.node()))?;
+            f.write_fmt(format_args!(
+                "  | LIVE | {}\n",
+                self.liveness.live_out[id].str()
+            ))?;
+            f.write_fmt(format_args!(
+                "  | VALS | {}\n",
+                node.reg_values_out().str(&self.labels)
+            ))?;
+            f.write_fmt(format_args!(
+                "  | STCK | {}\n",
+                node.stack_values_out().str(&self.labels)
+            ))?;
+            f.write_fmt(format_args!(
+                "  | UDEF | {}\n",
+                self.liveness.u_def[id].str()
+            ))?;
+            f.write_fmt(format_args!("\n"))?;
         }
         Ok(())
     }
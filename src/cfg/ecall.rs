@@ -1,54 +1,81 @@
-use std::collections::HashSet;
+use crate::parser::RegSet;
 
-use crate::parser::Register;
+/// The highest call number in `SIGNATURES`. Call 1024 is looked up on its
+/// own, so that the table stays small.
+const LAST_CALL: usize = 93;
 
-#[allow(clippy::match_same_arms)]
-pub fn environment_in_outs(call_num: i32) -> Option<(HashSet<Register>, HashSet<Register>)> {
+/// The registers that each environment call reads and writes, indexed by
+/// its call number, or `None` for calls that are not known.
+///
+/// The table is built at compile time, so looking up a call, which the
+/// liveness analysis does for every ecall on every iteration, is a single
+/// index.
+const SIGNATURES: [Option<(RegSet, RegSet)>; LAST_CALL + 1] = {
     use crate::parser::Register::{X10, X11, X12, X13};
-    let vecs = match call_num {
-        1 => (vec![X10], vec![]),
-        // 2 => (vec![], vec![]), Not supporting floating point yet
-        // 3 => (vec![], vec![]),
-        4 => (vec![X10], vec![]),
-        5 => (vec![], vec![X10]),
-        // 6 => (vec![], vec![]),
-        // 7 => (vec![], vec![]),
-        8 => (vec![X10, X11], vec![]),
-        9 => (vec![X10], vec![X10]),
-        10 => (vec![], vec![]),
-        11 => (vec![X10], vec![]),
-        12 => (vec![], vec![X10]),
-        17 => (vec![X10, X11], vec![X10]),
-        30 => (vec![], vec![X10, X11]),
-        31 => (vec![X10, X11, X12, X13], vec![]),
-        32 => (vec![X10], vec![]),
-        33 => (vec![X10, X11, X12, X13], vec![]),
-        34 => (vec![X10], vec![]),
-        35 => (vec![X10], vec![]),
-        36 => (vec![X10], vec![]),
-        40 => (vec![X10, X11], vec![]),
-        41 => (vec![X10], vec![X10]),
-        42 => (vec![X10, X11], vec![X10]),
-        43 => (vec![X10], vec![X10]),
-        // 44 => (vec![X10], vec![]),
-        50 => (vec![X10], vec![X10]),
-        54 => (vec![X10, X11, X12], vec![X11]),
-        55 => (vec![X10], vec![]),
-        56 => (vec![X10, X11], vec![]),
-        57 => (vec![X10], vec![]),
-        // 58 => (vec![X10], vec![]),
-        59 => (vec![X10, X11], vec![]),
-        // 60 => (vec![X10], vec![]),
-        62 => (vec![X10, X11, X12], vec![X10]),
-        63 => (vec![X10, X11, X12], vec![X10]),
-        64 => (vec![X10, X11, X12], vec![X10]),
-        93 => (vec![X10], vec![]),
-        1024 => (vec![X10, X11], vec![X10]),
-        _ => return None,
-    };
+    let set = RegSet::from_regs;
+    let mut table = [None; LAST_CALL + 1];
+    table[1] = Some((set(&[X10]), RegSet::EMPTY));
+    // 2 and 3 are not supported, as there is no floating point yet
+    table[4] = Some((set(&[X10]), RegSet::EMPTY));
+    table[5] = Some((RegSet::EMPTY, set(&[X10])));
+    // 6 and 7 are floating point too
+    table[8] = Some((set(&[X10, X11]), RegSet::EMPTY));
+    table[9] = Some((set(&[X10]), set(&[X10])));
+    table[10] = Some((RegSet::EMPTY, RegSet::EMPTY));
+    table[11] = Some((set(&[X10]), RegSet::EMPTY));
+    table[12] = Some((RegSet::EMPTY, set(&[X10])));
+    table[17] = Some((set(&[X10, X11]), set(&[X10])));
+    table[30] = Some((RegSet::EMPTY, set(&[X10, X11])));
+    table[31] = Some((set(&[X10, X11, X12, X13]), RegSet::EMPTY));
+    table[32] = Some((set(&[X10]), RegSet::EMPTY));
+    table[33] = Some((set(&[X10, X11, X12, X13]), RegSet::EMPTY));
+    table[34] = Some((set(&[X10]), RegSet::EMPTY));
+    table[35] = Some((set(&[X10]), RegSet::EMPTY));
+    table[36] = Some((set(&[X10]), RegSet::EMPTY));
+    table[40] = Some((set(&[X10, X11]), RegSet::EMPTY));
+    table[41] = Some((set(&[X10]), set(&[X10])));
+    table[42] = Some((set(&[X10, X11]), set(&[X10])));
+    table[43] = Some((set(&[X10]), set(&[X10])));
+    // 44 => (set(&[X10]), RegSet::EMPTY),
+    table[50] = Some((set(&[X10]), set(&[X10])));
+    table[54] = Some((set(&[X10, X11, X12]), set(&[X11])));
+    table[55] = Some((set(&[X10]), RegSet::EMPTY));
+    table[56] = Some((set(&[X10, X11]), RegSet::EMPTY));
+    table[57] = Some((set(&[X10]), RegSet::EMPTY));
+    // 58 => (set(&[X10]), RegSet::EMPTY),
+    table[59] = Some((set(&[X10, X11]), RegSet::EMPTY));
+    // 60 => (set(&[X10]), RegSet::EMPTY),
+    table[62] = Some((set(&[X10, X11, X12]), set(&[X10])));
+    table[63] = Some((set(&[X10, X11, X12]), set(&[X10])));
+    table[64] = Some((set(&[X10, X11, X12]), set(&[X10])));
+    table[93] = Some((set(&[X10]), RegSet::EMPTY));
+    table
+};
 
-    Some((
-        vecs.0.into_iter().collect::<HashSet<_>>(),
-        vecs.1.into_iter().collect::<HashSet<_>>(),
-    ))
+pub fn environment_in_outs(call_num: i32) -> Option<(RegSet, RegSet)> {
+    use crate::parser::Register::{X10, X11};
+    if call_num == 1024 {
+        return Some((RegSet::from_regs(&[X10, X11]), RegSet::from_regs(&[X10])));
+    }
+    SIGNATURES
+        .get(usize::try_from(call_num).ok()?)
+        .copied()
+        .flatten()
+}
+
+#[cfg(test)]
+mod test {
+    use super::environment_in_outs;
+    use crate::parser::{RegSet, Register};
+
+    #[test]
+    fn calls_are_looked_up_by_number() {
+        let a0 = RegSet::single(Register::X10);
+        assert_eq!(environment_in_outs(5), Some((RegSet::EMPTY, a0)));
+        assert_eq!(environment_in_outs(93), Some((a0, RegSet::EMPTY)));
+        assert_eq!(environment_in_outs(1024).map(|x| x.1), Some(a0));
+        for unknown in [-1, 0, 2, 94, 1000] {
+            assert_eq!(environment_in_outs(unknown), None);
+        }
+    }
 }
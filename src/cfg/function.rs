@@ -1,11 +1,9 @@
 use std::{collections::HashSet, rc::Rc};
 
-use crate::{
-    analysis::CustomClonedSets,
-    parser::{LabelString, RegSets, Register, With},
-};
+use crate::parser::{LabelString, RegSet, With};
 
 use super::CFGNode;
+use super::Cfg;
 
 #[derive(Debug, PartialEq, Eq)]
 pub struct Function {
@@ -21,15 +19,15 @@ impl Function {
     }
 
     #[inline(always)]
-    pub fn labels(&self) -> HashSet<With<LabelString>> {
+    pub fn labels(&self) -> &HashSet<With<LabelString>> {
         self.entry.labels()
     }
 
-    pub fn arguments(&self) -> HashSet<Register> {
-        self.entry.live_in().intersection_c(&RegSets::argument())
+    pub fn arguments(&self, cfg: &Cfg) -> RegSet {
+        cfg.summary(self).arguments
     }
 
-    pub fn returns(&self) -> HashSet<Register> {
-        self.exit.live_in().intersection_c(&RegSets::ret())
+    pub fn returns(&self, cfg: &Cfg) -> RegSet {
+        cfg.summary(self).returns
     }
 }
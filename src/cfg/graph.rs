@@ -1,4 +1,6 @@
-use crate::parser;
+use crate::analysis::FunctionSummary;
+use crate::analysis::LivenessTable;
+use crate::analysis::NextUseTable;
 use crate::parser::LabelString;
 use crate::parser::LineDisplay;
 use crate::parser::ParserNode;
@@ -10,69 +12,85 @@ use std::rc::Rc;
 
 use super::CFGNode;
 use super::Function;
+use super::LabelTable;
+use super::NodeId;
+use super::NodeTable;
 
 #[derive(Debug, PartialEq, Eq, Clone)]
 pub struct Cfg {
+    /// All nodes of the graph in program order. The position of a node in
+    /// this list is its `NodeId`.
     pub nodes: Vec<Rc<CFGNode>>,
-    pub label_node_map: HashMap<String, Rc<CFGNode>>,
+    pub labels: LabelTable,
     pub label_function_map: HashMap<With<LabelString>, Rc<Function>>,
+    pub liveness: LivenessTable,
+    /// Whether each node can be reached from an entry. Every node is
+    /// reachable until the graph's edges are calculated.
+    pub reachable: NodeTable<bool>,
+    /// The summary of each function, by the id of its entry.
+    pub summaries: HashMap<NodeId, FunctionSummary>,
+    pub next_uses: NextUseTable,
 }
 
-impl IntoIterator for &Cfg {
-    type Item = Rc<CFGNode>;
-    type IntoIter = std::vec::IntoIter<Self::Item>;
-
-    // nested iterator for blocks
-    fn into_iter(self) -> Self::IntoIter {
-        self.nodes.clone().into_iter()
-    }
-}
-
-trait BaseCFGGen {
-    fn call_names(&self) -> HashSet<With<LabelString>>;
-    fn jump_names(&self) -> HashSet<With<LabelString>>;
-    fn label_names(&self) -> HashSet<With<LabelString>>;
+/// The facts that the passes keep about every node of a graph, which can
+/// be freed once nothing will read them again.
+#[derive(Clone, Copy, Debug, PartialEq, Eq, Hash)]
+pub enum Facts {
+    /// The values on the stack going into and out of each node
+    StackValues,
+    /// The values in the registers going into and out of each node
+    RegValues,
+    /// The registers that are live at each node, and their next uses
+    Liveness,
 }
 
-impl BaseCFGGen for Vec<ParserNode> {
-    fn call_names(&self) -> HashSet<With<LabelString>> {
-        self.iter()
-            .filter_map(parser::ParserNode::calls_to)
-            .collect()
-    }
-
-    fn jump_names(&self) -> HashSet<With<LabelString>> {
-        self.iter()
-            .filter_map(parser::ParserNode::jumps_to)
-            .collect()
-    }
+impl<'a> IntoIterator for &'a Cfg {
+    type Item = &'a Rc<CFGNode>;
+    type IntoIter = std::slice::Iter<'a, Rc<CFGNode>>;
 
-    fn label_names(&self) -> HashSet<With<LabelString>> {
-        self.iter()
-            .filter_map(|x| match x {
-                ParserNode::Label(s) => Some(s.name.clone()),
-                _ => None,
-            })
-            .collect()
+    fn into_iter(self) -> Self::IntoIter {
+        self.nodes.iter()
     }
 }
+
 impl Cfg {
     pub fn new(old_nodes: Vec<ParserNode>) -> Result<Cfg, Box<CFGError>> {
-        let mut labels = HashMap::new();
+        let mut labels = LabelTable::default();
         let mut nodes = Vec::new();
         let mut current_labels = HashSet::new();
+        let mut current_ids = Vec::new();
         let mut all_labels = HashSet::new();
 
-        let label_names = old_nodes.label_names();
-        let call_names = old_nodes.call_names();
-        let jump_names = old_nodes.jump_names();
+        // Find the labels that are defined and the labels that are called,
+        // along with the first use of every label
+        let mut defined = HashSet::new();
+        let mut called = HashSet::new();
+        let mut first_call = HashMap::new();
+        let mut first_jump = HashMap::new();
+        for node in &old_nodes {
+            if let ParserNode::Label(s) = node {
+                defined.insert(labels.intern(&s.name.data));
+            } else if let Some(name) = node.calls_to() {
+                let id = labels.intern(&name.data);
+                called.insert(id);
+                first_call.entry(id).or_insert(name);
+            } else if let Some(name) = node.jumps_to() {
+                first_jump.entry(labels.intern(&name.data)).or_insert(name);
+            }
+        }
 
         // Check if any call or jump names are not defined
-        let undefined_labels = call_names
-            .union(&jump_names)
-            .filter(|x| !label_names.contains(x))
-            .cloned()
+        let mut undefined_labels = first_call
+            .iter()
+            .filter(|(id, _)| !defined.contains(*id))
+            .map(|(_, name)| name.clone())
             .collect::<HashSet<With<LabelString>>>();
+        undefined_labels.extend(
+            first_jump
+                .into_iter()
+                .filter(|(id, _)| !defined.contains(id) && !first_call.contains_key(id))
+                .map(|(_, name)| name),
+        );
         if !undefined_labels.is_empty() {
             return Err(Box::new(CFGError::LabelsNotDefined(undefined_labels)));
         }
@@ -84,61 +102,97 @@ impl Cfg {
         for node in old_nodes {
             match node {
                 ParserNode::Label(s) => {
-                    current_labels.insert(s.name.clone());
+                    let id = labels.intern(&s.name.data);
 
                     // Check for duplicate labels
-                    if !all_labels.insert(s.name.clone()) {
+                    if !all_labels.insert(id) {
                         return Err(Box::new(CFGError::DuplicateLabel(s.name)));
                     }
+
+                    current_labels.insert(s.name);
+                    current_ids.push(id);
                 }
                 _ => {
                     // If any of the labels are a function call, add a function entry node
-                    if current_labels
-                        .clone()
-                        .intersection(&call_names)
-                        .next()
-                        .is_some()
-                    {
-                        let rc_node = Rc::new(CFGNode::new(
-                            ParserNode::new_func_entry(node.file()),
-                            current_labels.clone(),
-                        ));
-
-                        // Add the node to the graph
-                        nodes.push(Rc::clone(&rc_node));
-
-                        // Add the node to the labels map
-                        for label in current_labels.clone() {
-                            labels.insert(label.data.0.clone(), Rc::clone(&rc_node));
+                    if current_ids.iter().any(|x| called.contains(x)) {
+                        let entry = ParserNode::new_func_entry(node.file());
+                        labels.push_node(&entry);
+                        for &id in &current_ids {
+                            labels.define(id, NodeId::new(nodes.len()));
                         }
 
-                        // Clear the current labels
-                        current_labels.clear();
-
                         // Add the node to the graph
-                        nodes.push(Rc::new(CFGNode::new(node, HashSet::new())));
+                        nodes.push(Rc::new(CFGNode::new(
+                            NodeId::new(nodes.len()),
+                            entry,
+                            std::mem::take(&mut current_labels),
+                        )));
+
+                        labels.push_node(&node);
+                        nodes.push(Rc::new(CFGNode::new(
+                            NodeId::new(nodes.len()),
+                            node,
+                            HashSet::new(),
+                        )));
                     } else {
-                        let rc_node = Rc::new(CFGNode::new(node.clone(), current_labels.clone()));
-
-                        // Add the node to the graph
-                        nodes.push(Rc::clone(&rc_node));
-
-                        // Add the node to the labels map
-                        for label in current_labels.clone() {
-                            labels.insert(label.data.0.clone(), Rc::clone(&rc_node));
+                        labels.push_node(&node);
+                        for &id in &current_ids {
+                            labels.define(id, NodeId::new(nodes.len()));
                         }
 
-                        // Clear the current labels
-                        current_labels.clear();
+                        // Add the node to the graph
+                        nodes.push(Rc::new(CFGNode::new(
+                            NodeId::new(nodes.len()),
+                            node,
+                            std::mem::take(&mut current_labels),
+                        )));
                     }
+
+                    // Clear the current labels
+                    current_ids.clear();
                 }
             }
         }
 
         Ok(Cfg {
+            liveness: LivenessTable::new(nodes.len()),
+            reachable: NodeTable::new(nodes.len(), true),
             nodes,
+            labels,
             label_function_map: HashMap::new(),
-            label_node_map: labels,
+            summaries: HashMap::new(),
+            next_uses: NextUseTable::default(),
         })
     }
+
+    /// Free the facts about every node, for a graph that is too large to
+    /// keep them all. Anything that reads them afterwards finds nothing
+    /// known, as if the passes that made them had not run.
+    ///
+    /// Liveness is kept as a table of empty sets, so that it can still be
+    /// read for every node.
+    pub fn free(&mut self, facts: Facts) {
+        match facts {
+            Facts::StackValues => self.nodes.iter().for_each(|x| x.clear_stack_values()),
+            Facts::RegValues => self.nodes.iter().for_each(|x| x.clear_reg_values()),
+            Facts::Liveness => {
+                self.liveness = LivenessTable::new(self.nodes.len());
+                self.next_uses = NextUseTable::default();
+            }
+        }
+    }
+
+    /// The summary of a function, calculating it if the summaries have not
+    /// been generated yet.
+    pub fn summary(&self, func: &Function) -> FunctionSummary {
+        self.summaries
+            .get(&func.entry.id())
+            .copied()
+            .unwrap_or_else(|| FunctionSummary::new(self, func))
+    }
+
+    #[inline(always)]
+    pub fn node(&self, id: NodeId) -> &Rc<CFGNode> {
+        &self.nodes[id.index()]
+    }
 }
@@ -0,0 +1,167 @@
+use std::collections::HashMap;
+use std::rc::Rc;
+
+use crate::parser::{LabelString, ParserNode};
+
+use super::{Function, NodeId};
+
+/// The index of a label in a `LabelTable`.
+#[derive(Clone, Copy, Debug, PartialEq, Eq, Hash, PartialOrd, Ord)]
+pub struct LabelId(u32);
+
+impl LabelId {
+    pub fn new(index: usize) -> Self {
+        LabelId(u32::try_from(index).expect("too many labels in graph"))
+    }
+
+    #[inline(always)]
+    pub fn index(self) -> usize {
+        self.0 as usize
+    }
+}
+
+/// Every label of a graph, interned so that they are referred to by id.
+///
+/// For every label, the table has the node that it is on and the function
+/// that starts at it. For every node, it has the label that the node jumps
+/// to or calls. Following a jump or a call is then a couple of array
+/// lookups, instead of a search for the node with the label.
+#[derive(Clone, Debug, Default, PartialEq, Eq)]
+pub struct LabelTable {
+    ids: HashMap<LabelString, LabelId>,
+    names: Vec<LabelString>,
+    /// The node that each label is on, if it is on one
+    nodes: Vec<Option<NodeId>>,
+    /// The function that starts at each label, if there is one
+    functions: Vec<Option<Rc<Function>>>,
+    /// The label that each node jumps to, not counting calls
+    jumps: Vec<Option<LabelId>>,
+    /// The label that each node calls
+    calls: Vec<Option<LabelId>>,
+}
+
+impl LabelTable {
+    /// The id of a label, adding it to the table if it is new.
+    pub fn intern(&mut self, name: &LabelString) -> LabelId {
+        if let Some(&id) = self.ids.get(name) {
+            return id;
+        }
+        let id = LabelId::new(self.nodes.len());
+        self.ids.insert(name.clone(), id);
+        self.names.push(name.clone());
+        self.nodes.push(None);
+        self.functions.push(None);
+        id
+    }
+
+    #[inline(always)]
+    pub fn id(&self, name: &LabelString) -> Option<LabelId> {
+        self.ids.get(name).copied()
+    }
+
+    #[inline(always)]
+    pub fn name(&self, label: LabelId) -> &LabelString {
+        &self.names[label.index()]
+    }
+
+    pub fn len(&self) -> usize {
+        self.nodes.len()
+    }
+
+    pub fn is_empty(&self) -> bool {
+        self.nodes.is_empty()
+    }
+
+    /// Add the next node of the graph, recording the label it jumps to or
+    /// calls. The label of a load address is interned too, so that its
+    /// available value can refer to it by id.
+    ///
+    /// This has to be called for every node of the graph, in order.
+    pub fn push_node(&mut self, node: &ParserNode) {
+        if let ParserNode::LoadAddr(x) = node {
+            self.intern(&x.name.data);
+        }
+        let jump = node.jumps_to().map(|x| self.intern(&x.data));
+        let call = node.calls_to().map(|x| self.intern(&x.data));
+        self.jumps.push(jump);
+        self.calls.push(call);
+    }
+
+    /// Put a label on a node.
+    pub fn define(&mut self, label: LabelId, node: NodeId) {
+        self.nodes[label.index()] = Some(node);
+    }
+
+    /// The node that a label is on.
+    #[inline(always)]
+    pub fn node(&self, label: LabelId) -> Option<NodeId> {
+        self.nodes[label.index()]
+    }
+
+    /// The label that a node jumps to, not counting calls.
+    #[inline(always)]
+    pub fn jump(&self, node: NodeId) -> Option<LabelId> {
+        self.jumps.get(node.index()).copied().flatten()
+    }
+
+    /// The label that a node calls.
+    #[inline(always)]
+    pub fn call(&self, node: NodeId) -> Option<LabelId> {
+        self.calls.get(node.index()).copied().flatten()
+    }
+
+    /// The node that a node jumps to, if it jumps.
+    pub fn jump_target(&self, node: NodeId) -> Option<NodeId> {
+        self.jump(node).and_then(|x| self.node(x))
+    }
+
+    #[inline(always)]
+    pub fn function(&self, label: LabelId) -> Option<&Rc<Function>> {
+        self.functions[label.index()].as_ref()
+    }
+
+    pub fn set_function(&mut self, label: LabelId, function: Rc<Function>) {
+        self.functions[label.index()] = Some(function);
+    }
+}
+
+#[cfg(test)]
+mod test {
+    use super::LabelTable;
+    use crate::cfg::Cfg;
+    use crate::helpers::{analyse, FACTORIAL_PROGRAM};
+    use crate::parser::LabelString;
+
+    #[test]
+    fn interning_is_stable() {
+        let mut table = LabelTable::default();
+        let a = table.intern(&LabelString("a".to_owned()));
+        let b = table.intern(&LabelString("b".to_owned()));
+        assert_ne!(a, b);
+        assert_eq!(table.intern(&LabelString("a".to_owned())), a);
+        assert_eq!(table.id(&LabelString("b".to_owned())), Some(b));
+        assert_eq!(table.id(&LabelString("c".to_owned())), None);
+        assert_eq!(table.name(b), &LabelString("b".to_owned()));
+        assert_eq!(table.len(), 2);
+    }
+
+    #[test]
+    fn jumps_and_calls_resolve() {
+        let cfg: Cfg = analyse(FACTORIAL_PROGRAM);
+        let name = |x: &str| cfg.labels.id(&LabelString(x.to_owned())).unwrap();
+
+        for node in &cfg.nodes {
+            if let Some(label) = node.node().jumps_to() {
+                let target = cfg.labels.jump_target(node.id()).unwrap();
+                assert!(cfg.node(target).labels.contains(&label));
+            }
+            if node.node().calls_to().is_some() {
+                assert_eq!(cfg.labels.call(node.id()), Some(name("fact")));
+                assert!(node.calls_to(&cfg).is_some());
+            }
+        }
+        let fact = cfg.labels.function(name("fact")).unwrap();
+        assert_eq!(cfg.labels.node(name("fact")), Some(fact.entry.id()));
+        assert!(cfg.labels.function(name("loop")).is_none());
+    }
+}
@@ -1,3 +1,17 @@
+mod arena;
+pub use arena::*;
+
+mod block;
+pub use block::*;
+
+mod labels;
+pub use labels::*;
+
+mod reachable;
+
+mod partition;
+pub use partition::*;
+
 mod graph;
 pub use graph::*;
 
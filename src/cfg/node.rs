@@ -1,11 +1,12 @@
-use crate::analysis::AvailableValue;
+use crate::analysis::{AvailableValue, RegValues, StackValues};
 use crate::parser::LabelString;
+use crate::parser::NodeKey;
 use crate::parser::ParserNode;
+use crate::parser::RegSet;
 use crate::parser::Register;
 use crate::parser::With;
 use std::cell::Ref;
 use std::cell::RefCell;
-use std::collections::HashMap;
 use std::collections::HashSet;
 use std::hash::Hash;
 use std::rc::Rc;
@@ -13,58 +14,70 @@ use std::rc::Rc;
 use super::environment_in_outs;
 use super::Cfg;
 use super::Function;
+use super::NodeId;
+use super::NodeIds;
+
+static NO_REGS: RegValues = RegValues::EMPTY;
+static NO_STACK: StackValues = StackValues::EMPTY;
 
 #[derive(Debug)]
 pub struct CFGNode {
+    id: NodeId,
     node: RefCell<ParserNode>,
     pub labels: HashSet<With<LabelString>>,
-    nexts: RefCell<HashSet<Rc<CFGNode>>>,
-    prevs: RefCell<HashSet<Rc<CFGNode>>>,
+    nexts: RefCell<NodeIds>,
+    prevs: RefCell<NodeIds>,
     function: RefCell<Option<Rc<Function>>>,
-    reg_values_in: RefCell<HashMap<Register, AvailableValue>>,
-    reg_values_out: RefCell<HashMap<Register, AvailableValue>>,
-    stack_values_in: RefCell<HashMap<i32, AvailableValue>>,
-    stack_values_out: RefCell<HashMap<i32, AvailableValue>>,
-    live_in: RefCell<HashSet<Register>>,
-    live_out: RefCell<HashSet<Register>>,
-    u_def: RefCell<HashSet<Register>>,
+    // The available values are not set until the available value pass has
+    // run, and nothing is known until then
+    reg_values_in: RefCell<Option<Rc<RegValues>>>,
+    reg_values_out: RefCell<Option<Rc<RegValues>>>,
+    stack_values_in: RefCell<Option<Rc<StackValues>>>,
+    stack_values_out: RefCell<Option<Rc<StackValues>>>,
 }
 
 impl CFGNode {
-    pub fn new(node: ParserNode, labels: HashSet<With<LabelString>>) -> Self {
+    /// Add a node to the graph. The node is numbered by its id, so that
+    /// the nodes of a graph all have keys of their own.
+    pub fn new(id: NodeId, mut node: ParserNode, labels: HashSet<With<LabelString>>) -> Self {
+        node.set_key(NodeKey::new(id.index()));
         CFGNode {
+            id,
             node: RefCell::new(node),
             labels,
-            nexts: RefCell::new(HashSet::new()),
-            prevs: RefCell::new(HashSet::new()),
+            nexts: RefCell::new(NodeIds::new()),
+            prevs: RefCell::new(NodeIds::new()),
             function: RefCell::new(None),
-            reg_values_in: RefCell::new(HashMap::new()),
-            reg_values_out: RefCell::new(HashMap::new()),
-            stack_values_in: RefCell::new(HashMap::new()),
-            stack_values_out: RefCell::new(HashMap::new()),
-            live_in: RefCell::new(HashSet::new()),
-            live_out: RefCell::new(HashSet::new()),
-            u_def: RefCell::new(HashSet::new()),
+            reg_values_in: RefCell::new(None),
+            reg_values_out: RefCell::new(None),
+            stack_values_in: RefCell::new(None),
+            stack_values_out: RefCell::new(None),
         }
     }
 
     #[inline(always)]
-    pub fn set_node(&self, node: ParserNode) {
+    pub fn id(&self) -> NodeId {
+        self.id
+    }
+
+    #[inline(always)]
+    pub fn set_node(&self, mut node: ParserNode) {
+        node.set_key(NodeKey::new(self.id.index()));
         *self.node.borrow_mut() = node;
     }
 
     #[inline(always)]
-    pub fn node(&self) -> ParserNode {
-        self.node.borrow().clone()
+    pub fn node(&self) -> Ref<ParserNode> {
+        self.node.borrow()
     }
 
     #[inline(always)]
-    pub fn nexts(&self) -> Ref<HashSet<Rc<CFGNode>>> {
+    pub fn nexts(&self) -> Ref<NodeIds> {
         self.nexts.borrow()
     }
 
     #[inline(always)]
-    pub fn prevs(&self) -> Ref<HashSet<Rc<CFGNode>>> {
+    pub fn prevs(&self) -> Ref<NodeIds> {
         self.prevs.borrow()
     }
 
@@ -79,96 +92,87 @@ impl CFGNode {
     }
 
     #[inline(always)]
-    pub fn reg_values_in(&self) -> HashMap<Register, AvailableValue> {
-        self.reg_values_in.borrow().clone()
+    pub fn reg_values_in(&self) -> Ref<RegValues> {
+        Ref::map(self.reg_values_in.borrow(), |x| {
+            x.as_deref().unwrap_or(&NO_REGS)
+        })
     }
 
     #[inline(always)]
-    pub fn set_reg_values_in(&self, available_in: HashMap<Register, AvailableValue>) {
-        *self.reg_values_in.borrow_mut() = available_in;
+    pub fn set_reg_values_in(&self, available_in: Rc<RegValues>) {
+        *self.reg_values_in.borrow_mut() = Some(available_in);
     }
 
     #[inline(always)]
-    pub fn reg_values_out(&self) -> HashMap<Register, AvailableValue> {
-        self.reg_values_out.borrow().clone()
+    pub fn reg_values_out(&self) -> Ref<RegValues> {
+        Ref::map(self.reg_values_out.borrow(), |x| {
+            x.as_deref().unwrap_or(&NO_REGS)
+        })
     }
 
     #[inline(always)]
-    pub fn set_reg_values_out(&self, available_out: HashMap<Register, AvailableValue>) {
-        *self.reg_values_out.borrow_mut() = available_out;
+    pub fn set_reg_values_out(&self, available_out: Rc<RegValues>) {
+        *self.reg_values_out.borrow_mut() = Some(available_out);
     }
 
     #[inline(always)]
-    pub fn stack_values_in(&self) -> HashMap<i32, AvailableValue> {
-        self.stack_values_in.borrow().clone()
+    pub fn stack_values_in(&self) -> Ref<StackValues> {
+        Ref::map(self.stack_values_in.borrow(), |x| {
+            x.as_deref().unwrap_or(&NO_STACK)
+        })
     }
 
     #[inline(always)]
-    pub fn set_stack_values_in(&self, stack_in: HashMap<i32, AvailableValue>) {
-        *self.stack_values_in.borrow_mut() = stack_in;
+    pub fn set_stack_values_in(&self, stack_in: Rc<StackValues>) {
+        *self.stack_values_in.borrow_mut() = Some(stack_in);
     }
 
     #[inline(always)]
-    pub fn stack_values_out(&self) -> HashMap<i32, AvailableValue> {
-        self.stack_values_out.borrow().clone()
+    pub fn stack_values_out(&self) -> Ref<StackValues> {
+        Ref::map(self.stack_values_out.borrow(), |x| {
+            x.as_deref().unwrap_or(&NO_STACK)
+        })
     }
 
     #[inline(always)]
-    pub fn set_stack_values_out(&self, stack_out: HashMap<i32, AvailableValue>) {
-        *self.stack_values_out.borrow_mut() = stack_out;
+    pub fn set_stack_values_out(&self, stack_out: Rc<StackValues>) {
+        *self.stack_values_out.borrow_mut() = Some(stack_out);
     }
 
-    #[inline(always)]
-    pub fn live_in(&self) -> HashSet<Register> {
-        self.live_in.borrow().clone()
+    /// Forget the register values of the node, so that they can be freed.
+    /// Nothing is known about the registers afterwards, as if the available
+    /// value pass had not run.
+    pub fn clear_reg_values(&self) {
+        *self.reg_values_in.borrow_mut() = None;
+        *self.reg_values_out.borrow_mut() = None;
     }
 
-    #[inline(always)]
-    pub fn set_live_in(&self, live_in: HashSet<Register>) {
-        *self.live_in.borrow_mut() = live_in;
-    }
-
-    #[inline(always)]
-    pub fn live_out(&self) -> HashSet<Register> {
-        self.live_out.borrow().clone()
-    }
-
-    #[inline(always)]
-    pub fn set_live_out(&self, live_out: HashSet<Register>) {
-        *self.live_out.borrow_mut() = live_out;
-    }
-
-    #[inline(always)]
-    pub fn u_def(&self) -> HashSet<Register> {
-        self.u_def.borrow().clone()
-    }
-
-    #[inline(always)]
-    pub fn set_u_def(&self, u_def: HashSet<Register>) {
-        *self.u_def.borrow_mut() = u_def;
+    /// Forget the stack values of the node, like `clear_reg_values`.
+    pub fn clear_stack_values(&self) {
+        *self.stack_values_in.borrow_mut() = None;
+        *self.stack_values_out.borrow_mut() = None;
     }
 
     #[inline(always)]
     pub fn calls_to(&self, cfg: &Cfg) -> Option<Rc<Function>> {
-        if let Some(name) = self.node().calls_to() {
-            cfg.label_function_map.get(&name).cloned()
-        } else {
-            None
-        }
+        cfg.labels
+            .call(self.id)
+            .and_then(|x| cfg.labels.function(x))
+            .cloned()
     }
 
     pub fn known_ecall(&self) -> Option<i32> {
         if self.node().is_ecall() {
             if let Some(AvailableValue::Constant(call_num)) =
-                self.reg_values_in().get(&Register::ecall_type())
+                self.reg_values_in().get(Register::ecall_type())
             {
-                return Some(*call_num);
+                return Some(call_num);
             }
         }
         None
     }
 
-    pub fn known_ecall_signature(&self) -> Option<(HashSet<Register>, HashSet<Register>)> {
+    pub fn known_ecall_signature(&self) -> Option<(RegSet, RegSet)> {
         if let Some(call_num) = self.known_ecall() {
             if let Some((ins, out)) = environment_in_outs(call_num) {
                 return Some((ins, out));
@@ -182,13 +186,16 @@ impl CFGNode {
     }
 
     #[inline(always)]
-    pub fn insert_next(&self, next: Rc<CFGNode>) {
-        self.nexts.borrow_mut().insert(next);
+    pub fn insert_next(&self, next: NodeId) {
+        let mut nexts = self.nexts.borrow_mut();
+        if !nexts.contains(&next) {
+            nexts.push(next);
+        }
     }
 
     #[inline(always)]
-    pub fn remove_next(&self, next: &Rc<CFGNode>) {
-        self.nexts.borrow_mut().remove(next);
+    pub fn remove_next(&self, next: NodeId) {
+        self.nexts.borrow_mut().retain(|x| *x != next);
     }
 
     #[inline(always)]
@@ -197,13 +204,16 @@ impl CFGNode {
     }
 
     #[inline(always)]
-    pub fn insert_prev(&self, prev: Rc<CFGNode>) {
-        self.prevs.borrow_mut().insert(prev);
+    pub fn insert_prev(&self, prev: NodeId) {
+        let mut prevs = self.prevs.borrow_mut();
+        if !prevs.contains(&prev) {
+            prevs.push(prev);
+        }
     }
 
     #[inline(always)]
-    pub fn remove_prev(&self, prev: &Rc<CFGNode>) {
-        self.prevs.borrow_mut().remove(prev);
+    pub fn remove_prev(&self, prev: NodeId) {
+        self.prevs.borrow_mut().retain(|x| *x != prev);
     }
 
     #[inline(always)]
@@ -221,20 +231,20 @@ impl CFGNode {
     }
 
     #[inline(always)]
-    pub fn labels(&self) -> HashSet<With<LabelString>> {
-        self.labels.clone()
+    pub fn labels(&self) -> &HashSet<With<LabelString>> {
+        &self.labels
     }
 }
 
 impl Hash for CFGNode {
     fn hash<H: std::hash::Hasher>(&self, state: &mut H) {
-        self.node().hash(state);
+        self.id.hash(state);
     }
 }
 
 impl PartialEq for CFGNode {
     fn eq(&self, other: &Self) -> bool {
-        self.node == other.node
+        self.id == other.id
     }
 }
 impl Eq for CFGNode {}
@@ -0,0 +1,214 @@
+use std::collections::HashMap;
+
+use super::{BasicBlocks, BlockId, Cfg, NodeId};
+
+/// The blocks of the graph split up by function.
+///
+/// Every function found by `FunctionMarkupPass` is a region of its own, and
+/// all of the code outside of a function (the program entry, for example)
+/// makes up region 0. Regions are connected through the call graph: a call
+/// site in one region depends on the entry and exit of the called region.
+///
+/// The regions are also grouped into waves using the strongly connected
+/// components of the call graph. Every call out of a wave is to a region in
+/// an earlier wave, or to a region in the same component (recursion). If the
+/// waves are solved in order, each call site already knows about its
+/// callees, and regions in the same wave can be solved at the same time.
+#[derive(Clone, Debug, PartialEq, Eq)]
+pub struct Partition {
+    /// The blocks of each region, in program order.
+    pub regions: Vec<Vec<BlockId>>,
+    /// The regions of each wave, with the wave of the callees first.
+    pub waves: Vec<Vec<usize>>,
+    region_of: Vec<usize>,
+}
+
+impl Partition {
+    pub fn new(cfg: &Cfg, blocks: &BasicBlocks) -> Self {
+        // Functions are numbered by the position of their entry
+        let mut entries = cfg
+            .label_function_map
+            .values()
+            .map(|x| x.entry.id())
+            .collect::<Vec<_>>();
+        entries.sort_unstable();
+        entries.dedup();
+        let region_of_entry = entries
+            .iter()
+            .enumerate()
+            .map(|(i, &x)| (x, i + 1))
+            .collect::<HashMap<NodeId, usize>>();
+
+        let mut regions = vec![Vec::new(); entries.len() + 1];
+        let mut region_of = Vec::with_capacity(blocks.len());
+        for id in blocks.ids() {
+            let head = cfg.node(blocks.block(id).head());
+            let region = head
+                .function()
+                .as_ref()
+                .and_then(|x| region_of_entry.get(&x.entry.id()).copied())
+                .unwrap_or(0);
+            regions[region].push(id);
+            region_of.push(region);
+        }
+
+        // Calls always stand alone, so only the head of a block can be one
+        let mut callees = vec![Vec::new(); regions.len()];
+        for id in blocks.ids() {
+            let head = cfg.node(blocks.block(id).head());
+            if let Some(&callee) = head
+                .calls_to(cfg)
+                .and_then(|x| region_of_entry.get(&x.entry.id()))
+            {
+                callees[region_of[id.index()]].push(callee);
+            }
+        }
+        for list in &mut callees {
+            list.sort_unstable();
+            list.dedup();
+        }
+
+        Partition {
+            regions,
+            waves: waves(&callees),
+            region_of,
+        }
+    }
+
+    /// The region that contains a block.
+    #[inline(always)]
+    pub fn region_of(&self, block: BlockId) -> usize {
+        self.region_of[block.index()]
+    }
+
+    pub fn len(&self) -> usize {
+        self.regions.len()
+    }
+
+    pub fn is_empty(&self) -> bool {
+        self.regions.is_empty()
+    }
+}
+
+/// Group the nodes of a graph into waves, so that every edge out of a wave
+/// goes to an earlier wave or stays inside of a strongly connected component.
+///
+/// The components are found with Kosaraju's algorithm, which finds them in
+/// topological order (callers before callees). The wave of a component is
+/// one more than the latest wave of any component it calls.
+fn waves(edges: &[Vec<usize>]) -> Vec<Vec<usize>> {
+    let len = edges.len();
+    let mut reversed = vec![Vec::new(); len];
+    for (from, tos) in edges.iter().enumerate() {
+        for &to in tos {
+            reversed[to].push(from);
+        }
+    }
+
+    // Components in topological order, from a search of the reversed
+    // graph in reverse postorder of the graph
+    let mut component = vec![usize::MAX; len];
+    let mut count = 0;
+    for root in postorder(edges).into_iter().rev() {
+        if component[root] != usize::MAX {
+            continue;
+        }
+        component[root] = count;
+        let mut stack = vec![root];
+        while let Some(node) = stack.pop() {
+            for &prev in &reversed[node] {
+                if component[prev] == usize::MAX {
+                    component[prev] = count;
+                    stack.push(prev);
+                }
+            }
+        }
+        count += 1;
+    }
+
+    let mut members = vec![Vec::new(); count];
+    for (node, &c) in component.iter().enumerate() {
+        members[c].push(node);
+    }
+
+    // Callees are always in later components, so go backwards
+    let mut wave = vec![0; count];
+    for c in (0..count).rev() {
+        wave[c] = members[c]
+            .iter()
+            .flat_map(|&x| &edges[x])
+            .map(|&x| component[x])
+            .filter(|&x| x != c)
+            .map(|x| wave[x] + 1)
+            .max()
+            .unwrap_or(0);
+    }
+
+    let mut waves = vec![Vec::new(); wave.iter().max().map_or(0, |x| x + 1)];
+    for (node, &c) in component.iter().enumerate() {
+        waves[wave[c]].push(node);
+    }
+    waves
+}
+
+/// Calculate the postorder of a graph, starting from every node in order.
+fn postorder(edges: &[Vec<usize>]) -> Vec<usize> {
+    let mut visited = vec![false; edges.len()];
+    let mut order = Vec::with_capacity(edges.len());
+    let mut stack: Vec<(usize, usize)> = Vec::new();
+
+    for root in 0..edges.len() {
+        if visited[root] {
+            continue;
+        }
+        visited[root] = true;
+        stack.push((root, 0));
+
+        while let Some((node, pos)) = stack.last_mut() {
+            if let Some(&next) = edges[*node].get(*pos) {
+                *pos += 1;
+                if !visited[next] {
+                    visited[next] = true;
+                    stack.push((next, 0));
+                }
+            } else {
+                order.push(*node);
+                stack.pop();
+            }
+        }
+    }
+
+    order
+}
+
+#[cfg(test)]
+mod test {
+    use super::{waves, Partition};
+    use crate::cfg::BasicBlocks;
+    use crate::helpers::{analyse, FACTORIAL_PROGRAM};
+
+    #[test]
+    fn callees_come_first() {
+        // 0 -> 1 -> 2 <-> 3, 0 -> 4 -> 3
+        let edges = vec![vec![1, 4], vec![2], vec![3], vec![2], vec![3]];
+        assert_eq!(waves(&edges), vec![vec![2, 3], vec![1, 4], vec![0]]);
+    }
+
+    #[test]
+    fn regions_follow_functions() {
+        let cfg = analyse(FACTORIAL_PROGRAM);
+        let blocks = BasicBlocks::new(&cfg);
+        let partition = Partition::new(&cfg, &blocks);
+
+        // main and fact, where fact is called by main (and itself)
+        assert_eq!(partition.len(), 2);
+        assert_eq!(partition.waves, vec![vec![1], vec![0]]);
+        for (region, list) in partition.regions.iter().enumerate() {
+            for &block in list {
+                assert_eq!(partition.region_of(block), region);
+                let node = cfg.node(blocks.block(block).head());
+                assert_eq!(node.function().is_some(), region != 0);
+            }
+        }
+    }
+}
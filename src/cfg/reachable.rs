@@ -0,0 +1,97 @@
+use super::{Cfg, NodeTable};
+
+impl Cfg {
+    /// Mark the nodes that can be reached from the program entry or from a
+    /// function entry, following the nexts of every node.
+    ///
+    /// This is a single search over the graph, so it has to be redone after
+    /// edges are removed for `reachable` to stay accurate.
+    pub fn mark_reachable(&mut self) {
+        let mut reachable = NodeTable::new(self.nodes.len(), false);
+        let mut stack = self
+            .nodes
+            .iter()
+            .filter(|x| x.node().is_any_entry())
+            .map(|x| x.id())
+            .collect::<Vec<_>>();
+        for &id in &stack {
+            reachable[id] = true;
+        }
+
+        while let Some(id) = stack.pop() {
+            for &next in self.node(id).nexts().iter() {
+                if !std::mem::replace(&mut reachable[next], true) {
+                    stack.push(next);
+                }
+            }
+        }
+        self.reachable = reachable;
+    }
+}
+
+#[cfg(test)]
+mod test {
+    use crate::cfg::{Cfg, NodeId};
+    use crate::helpers::analyse;
+
+    fn unreachable(cfg: &Cfg) -> Vec<usize> {
+        cfg.nodes
+            .iter()
+            .filter(|x| !cfg.reachable[x.id()])
+            .map(|x| x.id().index())
+            .collect()
+    }
+
+    #[test]
+    fn dead_loops_are_cut() {
+        // The loop after the return can only be entered from itself
+        let cfg = analyse(
+            "main:
+                call f
+                li a7, 10
+                ecall
+            f:
+                ret
+            loop:
+                addi a0, a0, 1
+                j loop
+            ",
+        );
+        let ret = cfg.nodes.iter().position(|x| x.node().is_return()).unwrap();
+        let after = (ret + 1..cfg.nodes.len()).collect::<Vec<_>>();
+        assert_eq!(unreachable(&cfg), after);
+        for id in after {
+            let node = cfg.node(NodeId::new(id));
+            assert!(node.prevs().is_empty());
+            assert!(node.nexts().is_empty());
+        }
+    }
+
+    #[test]
+    fn code_after_exit_is_unreachable() {
+        let cfg = analyse(
+            "main:
+                li a7, 10
+                ecall
+                li a0, 1
+                li a0, 2
+            ",
+        );
+        // The program entry, then two nodes before the exit and two after
+        assert_eq!(unreachable(&cfg), vec![3, 4]);
+    }
+
+    #[test]
+    fn end_of_program_is_reachable() {
+        let cfg = analyse(
+            "main:
+                li a0, 1
+                li a7, 1
+                ecall
+            ",
+        );
+        assert!(unreachable(&cfg).is_empty());
+        let last = cfg.nodes.last().unwrap();
+        assert!(!last.prevs().is_empty());
+    }
+}
@@ -0,0 +1,192 @@
+// ANALYSIS EXPORT
+// ===============
+//
+// An export is everything that is known about an analysed program, laid out
+// so that it can be queried where it is, for example straight out of a
+// memory mapped file, without being parsed first.
+//
+// Every number is a little endian `u32` (or `i32`). The file starts with a
+// header, which is the magic bytes, the version, the number of sections and
+// then the offset and record count of each section. Every section is a table
+// of records of the same size, so that the `n`th record of any section is
+// found without reading the records before it. Every section starts at a
+// multiple of four bytes.
+//
+// Records refer to each other by their index in the section they are in:
+// a node refers to its function, a function to a run of its member nodes,
+// and so on. Strings are all kept in `Strings`, as runs of `Bytes`.
+
+/// The first bytes of every export.
+pub const MAGIC: [u8; 4] = *b"RVAX";
+
+/// The version of the layout. This changes whenever a reader of an older
+/// version could not read what is written.
+pub const VERSION: u32 = 1;
+
+/// A value that is not there, such as the function of a node that is not
+/// in one.
+pub const NONE: u32 = u32::MAX;
+
+/// The sections of an export, in the order that they are in the header.
+#[derive(Clone, Copy, Debug, PartialEq, Eq)]
+pub enum Section {
+    /// Every node of the graph, in program order. See `NodeField`.
+    Nodes,
+    /// The nexts and then the prevs of each node, as node indices
+    Edges,
+    /// Every function, in order of their entry. See `FunctionField`.
+    Functions,
+    /// The nodes of each function, as node indices
+    Members,
+    /// Runs of `Values`, as a start and a length. The first set is empty.
+    ValueSets,
+    /// A key (a register number or a stack offset) and a value each. See
+    /// `ValueKind`.
+    Values,
+    /// Every diagnostic, sorted by file and then position. See
+    /// `DiagnosticField`.
+    Diagnostics,
+    /// The id of each file and the string of its path
+    Files,
+    /// The string of each label, by `LabelId`
+    Labels,
+    /// Runs of `Bytes`, as a start and a length, each valid UTF-8
+    Strings,
+    Bytes,
+}
+
+impl Section {
+    pub const ALL: [Section; 11] = [
+        Section::Nodes,
+        Section::Edges,
+        Section::Functions,
+        Section::Members,
+        Section::ValueSets,
+        Section::Values,
+        Section::Diagnostics,
+        Section::Files,
+        Section::Labels,
+        Section::Strings,
+        Section::Bytes,
+    ];
+
+    /// The size of each record of the section, in bytes.
+    pub const fn record(self) -> usize {
+        match self {
+            Section::Nodes => NodeField::COUNT * 4,
+            Section::Functions => FunctionField::COUNT * 4,
+            Section::Diagnostics => DiagnosticField::COUNT * 4,
+            Section::Values => 16,
+            Section::ValueSets | Section::Files | Section::Strings => 8,
+            Section::Edges | Section::Members | Section::Labels => 4,
+            Section::Bytes => 1,
+        }
+    }
+}
+
+/// The size of the header, in bytes.
+pub const HEADER: usize = 12 + Section::ALL.len() * 8;
+
+/// The fields of a record in `Nodes`, in order.
+#[derive(Clone, Copy, Debug, PartialEq, Eq)]
+pub enum NodeField {
+    File,
+    /// See `NodeFlags`
+    Flags,
+    StartLine,
+    StartColumn,
+    EndLine,
+    EndColumn,
+    /// The string of the instruction
+    Text,
+    /// The function that the node is in, or `NONE`
+    Function,
+    LiveIn,
+    LiveOut,
+    UDef,
+    /// The start of the nexts of the node in `Edges`, which the prevs follow
+    Edges,
+    Nexts,
+    Prevs,
+    /// Value sets, see `Section::ValueSets`
+    RegValuesIn,
+    RegValuesOut,
+    StackValuesIn,
+    StackValuesOut,
+}
+
+impl NodeField {
+    pub const COUNT: usize = NodeField::StackValuesOut as usize + 1;
+}
+
+/// The bits of `NodeField::Flags`.
+pub struct NodeFlags;
+
+impl NodeFlags {
+    pub const FUNCTION_ENTRY: u32 = 1 << 0;
+    pub const PROGRAM_ENTRY: u32 = 1 << 1;
+    pub const RETURN: u32 = 1 << 2;
+    pub const ECALL: u32 = 1 << 3;
+    pub const REACHABLE: u32 = 1 << 4;
+}
+
+/// The fields of a record in `Functions`, in order.
+#[derive(Clone, Copy, Debug, PartialEq, Eq)]
+pub enum FunctionField {
+    /// The string of the first of its labels, by name
+    Name,
+    Entry,
+    Exit,
+    /// The start and length of its nodes in `Members`
+    Members,
+    MembersLen,
+    Arguments,
+    Returns,
+    Clobbers,
+    Overwritten,
+    /// The offset of the stack pointer at the exit, if `HasStackDelta` is 1
+    StackDelta,
+    HasStackDelta,
+}
+
+impl FunctionField {
+    pub const COUNT: usize = FunctionField::HasStackDelta as usize + 1;
+}
+
+/// The fields of a record in `Diagnostics`, in order.
+#[derive(Clone, Copy, Debug, PartialEq, Eq)]
+pub enum DiagnosticField {
+    File,
+    StartLine,
+    StartColumn,
+    EndLine,
+    EndColumn,
+    /// 1 for errors and 0 for warnings
+    Error,
+    /// 1 for lints and 0 for parse errors
+    Lint,
+    /// The strings of its code, its message and its description
+    Code,
+    Message,
+    Description,
+}
+
+impl DiagnosticField {
+    pub const COUNT: usize = DiagnosticField::Description as usize + 1;
+}
+
+/// The kind of a value in `Values`, which says what its two numbers are.
+///
+/// These are the variants of `AvailableValue`, where registers are numbers
+/// and labels are indices into `Labels`.
+pub struct ValueKind;
+
+impl ValueKind {
+    pub const CONSTANT: u32 = 0;
+    pub const ADDRESS: u32 = 1;
+    pub const MEMORY: u32 = 2;
+    pub const REGISTER_WITH_SCALAR: u32 = 3;
+    pub const ORIGINAL_REGISTER_WITH_SCALAR: u32 = 4;
+    pub const MEMORY_AT_REGISTER: u32 = 5;
+    pub const MEMORY_AT_ORIGINAL_REGISTER: u32 = 6;
+}
@@ -0,0 +1,8 @@
+mod layout;
+pub use layout::*;
+
+mod write;
+pub use write::*;
+
+mod read;
+pub use read::*;
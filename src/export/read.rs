@@ -0,0 +1,636 @@
+// The binary only writes exports, and other tools read them through the
+// library, so most of this is only used from there.
+#![allow(dead_code)]
+
+use std::fmt::Display;
+
+// The types that an export is read as, for tools outside of the crate
+pub use crate::analysis::AvailableValue;
+pub use crate::cfg::LabelId;
+pub use crate::parser::{Position, Range, RegSet, Register};
+pub use crate::passes::WarningLevel;
+
+use super::{
+    DiagnosticField, FunctionField, NodeField, NodeFlags, Section, ValueKind, HEADER, MAGIC, NONE,
+    VERSION,
+};
+
+/// Why some bytes could not be read as an export.
+#[derive(Clone, Copy, Debug, PartialEq, Eq)]
+pub enum ExportError {
+    NotAnExport,
+    /// The export was written with another version of the layout
+    UnsupportedVersion(u32),
+    /// A section goes past the end of the bytes
+    Truncated,
+}
+
+impl Display for ExportError {
+    fn fmt(&self, f: &mut std::fmt::Formatter<'_>) -> std::fmt::Result {
+        match self {
+            ExportError::NotAnExport => write!(f, "not an analysis export"),
+            ExportError::UnsupportedVersion(x) => {
+                write!(
+                    f,
+                    "export version {x} is not supported (expected {VERSION})"
+                )
+            }
+            ExportError::Truncated => write!(f, "export is truncated"),
+        }
+    }
+}
+
+impl std::error::Error for ExportError {}
+
+#[inline(always)]
+fn u32_at(bytes: &[u8], at: usize) -> u32 {
+    let mut word = [0; 4];
+    word.copy_from_slice(&bytes[at..at + 4]);
+    u32::from_le_bytes(word)
+}
+
+/// The register with a number, if there is one.
+fn register(num: u32) -> Option<Register> {
+    u8::try_from(num)
+        .ok()
+        .filter(|&x| x < 32)
+        .map(Register::from_num)
+}
+
+/// An export of an analysed program, read where it is.
+///
+/// Opening an export only checks its header and that every section is in
+/// bounds, so `bytes` can be a memory mapped file of any size. Everything
+/// else is read when it is asked for, and any node, function or diagnostic
+/// is found without reading the ones before it. References that point
+/// nowhere, as in a corrupted export, are read as nothing.
+#[derive(Clone, Copy, Debug)]
+pub struct Export<'a> {
+    bytes: &'a [u8],
+    /// The offset and the number of records of each section
+    sections: [(usize, usize); Section::ALL.len()],
+}
+
+impl<'a> Export<'a> {
+    pub fn new(bytes: &'a [u8]) -> Result<Self, ExportError> {
+        if bytes.len() < 12 || bytes[..4] != MAGIC {
+            return Err(ExportError::NotAnExport);
+        }
+        let version = u32_at(bytes, 4);
+        if version != VERSION {
+            return Err(ExportError::UnsupportedVersion(version));
+        }
+        if bytes.len() < HEADER || u32_at(bytes, 8) as usize != Section::ALL.len() {
+            return Err(ExportError::Truncated);
+        }
+        let mut sections = [(0, 0); Section::ALL.len()];
+        for (i, section) in Section::ALL.into_iter().enumerate() {
+            let offset = u32_at(bytes, 12 + i * 8) as usize;
+            let count = u32_at(bytes, 16 + i * 8) as usize;
+            let end = count
+                .checked_mul(section.record())
+                .and_then(|x| x.checked_add(offset));
+            if end.is_none_or(|x| x > bytes.len()) {
+                return Err(ExportError::Truncated);
+            }
+            sections[i] = (offset, count);
+        }
+        Ok(Export { bytes, sections })
+    }
+
+    fn count(&self, section: Section) -> usize {
+        self.sections[section as usize].1
+    }
+
+    fn record(&self, section: Section, index: usize) -> Option<&'a [u8]> {
+        let (offset, count) = self.sections[section as usize];
+        let size = section.record();
+        (index < count).then(|| &self.bytes[offset + index * size..][..size])
+    }
+
+    /// The first word of each record in a run of a section.
+    fn words(&self, section: Section, start: u32, len: u32) -> impl Iterator<Item = u32> + 'a {
+        let export = *self;
+        let start = start as usize;
+        (start..start.saturating_add(len as usize))
+            .map_while(move |x| export.record(section, x))
+            .map(|x| u32_at(x, 0))
+    }
+
+    fn string(&self, index: u32) -> Option<&'a str> {
+        let record = self.record(Section::Strings, index as usize)?;
+        let (start, len) = (u32_at(record, 0) as usize, u32_at(record, 4) as usize);
+        let (offset, count) = self.sections[Section::Bytes as usize];
+        if start.checked_add(len)? > count {
+            return None;
+        }
+        std::str::from_utf8(&self.bytes[offset + start..][..len]).ok()
+    }
+
+    /// The values of a value set, keyed by register number or stack offset.
+    fn values(&self, set: u32) -> impl Iterator<Item = (i32, AvailableValue)> + 'a {
+        let export = *self;
+        let (start, len) = self
+            .record(Section::ValueSets, set as usize)
+            .map_or((0, 0), |x| (u32_at(x, 0) as usize, u32_at(x, 4) as usize));
+        (start..start.saturating_add(len))
+            .map_while(move |x| export.record(Section::Values, x))
+            .filter_map(|x| {
+                let (key, kind) = (u32_at(x, 0).cast_signed(), u32_at(x, 4));
+                let (a, b) = (u32_at(x, 8), u32_at(x, 12).cast_signed());
+                let label = || LabelId::new(a as usize);
+                let reg = || register(a);
+                let value = match kind {
+                    ValueKind::CONSTANT => AvailableValue::Constant(a.cast_signed()),
+                    ValueKind::ADDRESS => AvailableValue::Address(label()),
+                    ValueKind::MEMORY => AvailableValue::Memory(label(), b),
+                    ValueKind::REGISTER_WITH_SCALAR => {
+                        AvailableValue::RegisterWithScalar(reg()?, b)
+                    }
+                    ValueKind::ORIGINAL_REGISTER_WITH_SCALAR => {
+                        AvailableValue::OriginalRegisterWithScalar(reg()?, b)
+                    }
+                    ValueKind::MEMORY_AT_REGISTER => AvailableValue::MemoryAtRegister(reg()?, b),
+                    ValueKind::MEMORY_AT_ORIGINAL_REGISTER => {
+                        AvailableValue::MemoryAtOriginalRegister(reg()?, b)
+                    }
+                    _ => return None,
+                };
+                Some((key, value))
+            })
+    }
+
+    fn file(&self, id: u32) -> Option<&'a str> {
+        (0..self.count(Section::Files))
+            .filter_map(|x| self.record(Section::Files, x))
+            .find(|x| u32_at(x, 0) == id)
+            .and_then(|x| self.string(u32_at(x, 4)))
+    }
+
+    /// The path of every file that the program was read from.
+    pub fn files(&self) -> impl Iterator<Item = &'a str> + 'a {
+        let export = *self;
+        (0..self.count(Section::Files))
+            .filter_map(move |x| export.record(Section::Files, x))
+            .filter_map(move |x| export.string(u32_at(x, 4)))
+    }
+
+    /// The name of a label that an available value refers to.
+    pub fn label(&self, label: LabelId) -> Option<&'a str> {
+        let record = self.record(Section::Labels, label.index())?;
+        self.string(u32_at(record, 0))
+    }
+
+    /// The number of nodes in the graph.
+    pub fn len(&self) -> usize {
+        self.count(Section::Nodes)
+    }
+
+    pub fn is_empty(&self) -> bool {
+        self.len() == 0
+    }
+
+    /// The node at `index`, which is its id in the graph.
+    pub fn node(&self, index: usize) -> Option<ExportNode<'a>> {
+        let record = self.record(Section::Nodes, index)?;
+        Some(ExportNode {
+            export: *self,
+            index,
+            record,
+        })
+    }
+
+    /// Every node, in program order.
+    pub fn nodes(&self) -> impl Iterator<Item = ExportNode<'a>> + 'a {
+        let export = *self;
+        (0..self.len()).filter_map(move |x| export.node(x))
+    }
+
+    pub fn function(&self, index: usize) -> Option<ExportFunction<'a>> {
+        let record = self.record(Section::Functions, index)?;
+        Some(ExportFunction {
+            export: *self,
+            index,
+            record,
+        })
+    }
+
+    /// Every function, in order of their entries.
+    pub fn functions(&self) -> impl Iterator<Item = ExportFunction<'a>> + 'a {
+        let export = *self;
+        (0..self.count(Section::Functions)).filter_map(move |x| export.function(x))
+    }
+
+    fn diagnostic(&self, index: usize) -> Option<ExportDiagnostic<'a>> {
+        let record = self.record(Section::Diagnostics, index)?;
+        Some(ExportDiagnostic {
+            export: *self,
+            record,
+        })
+    }
+
+    /// Every diagnostic, sorted by file and then by position.
+    pub fn diagnostics(&self) -> impl Iterator<Item = ExportDiagnostic<'a>> + 'a {
+        let export = *self;
+        (0..self.count(Section::Diagnostics)).filter_map(move |x| export.diagnostic(x))
+    }
+
+    /// The diagnostics of a file that start on any of `lines`, found with a
+    /// binary search.
+    fn diagnostics_within(
+        &self,
+        file: u32,
+        lines: std::ops::RangeInclusive<u32>,
+    ) -> impl Iterator<Item = ExportDiagnostic<'a>> + 'a {
+        let export = *self;
+        let key = |x: &[u8]| {
+            (
+                u32_at(x, DiagnosticField::File as usize * 4),
+                u32_at(x, DiagnosticField::StartLine as usize * 4),
+            )
+        };
+        let (mut low, mut high) = (0, self.count(Section::Diagnostics));
+        while low < high {
+            let mid = low + (high - low) / 2;
+            match self.record(Section::Diagnostics, mid) {
+                Some(x) if key(x) < (file, *lines.start()) => low = mid + 1,
+                _ => high = mid,
+            }
+        }
+        (low..self.count(Section::Diagnostics))
+            .map_while(move |x| export.record(Section::Diagnostics, x))
+            .take_while(move |x| key(x) <= (file, *lines.end()))
+            .map(move |record| ExportDiagnostic { export, record })
+    }
+
+    /// The diagnostics that start on a line of a file, like the queries of
+    /// an editor. Lines start at 0.
+    pub fn diagnostics_on(
+        &self,
+        path: &str,
+        line: usize,
+    ) -> impl Iterator<Item = ExportDiagnostic<'a>> + 'a {
+        let file = (0..self.count(Section::Files))
+            .filter_map(|x| self.record(Section::Files, x))
+            .find(|x| self.string(u32_at(x, 4)) == Some(path))
+            .map(|x| u32_at(x, 0));
+        // No file has the id `NONE`, so an unknown file has no diagnostics
+        let line = u32::try_from(line).unwrap_or(NONE);
+        self.diagnostics_within(file.unwrap_or(NONE), line..=line)
+    }
+}
+
+fn range_at(record: &[u8], start_line: usize) -> Range {
+    let word = |x: usize| u32_at(record, (start_line + x) * 4) as usize;
+    Range {
+        start: Position {
+            line: word(0),
+            column: word(1),
+        },
+        end: Position {
+            line: word(2),
+            column: word(3),
+        },
+    }
+}
+
+/// A node in an export, and everything known about it.
+#[derive(Clone, Copy, Debug)]
+pub struct ExportNode<'a> {
+    export: Export<'a>,
+    index: usize,
+    record: &'a [u8],
+}
+
+impl<'a> ExportNode<'a> {
+    #[inline(always)]
+    fn field(&self, field: NodeField) -> u32 {
+        u32_at(self.record, field as usize * 4)
+    }
+
+    fn flag(&self, flag: u32) -> bool {
+        self.field(NodeField::Flags) & flag != 0
+    }
+
+    /// The id of the node in the graph.
+    pub fn index(&self) -> usize {
+        self.index
+    }
+
+    pub fn file(&self) -> Option<&'a str> {
+        self.export.file(self.field(NodeField::File))
+    }
+
+    pub fn range(&self) -> Range {
+        range_at(self.record, NodeField::StartLine as usize)
+    }
+
+    /// The instruction, as it is shown in the debug output.
+    pub fn text(&self) -> &'a str {
+        self.export
+            .string(self.field(NodeField::Text))
+            .unwrap_or_default()
+    }
+
+    pub fn is_function_entry(&self) -> bool {
+        self.flag(NodeFlags::FUNCTION_ENTRY)
+    }
+
+    pub fn is_program_entry(&self) -> bool {
+        self.flag(NodeFlags::PROGRAM_ENTRY)
+    }
+
+    pub fn is_return(&self) -> bool {
+        self.flag(NodeFlags::RETURN)
+    }
+
+    pub fn is_ecall(&self) -> bool {
+        self.flag(NodeFlags::ECALL)
+    }
+
+    pub fn is_reachable(&self) -> bool {
+        self.flag(NodeFlags::REACHABLE)
+    }
+
+    /// The function that the node is in, if any.
+    pub fn function(&self) -> Option<ExportFunction<'a>> {
+        self.export
+            .function(self.field(NodeField::Function) as usize)
+    }
+
+    pub fn live_in(&self) -> RegSet {
+        RegSet::from_bits(self.field(NodeField::LiveIn))
+    }
+
+    pub fn live_out(&self) -> RegSet {
+        RegSet::from_bits(self.field(NodeField::LiveOut))
+    }
+
+    pub fn u_def(&self) -> RegSet {
+        RegSet::from_bits(self.field(NodeField::UDef))
+    }
+
+    pub fn nexts(&self) -> impl Iterator<Item = usize> + 'a {
+        let (start, len) = (self.field(NodeField::Edges), self.field(NodeField::Nexts));
+        self.export
+            .words(Section::Edges, start, len)
+            .map(|x| x as usize)
+    }
+
+    pub fn prevs(&self) -> impl Iterator<Item = usize> + 'a {
+        let start = self
+            .field(NodeField::Edges)
+            .saturating_add(self.field(NodeField::Nexts));
+        self.export
+            .words(Section::Edges, start, self.field(NodeField::Prevs))
+            .map(|x| x as usize)
+    }
+
+    fn regs(&self, field: NodeField) -> impl Iterator<Item = (Register, AvailableValue)> + 'a {
+        self.export
+            .values(self.field(field))
+            .filter_map(|(reg, value)| Some((register(reg.cast_unsigned())?, value)))
+    }
+
+    /// The registers with a known value going into the node.
+    pub fn reg_values_in(&self) -> impl Iterator<Item = (Register, AvailableValue)> + 'a {
+        self.regs(NodeField::RegValuesIn)
+    }
+
+    /// The registers with a known value coming out of the node.
+    pub fn reg_values_out(&self) -> impl Iterator<Item = (Register, AvailableValue)> + 'a {
+        self.regs(NodeField::RegValuesOut)
+    }
+
+    pub fn reg_value_in(&self, reg: Register) -> Option<AvailableValue> {
+        self.reg_values_in().find(|x| x.0 == reg).map(|x| x.1)
+    }
+
+    pub fn reg_value_out(&self, reg: Register) -> Option<AvailableValue> {
+        self.reg_values_out().find(|x| x.0 == reg).map(|x| x.1)
+    }
+
+    /// The stack slots with a known value going into the node, by their
+    /// offset from the stack pointer at the entry of the function.
+    pub fn stack_values_in(&self) -> impl Iterator<Item = (i32, AvailableValue)> + 'a {
+        self.export.values(self.field(NodeField::StackValuesIn))
+    }
+
+    pub fn stack_values_out(&self) -> impl Iterator<Item = (i32, AvailableValue)> + 'a {
+        self.export.values(self.field(NodeField::StackValuesOut))
+    }
+
+    /// The diagnostics that start on the lines of the node.
+    pub fn diagnostics(&self) -> impl Iterator<Item = ExportDiagnostic<'a>> + 'a {
+        let lines = self.field(NodeField::StartLine)..=self.field(NodeField::EndLine);
+        self.export
+            .diagnostics_within(self.field(NodeField::File), lines)
+    }
+}
+
+/// A function in an export.
+#[derive(Clone, Copy, Debug)]
+pub struct ExportFunction<'a> {
+    export: Export<'a>,
+    index: usize,
+    record: &'a [u8],
+}
+
+impl<'a> ExportFunction<'a> {
+    #[inline(always)]
+    fn field(&self, field: FunctionField) -> u32 {
+        u32_at(self.record, field as usize * 4)
+    }
+
+    pub fn index(&self) -> usize {
+        self.index
+    }
+
+    /// The first of the labels of the function, by name.
+    pub fn name(&self) -> &'a str {
+        self.export
+            .string(self.field(FunctionField::Name))
+            .unwrap_or_default()
+    }
+
+    pub fn entry(&self) -> usize {
+        self.field(FunctionField::Entry) as usize
+    }
+
+    pub fn exit(&self) -> usize {
+        self.field(FunctionField::Exit) as usize
+    }
+
+    /// The nodes of the function, by index.
+    pub fn nodes(&self) -> impl Iterator<Item = usize> + 'a {
+        let (start, len) = (
+            self.field(FunctionField::Members),
+            self.field(FunctionField::MembersLen),
+        );
+        self.export
+            .words(Section::Members, start, len)
+            .map(|x| x as usize)
+    }
+
+    pub fn arguments(&self) -> RegSet {
+        RegSet::from_bits(self.field(FunctionField::Arguments))
+    }
+
+    pub fn returns(&self) -> RegSet {
+        RegSet::from_bits(self.field(FunctionField::Returns))
+    }
+
+    pub fn clobbers(&self) -> RegSet {
+        RegSet::from_bits(self.field(FunctionField::Clobbers))
+    }
+
+    pub fn overwritten(&self) -> RegSet {
+        RegSet::from_bits(self.field(FunctionField::Overwritten))
+    }
+
+    pub fn stack_delta(&self) -> Option<i32> {
+        (self.field(FunctionField::HasStackDelta) != 0)
+            .then(|| self.field(FunctionField::StackDelta).cast_signed())
+    }
+}
+
+/// A diagnostic in an export.
+#[derive(Clone, Copy, Debug)]
+pub struct ExportDiagnostic<'a> {
+    export: Export<'a>,
+    record: &'a [u8],
+}
+
+impl<'a> ExportDiagnostic<'a> {
+    #[inline(always)]
+    fn field(&self, field: DiagnosticField) -> u32 {
+        u32_at(self.record, field as usize * 4)
+    }
+
+    fn string(&self, field: DiagnosticField) -> &'a str {
+        self.export.string(self.field(field)).unwrap_or_default()
+    }
+
+    pub fn file(&self) -> Option<&'a str> {
+        self.export.file(self.field(DiagnosticField::File))
+    }
+
+    pub fn range(&self) -> Range {
+        range_at(self.record, DiagnosticField::StartLine as usize)
+    }
+
+    pub fn level(&self) -> WarningLevel {
+        if self.field(DiagnosticField::Error) != 0 {
+            WarningLevel::Error
+        } else {
+            WarningLevel::Warning
+        }
+    }
+
+    /// Whether this was found by a lint, rather than by the parser.
+    pub fn is_lint(&self) -> bool {
+        self.field(DiagnosticField::Lint) != 0
+    }
+
+    pub fn code(&self) -> &'a str {
+        self.string(DiagnosticField::Code)
+    }
+
+    pub fn message(&self) -> &'a str {
+        self.string(DiagnosticField::Message)
+    }
+
+    pub fn description(&self) -> &'a str {
+        self.string(DiagnosticField::Description)
+    }
+}
+
+#[cfg(test)]
+mod test {
+    use super::{Export, ExportError};
+    use crate::export::write_export;
+    use crate::helpers::{analyse, FACTORIAL_PROGRAM};
+    use crate::parser::{FileId, LineDisplay, Register};
+    use crate::passes::Manager;
+    use crate::reader::FileTable;
+
+    fn export(program: &str) -> (crate::cfg::Cfg, Vec<u8>) {
+        let cfg = analyse(program);
+        let mut files = FileTable::new();
+        files.insert("test.s".to_owned(), FileId::default());
+        let mut bytes = Vec::new();
+        write_export(&cfg, &files, &[], &Manager::lint(&cfg), &mut bytes).unwrap();
+        (cfg, bytes)
+    }
+
+    #[test]
+    fn exports_are_read_back() {
+        let (cfg, bytes) = export(&format!("{FACTORIAL_PROGRAM}\n li zero, 1\n"));
+        let export = Export::new(&bytes).unwrap();
+        assert_eq!(export.len(), cfg.nodes.len());
+        assert_eq!(export.files().collect::<Vec<_>>(), ["test.s"]);
+
+        for node in &cfg {
+            let read = export.node(node.id().index()).unwrap();
+            let id = node.id();
+            assert_eq!(read.text(), node.node().to_string());
+            assert_eq!(read.range(), node.node().range());
+            assert_eq!(read.file(), Some("test.s"));
+            assert_eq!(read.live_in(), cfg.liveness.live_in[id]);
+            assert_eq!(read.live_out(), cfg.liveness.live_out[id]);
+            assert_eq!(read.u_def(), cfg.liveness.u_def[id]);
+            assert_eq!(read.is_reachable(), cfg.reachable[id]);
+            assert!(read.nexts().eq(node.nexts().iter().map(|x| x.index())));
+            assert!(read.prevs().eq(node.prevs().iter().map(|x| x.index())));
+            assert!(read.reg_values_out().eq(node.reg_values_out().iter()));
+            assert!(read.stack_values_in().eq(node.stack_values_in().iter()));
+            assert_eq!(
+                read.function().map(|x| x.entry()),
+                node.function().as_ref().map(|x| x.entry.id().index())
+            );
+        }
+
+        let func = export.functions().find(|x| x.name() == "fact").unwrap();
+        let entry = export.node(func.entry()).unwrap();
+        assert!(entry.is_function_entry());
+        assert!(func.arguments().contains(Register::X10));
+        assert!(func
+            .nodes()
+            .all(|x| export.node(x).unwrap().function().is_some()));
+
+        let lints = Manager::lint(&cfg);
+        assert_eq!(export.diagnostics().count(), lints.len());
+        let zero = lints.iter().find(|x| x.code() == "save-to-zero").unwrap();
+        let line = zero.range().start.line;
+        let found = export.diagnostics_on("test.s", line).collect::<Vec<_>>();
+        assert!(found
+            .iter()
+            .any(|x| x.code() == "save-to-zero" && x.is_lint()));
+        assert!(found.iter().all(|x| x.range().start.line == line));
+        assert_eq!(export.diagnostics_on("other.s", line).count(), 0);
+    }
+
+    #[test]
+    fn other_bytes_are_not_read() {
+        let (_, bytes) = export(FACTORIAL_PROGRAM);
+        assert_eq!(
+            Export::new(b"nothing").err(),
+            Some(ExportError::NotAnExport)
+        );
+
+        let mut newer = bytes.clone();
+        newer[4] = 99;
+        assert_eq!(
+            Export::new(&newer).err(),
+            Some(ExportError::UnsupportedVersion(99))
+        );
+        assert_eq!(
+            Export::new(&bytes[..bytes.len() - 8]).err(),
+            Some(ExportError::Truncated)
+        );
+
+        let export = Export::new(&bytes).unwrap();
+        assert!(export.node(export.len()).is_none());
+        assert!(export.function(usize::MAX).is_none());
+    }
+}
@@ -0,0 +1,349 @@
+use std::collections::HashMap;
+use std::io::{self, Write};
+
+use crate::analysis::{AvailableValue, RegValues};
+use crate::cfg::{CFGNode, Cfg};
+use crate::parser::{FileId, LineDisplay, ParseError, Range, Register};
+use crate::passes::{LintError, WarningLevel};
+use crate::reader::FileTable;
+
+use super::{
+    DiagnosticField, FunctionField, NodeField, NodeFlags, Section, ValueKind, HEADER, MAGIC, NONE,
+    VERSION,
+};
+
+fn too_large() -> io::Error {
+    io::Error::new(io::ErrorKind::InvalidData, "program is too large to export")
+}
+
+fn word(x: usize) -> io::Result<u32> {
+    u32::try_from(x).map_err(|_| too_large())
+}
+
+/// The known register values, keyed by register number.
+fn regs(values: &RegValues) -> impl Iterator<Item = (i32, AvailableValue)> + '_ {
+    values
+        .iter()
+        .map(|(reg, value)| (i32::from(reg.to_num()), value))
+}
+
+/// A diagnostic, as it is kept in an export.
+struct Found {
+    file: FileId,
+    range: Range,
+    level: WarningLevel,
+    lint: bool,
+    code: &'static str,
+    message: String,
+    description: String,
+}
+
+impl Found {
+    fn key(&self) -> (FileId, usize, usize, usize, usize, &str) {
+        let Range { start, end } = &self.range;
+        (
+            self.file,
+            start.line,
+            start.column,
+            end.line,
+            end.column,
+            self.code,
+        )
+    }
+}
+
+/// The sections of an export as they are being built.
+struct Sections {
+    tables: [Vec<u8>; Section::ALL.len()],
+    /// The index of each string that has been added, so that a string is
+    /// only kept once
+    strings: HashMap<String, u32>,
+    /// The value set of each set of values, by where the set is, since
+    /// nodes share the sets that are the same
+    value_sets: HashMap<usize, u32>,
+}
+
+impl Sections {
+    fn new() -> Self {
+        let mut sections = Sections {
+            tables: Default::default(),
+            strings: HashMap::new(),
+            value_sets: HashMap::new(),
+        };
+        // The empty value set, for values that were never calculated
+        sections.push(Section::ValueSets, &[0, 0]);
+        sections
+    }
+
+    fn push(&mut self, section: Section, words: &[u32]) {
+        let table = &mut self.tables[section as usize];
+        for word in words {
+            table.extend_from_slice(&word.to_le_bytes());
+        }
+    }
+
+    fn len(&self, section: Section) -> usize {
+        self.tables[section as usize].len() / section.record()
+    }
+
+    fn string(&mut self, text: &str) -> io::Result<u32> {
+        if let Some(&index) = self.strings.get(text) {
+            return Ok(index);
+        }
+        let index = word(self.len(Section::Strings))?;
+        let start = word(self.tables[Section::Bytes as usize].len())?;
+        self.tables[Section::Bytes as usize].extend_from_slice(text.as_bytes());
+        self.push(Section::Strings, &[start, word(text.len())?]);
+        self.strings.insert(text.to_owned(), index);
+        Ok(index)
+    }
+
+    /// Add a set of values, if the same set has not been added already.
+    fn value_set<T>(
+        &mut self,
+        set: &T,
+        values: impl IntoIterator<Item = (i32, AvailableValue)>,
+    ) -> io::Result<u32> {
+        let at = std::ptr::from_ref(set) as usize;
+        if let Some(&index) = self.value_sets.get(&at) {
+            return Ok(index);
+        }
+        let start = self.len(Section::Values);
+        for (key, value) in values {
+            let reg = |x: Register| u32::from(x.to_num());
+            let (kind, a, b) = match value {
+                AvailableValue::Constant(x) => (ValueKind::CONSTANT, x.cast_unsigned(), 0),
+                AvailableValue::Address(label) => (ValueKind::ADDRESS, word(label.index())?, 0),
+                AvailableValue::Memory(label, off) => {
+                    (ValueKind::MEMORY, word(label.index())?, off)
+                }
+                AvailableValue::RegisterWithScalar(x, off) => {
+                    (ValueKind::REGISTER_WITH_SCALAR, reg(x), off)
+                }
+                AvailableValue::OriginalRegisterWithScalar(x, off) => {
+                    (ValueKind::ORIGINAL_REGISTER_WITH_SCALAR, reg(x), off)
+                }
+                AvailableValue::MemoryAtRegister(x, off) => {
+                    (ValueKind::MEMORY_AT_REGISTER, reg(x), off)
+                }
+                AvailableValue::MemoryAtOriginalRegister(x, off) => {
+                    (ValueKind::MEMORY_AT_ORIGINAL_REGISTER, reg(x), off)
+                }
+            };
+            self.push(
+                Section::Values,
+                &[key.cast_unsigned(), kind, a, b.cast_unsigned()],
+            );
+        }
+        let len = self.len(Section::Values) - start;
+        let index = word(self.len(Section::ValueSets))?;
+        self.push(Section::ValueSets, &[word(start)?, word(len)?]);
+        self.value_sets.insert(at, index);
+        Ok(index)
+    }
+
+    fn node(&mut self, cfg: &Cfg, node: &CFGNode, function: u32) -> io::Result<()> {
+        let id = node.id();
+        let parsed = node.node();
+        let range = parsed.range();
+        let mut flags = 0;
+        for (set, flag) in [
+            (parsed.is_function_entry(), NodeFlags::FUNCTION_ENTRY),
+            (parsed.is_program_entry(), NodeFlags::PROGRAM_ENTRY),
+            (parsed.is_return(), NodeFlags::RETURN),
+            (parsed.is_ecall(), NodeFlags::ECALL),
+            (cfg.reachable[id], NodeFlags::REACHABLE),
+        ] {
+            if set {
+                flags |= flag;
+            }
+        }
+        let text = self.string(&parsed.to_string())?;
+        drop(parsed);
+
+        let edges = word(self.len(Section::Edges))?;
+        let (nexts, prevs) = (node.nexts(), node.prevs());
+        for &x in nexts.iter().chain(prevs.iter()) {
+            self.push(Section::Edges, &[word(x.index())?]);
+        }
+
+        let (reg_in, reg_out) = (node.reg_values_in(), node.reg_values_out());
+        let (stack_in, stack_out) = (node.stack_values_in(), node.stack_values_out());
+        let reg_in_set = self.value_set(&*reg_in, regs(&reg_in))?;
+        let reg_out_set = self.value_set(&*reg_out, regs(&reg_out))?;
+        let stack_in_set = self.value_set(&*stack_in, stack_in.iter())?;
+        let stack_out_set = self.value_set(&*stack_out, stack_out.iter())?;
+
+        let mut record = [0; NodeField::COUNT];
+        let mut set = |field: NodeField, value: u32| record[field as usize] = value;
+        set(NodeField::File, word(node.node().file().index())?);
+        set(NodeField::Flags, flags);
+        set(NodeField::StartLine, word(range.start.line)?);
+        set(NodeField::StartColumn, word(range.start.column)?);
+        set(NodeField::EndLine, word(range.end.line)?);
+        set(NodeField::EndColumn, word(range.end.column)?);
+        set(NodeField::Text, text);
+        set(NodeField::Function, function);
+        set(NodeField::LiveIn, cfg.liveness.live_in[id].bits());
+        set(NodeField::LiveOut, cfg.liveness.live_out[id].bits());
+        set(NodeField::UDef, cfg.liveness.u_def[id].bits());
+        set(NodeField::Edges, edges);
+        set(NodeField::Nexts, word(nexts.len())?);
+        set(NodeField::Prevs, word(prevs.len())?);
+        set(NodeField::RegValuesIn, reg_in_set);
+        set(NodeField::RegValuesOut, reg_out_set);
+        set(NodeField::StackValuesIn, stack_in_set);
+        set(NodeField::StackValuesOut, stack_out_set);
+        self.push(Section::Nodes, &record);
+        Ok(())
+    }
+
+    fn diagnostic(&mut self, x: &Found) -> io::Result<()> {
+        let mut record = [0; DiagnosticField::COUNT];
+        let mut set = |field: DiagnosticField, value: u32| record[field as usize] = value;
+        set(DiagnosticField::File, word(x.file.index())?);
+        set(DiagnosticField::StartLine, word(x.range.start.line)?);
+        set(DiagnosticField::StartColumn, word(x.range.start.column)?);
+        set(DiagnosticField::EndLine, word(x.range.end.line)?);
+        set(DiagnosticField::EndColumn, word(x.range.end.column)?);
+        set(
+            DiagnosticField::Error,
+            u32::from(matches!(x.level, WarningLevel::Error)),
+        );
+        set(DiagnosticField::Lint, u32::from(x.lint));
+        set(DiagnosticField::Code, self.string(x.code)?);
+        set(DiagnosticField::Message, self.string(&x.message)?);
+        set(DiagnosticField::Description, self.string(&x.description)?);
+        self.push(Section::Diagnostics, &record);
+        Ok(())
+    }
+
+    /// Write the header and then every section, each starting at a multiple
+    /// of four bytes.
+    fn finish<W: Write>(self, mut out: W) -> io::Result<()> {
+        let mut header = Vec::with_capacity(HEADER);
+        header.extend_from_slice(&MAGIC);
+        header.extend_from_slice(&VERSION.to_le_bytes());
+        header.extend_from_slice(&word(Section::ALL.len())?.to_le_bytes());
+        let mut offset = HEADER;
+        for section in Section::ALL {
+            let table = &self.tables[section as usize];
+            header.extend_from_slice(&word(offset)?.to_le_bytes());
+            header.extend_from_slice(&word(self.len(section))?.to_le_bytes());
+            offset += table.len().next_multiple_of(4);
+        }
+        word(offset)?;
+
+        out.write_all(&header)?;
+        for table in &self.tables {
+            out.write_all(table)?;
+            out.write_all(&[0; 3][..table.len().next_multiple_of(4) - table.len()])?;
+        }
+        out.flush()
+    }
+}
+
+/// Write everything that is known about an analysed graph, and the
+/// diagnostics that were found for it, to `out` as an export. See `layout`
+/// for how it is laid out, and `Export` to read it.
+///
+/// The graph should have had every generation pass run on it. `files` are
+/// the files that the graph was read from, which its nodes refer to by id.
+pub fn write_export<W: Write>(
+    cfg: &Cfg,
+    files: &FileTable,
+    parse_errors: &[ParseError],
+    lints: &[LintError],
+    out: W,
+) -> io::Result<()> {
+    let mut sections = Sections::new();
+
+    for (id, path) in files.iter() {
+        let path = sections.string(path)?;
+        sections.push(Section::Files, &[word(id.index())?, path]);
+    }
+    for index in 0..cfg.labels.len() {
+        let name = cfg.labels.name(crate::cfg::LabelId::new(index)).to_string();
+        let name = sections.string(&name)?;
+        sections.push(Section::Labels, &[name]);
+    }
+
+    // A function with many labels is in the map once for each label
+    let mut funcs = cfg.label_function_map.values().collect::<Vec<_>>();
+    funcs.sort_unstable_by_key(|x| x.entry.id());
+    funcs.dedup_by_key(|x| x.entry.id());
+    let mut function_of = HashMap::new();
+    for (index, func) in funcs.iter().enumerate() {
+        function_of.insert(func.entry.id(), word(index)?);
+        let name = func
+            .labels()
+            .iter()
+            .map(|x| x.data.to_string())
+            .min()
+            .unwrap_or_default();
+        let summary = cfg.summary(func);
+        let members = word(sections.len(Section::Members))?;
+        for node in &func.nodes {
+            sections.push(Section::Members, &[word(node.id().index())?]);
+        }
+
+        let mut record = [0; FunctionField::COUNT];
+        let mut set = |field: FunctionField, value: u32| record[field as usize] = value;
+        set(FunctionField::Name, sections.string(&name)?);
+        set(FunctionField::Entry, word(func.entry.id().index())?);
+        set(FunctionField::Exit, word(func.exit.id().index())?);
+        set(FunctionField::Members, members);
+        set(FunctionField::MembersLen, word(func.nodes.len())?);
+        set(FunctionField::Arguments, summary.arguments.bits());
+        set(FunctionField::Returns, summary.returns.bits());
+        set(FunctionField::Clobbers, summary.clobbers.bits());
+        set(FunctionField::Overwritten, summary.overwritten.bits());
+        set(
+            FunctionField::StackDelta,
+            summary.stack_delta.unwrap_or(0).cast_unsigned(),
+        );
+        set(
+            FunctionField::HasStackDelta,
+            u32::from(summary.stack_delta.is_some()),
+        );
+        sections.push(Section::Functions, &record);
+    }
+
+    for node in cfg {
+        let function = node
+            .function()
+            .as_ref()
+            .and_then(|x| function_of.get(&x.entry.id()).copied())
+            .unwrap_or(NONE);
+        sections.node(cfg, node, function)?;
+    }
+
+    // Sorted so that the diagnostics of a line can be found by a search
+    let mut diagnostics = parse_errors
+        .iter()
+        .map(|x| Found {
+            file: x.file(),
+            range: x.range(),
+            level: x.into(),
+            lint: false,
+            code: x.code(),
+            message: x.to_string(),
+            description: x.to_string(),
+        })
+        .chain(lints.iter().map(|x| Found {
+            file: x.file(),
+            range: x.range(),
+            level: x.into(),
+            lint: true,
+            code: x.code(),
+            message: x.to_string(),
+            description: x.long_description(),
+        }))
+        .collect::<Vec<_>>();
+    diagnostics.sort_by(|a, b| a.key().cmp(&b.key()));
+    for x in &diagnostics {
+        sections.diagnostic(x)?;
+    }
+
+    sections.finish(out)
+}
@@ -1,45 +1,53 @@
 use crate::{
     cfg::Cfg,
-    passes::{CFGError, GenerationPass},
+    passes::{CFGError, Count, Counters, GenerationPass, NoStats, Recorder},
 };
 
 pub struct EliminateDeadCodeDirectionsPass;
 impl GenerationPass for EliminateDeadCodeDirectionsPass {
     fn run(cfg: &mut Cfg) -> Result<(), Box<CFGError>> {
+        EliminateDeadCodeDirectionsPass::run_recorded(cfg, &mut NoStats);
+        Ok(())
+    }
+}
+
+impl EliminateDeadCodeDirectionsPass {
+    /// Run the pass, counting the nodes it cuts out in `recorder`.
+    pub fn run_recorded<R: Recorder>(cfg: &mut Cfg, recorder: &mut R) {
         // PASS 3:
         // --------------------
         // Eliminate nexts and prevs for dead code
+        //
+        // Mark every node that can be reached from an entry, then cut every
+        // unmarked node out of the graph in one sweep. The prevs of an
+        // unmarked node are unmarked too, so the whole piece of dead code is
+        // cut, no matter what order it is in.
 
-        let nodes = &cfg.nodes;
-        let mut changed = true;
-        while changed {
-            changed = false;
-            let old = nodes.clone();
-            for node in nodes {
-                if node.node().is_return() || node.node().is_any_entry() {
-                    continue;
-                }
-                // If the node has no nexts, remove it from the prevs of all its prevs
-                if node.nexts().is_empty() {
-                    for prev in node.prevs().clone() {
-                        prev.remove_next(node);
-                    }
-                    node.clear_prevs();
-                }
-
-                // If the node has no prevs, remove it from the nexts of all its nexts
-                if node.prevs().is_empty() {
-                    for next in node.nexts().clone() {
-                        next.remove_prev(node);
-                    }
-                    node.clear_nexts();
-                }
+        cfg.mark_reachable();
+        let mut counter = R::Counter::default();
+        counter.add(Counters {
+            iterations: 1,
+            visited: cfg.nodes.len(),
+            changed: 0,
+        });
+        for node in &cfg.nodes {
+            if cfg.reachable[node.id()] {
+                continue;
+            }
+            counter.add(Counters {
+                changed: 1,
+                ..Counters::default()
+            });
+            for &next in node.nexts().iter() {
+                cfg.node(next).remove_prev(node.id());
             }
-            if &old != nodes {
-                changed = true;
+            for &prev in node.prevs().iter() {
+                cfg.node(prev).remove_next(node.id());
             }
+            node.clear_nexts();
+            node.clear_prevs();
         }
 
-        Ok(())
+        recorder.count(counter);
     }
 }
@@ -1,5 +1,3 @@
-use std::rc::Rc;
-
 use crate::{
     cfg::Cfg,
     passes::{CFGError, GenerationPass},
@@ -16,27 +14,28 @@ impl GenerationPass for NodeDirectionPass {
         let mut prev = None;
         for node in nodes {
             // If node jumps to another node, add it to the nexts of the current node and the prevs of the node it jumps to.
-            if let Some(label) = node.node().jumps_to() {
-                let jump_to_node = nodes
-                    .iter()
-                    .find(|n| n.labels.contains(&label))
+            if cfg.labels.jump(node.id()).is_some() {
+                let jump_to_node = cfg
+                    .labels
+                    .jump_target(node.id())
+                    .map(|x| cfg.node(x))
                     .ok_or_else(|| CFGError::UnexpectedError)?;
 
-                node.insert_next(Rc::clone(jump_to_node));
-                jump_to_node.insert_prev(Rc::clone(node));
+                node.insert_next(jump_to_node.id());
+                jump_to_node.insert_prev(node.id());
             }
 
             // Linearly scan for nexts and prevs
             if let Some(prev) = prev {
-                node.insert_prev(Rc::clone(&prev));
-                prev.insert_next(Rc::clone(node));
+                node.insert_prev(prev);
+                cfg.node(prev).insert_next(node.id());
             }
 
             // Set previous node to current node, if it is not a return
             prev = if node.node().is_return() {
                 None
             } else {
-                Some(Rc::clone(node))
+                Some(node.id())
             }
         }
 
@@ -4,14 +4,17 @@ use crate::passes::GenerationPass;
 pub struct EcallTerminationPass;
 impl GenerationPass for EcallTerminationPass {
     fn run(cfg: &mut crate::cfg::Cfg) -> Result<(), Box<CFGError>> {
-        for node in cfg.into_iter() {
+        for node in &cfg.nodes {
             if node.is_program_exit() {
-                for temp_node in node.nexts().clone() {
-                    temp_node.remove_prev(&node);
+                for &next in node.nexts().iter() {
+                    cfg.node(next).remove_prev(node.id());
                 }
                 node.clear_nexts();
             }
         }
+
+        // The code after an exit cannot be reached through it anymore
+        cfg.mark_reachable();
         Ok(())
     }
 }
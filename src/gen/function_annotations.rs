@@ -1,7 +1,7 @@
 use std::{collections::HashMap, rc::Rc, vec};
 
 use crate::{
-    cfg::{Cfg, Function},
+    cfg::{Cfg, Function, NodeId, NodeTable},
     parser::Register,
     parser::{Info, JumpLinkType, LabelString, LineDisplay, ParserNode, With},
     passes::{CFGError, GenerationPass},
@@ -17,117 +17,208 @@ impl GenerationPass for FunctionMarkupPass {
 
         // PASS 1
         // --------------------
-        // Graph traversal to find functions
-
-        for node in cfg.into_iter() {
-            if node.node().is_return() {
-                // Walk backwards from return label to find function starts
-                let mut walked = Vec::new();
-                let mut queue = vec![Rc::clone(&node)];
-                let mut found = Vec::new();
-
-                // For all items in the queue
-                'inner: while let Some(n) = queue.pop() {
-                    walked.push(Rc::clone(&n));
-
-                    // If we reach the program entry, there's an issue
-                    if n.node().is_program_entry() {
-                        return Err(Box::new(CFGError::NoLabelForReturn(node.node().clone())));
+        // Find the entries that can reach each node
+        //
+        // A return belongs to the function entries it can be reached from
+        // without going through another entry. Instead of walking back from
+        // every return, walk forward from every entry once. A node is
+        // visited at most twice: once when its first entry is found and
+        // once more if a second one is.
+
+        let len = cfg.nodes.len();
+        let mut from_program = NodeTable::new(len, false);
+        let mut owner = NodeTable::new(len, Owner::Nothing);
+        for node in &cfg.nodes {
+            let start = node.id();
+            if node.node().is_program_entry() {
+                walk_forward(cfg, start, |x| {
+                    !std::mem::replace(&mut from_program[x], true)
+                });
+            } else if node.node().is_function_entry() {
+                owner[start] = Owner::Entry(start);
+                walk_forward(cfg, start, |x| match owner[x] {
+                    Owner::Nothing => {
+                        owner[x] = Owner::Entry(start);
+                        true
                     }
-
-                    // If we find a function entry, we're done
-                    if n.node().is_function_entry() {
-                        found.push(Rc::clone(&n));
-                        continue 'inner;
+                    Owner::Entry(entry) if entry != start => {
+                        owner[x] = Owner::Many;
+                        true
                     }
+                    Owner::Entry(_) | Owner::Many => false,
+                });
+            }
+        }
 
-                    // Otherwise, add all previous nodes to the queue
-                    for prev in n.prevs().iter() {
-                        if !walked.contains(prev) {
-                            queue.push(Rc::clone(prev));
-                        }
-                    }
-                }
+        // Group the returns by their function, in program order
+        let mut functions: Vec<(NodeId, Vec<NodeId>)> = Vec::new();
+        let mut function_of_entry = HashMap::new();
+        for node in &cfg.nodes {
+            if !node.node().is_return() {
+                continue;
+            }
 
+            // If we reach the program entry, there's an issue
+            let entry = match owner[node.id()] {
+                _ if from_program[node.id()] => {
+                    return Err(Box::new(CFGError::NoLabelForReturn(node.node().clone())));
+                }
+                Owner::Entry(entry) => entry,
                 // If we found multiple function entries, we have a problem
-                if found.len() > 1 {
+                Owner::Many => {
                     return Err(Box::new(CFGError::MultipleLabelsForReturn(
                         node.node().clone(),
-                        found.iter().flat_map(|x| x.labels.clone()).collect(),
+                        entries_reaching(cfg, node.id())
+                            .iter()
+                            .flat_map(|x| cfg.node(*x).labels.clone())
+                            .collect(),
                     )));
                 }
+                // If we found no function entries, we have a problem
+                Owner::Nothing => {
+                    return Err(Box::new(CFGError::NoLabelForReturn(node.node().clone())));
+                }
+            };
 
-                // Otherwise, we found a function and all its nodes
-                if let Some(entry_node) = found.first() {
-                    // Add the function to the map
-                    let func = Rc::new(Function::new(
-                        walked,
-                        Rc::clone(entry_node),
-                        Rc::clone(&node),
-                    ));
-
-                    // The label function map can have multiple entries corresponding to the single
-                    // function, because that function has multiple labels. That makes this a bit
-                    // messy because we want to ensure that every case is covered.
-                    let mut exists = None;
-                    'inn: for label in entry_node.labels() {
-                        if let Some(existing_func) = label_function_map.get(&label) {
-                            // Since we already have a "return" for this function,
-                            // we will convert the new return to an unconditional jump
-                            // to the existing return
-                            exists = Some(existing_func);
-                            break 'inn;
-                        }
-                    }
-
-                    if let Some(existing_func) = exists {
-                        // Convert the return node to an unconditional jump
-
-                        // Get the return node, which will become an unconditional jump
-                        let return_node = Rc::clone(&node);
-
-                        // Get the existing return node -- will stay the same
-                        let existing_return_node = Rc::clone(&existing_func.exit);
-
-                        // Clear nexts of return node, and add existing return
-                        // TODO convert next/prev setting to function to enforce
-                        // At this point, the nexts of the return nodes should be all empty
-                        // TODO assert that the nexts for both don't exist
-                        return_node.clear_nexts();
-                        return_node.insert_next(Rc::clone(&existing_return_node));
-
-                        // Set return node's prev to original return node
-                        existing_return_node.insert_prev(Rc::clone(&return_node));
-
-                        // Convert node to jump
-                        let inf = Info {
-                            token: crate::parser::Token::Symbol("return".to_string()),
-                            pos: return_node.node().range().clone(),
-                            file: return_node.node().file().clone(),
-                        };
-
-                        let inst = With::new(JumpLinkType::Jal, inf.clone());
-                        let rd = With::new(Register::X0, inf.clone());
-                        let name = With::new(LabelString("__return__".to_string()), inf.clone());
-                        let new_node = ParserNode::new_jump_link(inst, rd, name);
-                        return_node.set_node(new_node);
-                    } else {
-                        for label in entry_node.labels() {
-                            label_function_map.insert(label.clone(), Rc::clone(&func));
-                        }
-                    }
+            let index = *function_of_entry.entry(entry).or_insert_with(|| {
+                functions.push((entry, Vec::new()));
+                functions.len() - 1
+            });
+            functions[index].1.push(node.id());
+        }
 
-                    // Add the function to the nodes
-                    for func_node in &func.nodes {
-                        func_node.set_function(Rc::clone(&func));
+        // PASS 2
+        // --------------------
+        // Collect the nodes of each function
+
+        let mut visited = NodeTable::new(len, false);
+        for (entry, returns) in functions {
+            // Walk backwards from all of the returns at once
+            let mut walked = Vec::new();
+            let mut queue = returns.clone();
+            for &ret in &returns {
+                visited[ret] = true;
+            }
+            while let Some(id) = queue.pop() {
+                walked.push(id);
+                let n = cfg.node(id);
+                if n.node().is_function_entry() {
+                    continue;
+                }
+                for &prev in n.prevs().iter() {
+                    if !std::mem::replace(&mut visited[prev], true) {
+                        queue.push(prev);
                     }
-                } else {
-                    // If we found no function entries, we have a problem
-                    return Err(Box::new(CFGError::NoLabelForReturn(node.node().clone())));
                 }
             }
+            // Dead code can be walked by more than one function
+            for &id in &walked {
+                visited[id] = false;
+            }
+
+            let entry_node = cfg.node(entry);
+            let func = Rc::new(Function::new(
+                walked.into_iter().map(|x| Rc::clone(cfg.node(x))).collect(),
+                Rc::clone(entry_node),
+                Rc::clone(cfg.node(returns[0])),
+            ));
+
+            // The label function map can have multiple entries corresponding to the single
+            // function, because that function has multiple labels.
+            for label in entry_node.labels() {
+                label_function_map.insert(label.clone(), Rc::clone(&func));
+            }
+
+            // Since we already have a "return" for this function, every
+            // other return is converted to an unconditional jump to it
+            for &ret in &returns[1..] {
+                // Get the return node, which will become an unconditional jump
+                let return_node = Rc::clone(cfg.node(ret));
+
+                // Get the existing return node -- will stay the same
+                let existing_return_node = Rc::clone(&func.exit);
+
+                // Clear nexts of return node, and add existing return
+                // TODO convert next/prev setting to function to enforce
+                // At this point, the nexts of the return nodes should be all empty
+                // TODO assert that the nexts for both don't exist
+                return_node.clear_nexts();
+                return_node.insert_next(existing_return_node.id());
+
+                // Set return node's prev to original return node
+                existing_return_node.insert_prev(return_node.id());
+
+                // Convert node to jump
+                let inf = Info {
+                    token: crate::parser::Token::Symbol("return".to_string()),
+                    pos: return_node.node().range().clone(),
+                    file: return_node.node().file().clone(),
+                };
+
+                let inst = With::new(JumpLinkType::Jal, inf.clone());
+                let rd = With::new(Register::X0, inf.clone());
+                let name = With::new(LabelString("__return__".to_string()), inf.clone());
+                let new_node = ParserNode::new_jump_link(inst, rd, name);
+                return_node.set_node(new_node);
+            }
+
+            // Add the function to the nodes
+            for func_node in &func.nodes {
+                func_node.set_function(Rc::clone(&func));
+            }
+        }
+
+        for (label, func) in &label_function_map {
+            if let Some(id) = cfg.labels.id(&label.data) {
+                cfg.labels.set_function(id, Rc::clone(func));
+            }
         }
         cfg.label_function_map = label_function_map;
         Ok(())
     }
 }
+
+/// The function entries that can reach a node.
+#[derive(Clone, Copy, Debug, PartialEq, Eq)]
+enum Owner {
+    Nothing,
+    Entry(NodeId),
+    Many,
+}
+
+/// Walk forward from `start`, calling `enter` on every node that is found
+/// and walking on from it if it returns true.
+///
+/// Entries are never entered, since the code after them belongs to them.
+fn walk_forward(cfg: &Cfg, start: NodeId, mut enter: impl FnMut(NodeId) -> bool) {
+    let mut stack = vec![start];
+    while let Some(id) = stack.pop() {
+        for &next in cfg.node(id).nexts().iter() {
+            if !cfg.node(next).node().is_any_entry() && enter(next) {
+                stack.push(next);
+            }
+        }
+    }
+}
+
+/// The function entries that a node can be reached from, by walking
+/// backwards from it.
+fn entries_reaching(cfg: &Cfg, id: NodeId) -> Vec<NodeId> {
+    let mut visited = NodeTable::new(cfg.nodes.len(), false);
+    let mut queue = vec![id];
+    let mut found = Vec::new();
+    visited[id] = true;
+    while let Some(id) = queue.pop() {
+        let n = cfg.node(id);
+        if n.node().is_function_entry() {
+            found.push(id);
+            continue;
+        }
+        for &prev in n.prevs().iter() {
+            if !std::mem::replace(&mut visited[prev], true) {
+                queue.push(prev);
+            }
+        }
+    }
+    found
+}
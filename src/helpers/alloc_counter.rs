@@ -0,0 +1,112 @@
+use std::alloc::{GlobalAlloc, Layout, System};
+use std::cell::Cell;
+
+// An allocator that counts the allocations made by the current thread, so
+// tests can check that a piece of code does not allocate, and benchmarks can
+// report how much a stage allocates. Tests run on separate threads, so they
+// do not see each other's allocations.
+
+struct CountingAllocator;
+
+thread_local! {
+    static ALLOCATIONS: Cell<usize> = const { Cell::new(0) };
+    /// Bytes allocated by this thread that have not been freed. Memory can
+    /// be freed by another thread, so this can go below zero.
+    static LIVE: Cell<isize> = const { Cell::new(0) };
+    static PEAK: Cell<isize> = const { Cell::new(0) };
+}
+
+fn record_alloc(size: usize) {
+    let _ = ALLOCATIONS.try_with(|x| x.set(x.get() + 1));
+    let _ = LIVE.try_with(|live| {
+        live.set(live.get() + size as isize);
+        let _ = PEAK.try_with(|peak| peak.set(peak.get().max(live.get())));
+    });
+}
+
+fn record_dealloc(size: usize) {
+    let _ = LIVE.try_with(|x| x.set(x.get() - size as isize));
+}
+
+unsafe impl GlobalAlloc for CountingAllocator {
+    unsafe fn alloc(&self, layout: Layout) -> *mut u8 {
+        record_alloc(layout.size());
+        System.alloc(layout)
+    }
+
+    unsafe fn alloc_zeroed(&self, layout: Layout) -> *mut u8 {
+        record_alloc(layout.size());
+        System.alloc_zeroed(layout)
+    }
+
+    unsafe fn realloc(&self, ptr: *mut u8, layout: Layout, new_size: usize) -> *mut u8 {
+        record_dealloc(layout.size());
+        record_alloc(new_size);
+        System.realloc(ptr, layout, new_size)
+    }
+
+    unsafe fn dealloc(&self, ptr: *mut u8, layout: Layout) {
+        record_dealloc(layout.size());
+        System.dealloc(ptr, layout);
+    }
+}
+
+#[global_allocator]
+static ALLOCATOR: CountingAllocator = CountingAllocator;
+
+/// Run `f` and return its result along with the number of allocations it made.
+pub fn count_allocations<T>(f: impl FnOnce() -> T) -> (T, usize) {
+    let before = ALLOCATIONS.with(Cell::get);
+    let res = f();
+    let after = ALLOCATIONS.with(Cell::get);
+    (res, after - before)
+}
+
+/// What a piece of code allocated on the current thread.
+#[derive(Clone, Copy, Debug, Default, PartialEq, Eq)]
+pub struct AllocationStats {
+    pub allocations: usize,
+    /// The most bytes that were allocated at once, on top of what was
+    /// already allocated when the code started
+    pub peak_bytes: usize,
+}
+
+/// Run `f` and return its result along with what it allocated.
+pub fn measure_allocations<T>(f: impl FnOnce() -> T) -> (T, AllocationStats) {
+    let start = LIVE.with(Cell::get);
+    let outer_peak = PEAK.with(|x| x.replace(start));
+    let (res, allocations) = count_allocations(f);
+    let peak = PEAK.with(|x| x.replace(outer_peak.max(x.get())));
+    let stats = AllocationStats {
+        allocations,
+        peak_bytes: usize::try_from(peak - start).unwrap_or(0),
+    };
+    (res, stats)
+}
+
+#[cfg(test)]
+mod test {
+    use super::{count_allocations, measure_allocations};
+
+    #[test]
+    fn counts_allocations() {
+        let (_, allocations) = count_allocations(|| Box::new(1));
+        assert_eq!(allocations, 1);
+        let (_, allocations) = count_allocations(|| 1 + 1);
+        assert_eq!(allocations, 0);
+    }
+
+    #[test]
+    fn peak_is_measured_from_the_start() {
+        let kept = vec![0u8; 4096];
+        let (_, stats) = measure_allocations(|| {
+            let a = vec![0u8; 1000];
+            drop(a);
+            let b = vec![0u8; 100];
+            drop(b);
+        });
+        assert_eq!(stats.allocations, 2);
+        assert_eq!(stats.peak_bytes, 1000);
+        drop(kept);
+    }
+}
@@ -1,10 +1,20 @@
 #![allow(dead_code)]
 
-use crate::parser::Lexer;
-use crate::parser::{Info, Position, Range, Token, With};
+use std::iter::Peekable;
+
+use crate::cfg::Cfg;
+use crate::parser::{FileId, Info, Span, With};
+use crate::parser::{Lexer, RVParser};
+use crate::passes::Manager;
+use crate::reader::{FileReader, FileReaderError};
+
+#[cfg(any(test, feature = "bench"))]
+mod alloc_counter;
+#[cfg(any(test, feature = "bench"))]
+pub use alloc_counter::*;
 
 pub fn tokenize<S: Into<String>>(input: S) -> Vec<Info> {
-    Lexer::new(input, uuid::Uuid::nil()).collect()
+    Lexer::new(input, FileId::default()).collect()
 }
 
 impl<T> With<T>
@@ -12,15 +22,7 @@ where
     T: PartialEq<T>,
 {
     pub fn blank(data: T) -> Self {
-        With {
-            token: Token::Symbol(String::new()),
-            pos: Range {
-                start: Position { line: 0, column: 0 },
-                end: Position { line: 0, column: 0 },
-            },
-            file: uuid::Uuid::nil(),
-            data,
-        }
+        With::at(data, Span::default())
     }
 }
 
@@ -106,3 +108,81 @@ macro_rules! token {
         }
     };
 }
+
+/// A file reader for tests that reads from a single in-memory source.
+///
+/// Includes are not supported.
+pub struct StringFileReader {
+    source: String,
+    file: FileId,
+}
+
+impl StringFileReader {
+    pub fn new<S: Into<String>>(source: S) -> Self {
+        StringFileReader {
+            source: source.into(),
+            file: FileId::default(),
+        }
+    }
+}
+
+impl FileReader for StringFileReader {
+    fn import_file(
+        &mut self,
+        _path: &str,
+        in_file: Option<FileId>,
+    ) -> Result<(FileId, Peekable<Lexer>), FileReaderError> {
+        if in_file.is_some() {
+            return Err(FileReaderError::InternalFileNotFound);
+        }
+        Ok((self.file, Lexer::new(&self.source, self.file).peekable()))
+    }
+
+    fn get_filename(&self, id: FileId) -> Option<String> {
+        (id == self.file).then(|| "test.s".to_owned())
+    }
+}
+
+/// Parse a program and run all generation passes on it.
+pub fn analyse<S: Into<String>>(source: S) -> Cfg {
+    let mut parser = RVParser::new(StringFileReader::new(source));
+    let (nodes, errors) = parser.parse("test.s", true);
+    assert!(errors.is_empty(), "parse errors in test program");
+    Manager::gen_full_cfg(Cfg::new(nodes).expect("invalid graph in test program"))
+        .expect("generation passes failed on test program")
+}
+
+/// A small program with a loop, a recursive function and stack usage, for
+/// tests that need a realistic graph.
+pub const FACTORIAL_PROGRAM: &str = "
+main:
+    li a0, 5
+    li s1, 3
+loop:
+    call fact
+    addi s1, s1, -1
+    bne s1, zero, loop
+    li a7, 1
+    ecall
+    li a7, 10
+    ecall
+
+fact:
+    addi sp, sp, -16
+    sw ra, 12(sp)
+    sw s0, 8(sp)
+    mv s0, a0
+    li t0, 1
+    ble a0, t0, base
+    addi a0, a0, -1
+    call fact
+    mul a0, a0, s0
+    j done
+base:
+    li a0, 1
+done:
+    lw ra, 12(sp)
+    lw s0, 8(sp)
+    addi sp, sp, 16
+    ret
+";
@@ -1,18 +1,15 @@
-use crate::cfg::Cfg;
-use crate::parser::{DirectiveType, ParserNode, RVParser};
-use crate::passes::Manager;
+use crate::lsp::Session;
+use crate::passes::Stats;
 use lsp_types::{Diagnostic, Position, Range};
-use parser::{Lexer, LineDisplay};
-use reader::{FileReader, FileReaderError};
 use serde::{Deserialize, Serialize};
 use serde_wasm_bindgen::to_value;
-use std::collections::HashSet;
-use std::{collections::HashMap, iter::Peekable};
-use uuid::Uuid;
 use wasm_bindgen::prelude::*;
 mod analysis;
 mod cfg;
+pub mod export;
 mod gen;
+#[cfg(test)]
+mod helpers;
 mod lints;
 mod lsp;
 mod parser;
@@ -31,7 +28,7 @@ pub struct WrapperDiag(pub Vec<Diagnostic>);
 
 impl From<WrapperDiag> for JsValue {
     fn from(w: WrapperDiag) -> Self {
-        to_value(&w.0).unwrap()
+        to_value(&w.0).unwrap_or(JsValue::NULL)
     }
 }
 
@@ -64,202 +61,150 @@ impl WrapperDiag {
 //     }
 // }
 
-struct LSPFileReader {
-    file_uris: HashMap<Uuid, LSPRVDocument>,
+#[derive(Deserialize, Clone)]
+pub struct LSPRVDocument {
+    uri: String,
+    text: String,
 }
 
-impl<T> RVParser<T>
-where
-    T: CanGetURIString,
-{
-    fn get_full_url(&self, path: &str, uuid: Uuid) -> String {
-        let doc = self.reader.get_uri_string(uuid);
-        let uri = lsp_types::Url::parse(&doc.uri).unwrap();
-        let fileuri = uri.join(path).unwrap();
-        fileuri.to_string()
-    }
+#[derive(Serialize, Deserialize, Clone)]
+struct LSPRVDiagnostic {
+    uri: String,
+    diagnostics: Vec<Diagnostic>,
+    /// Where the time went while analysing the document, if it is a root
+    /// and statistics were asked for
+    #[serde(default, skip_deserializing, skip_serializing_if = "Option::is_none")]
+    stats: Option<Stats>,
 }
 
-pub trait CanGetURIString: FileReader {
-    fn get_uri_string(&self, uuid: Uuid) -> LSPRVDocument;
+/// A change to the text of a document, in the form of an LSP
+/// `TextDocumentContentChangeEvent`.
+#[derive(Deserialize)]
+struct LSPRVChange {
+    range: Option<Range>,
+    text: String,
 }
 
-impl CanGetURIString for LSPFileReader {
-    fn get_uri_string(&self, uuid: Uuid) -> LSPRVDocument {
-        self.file_uris.get(&uuid).unwrap().clone()
-    }
+/// The progress of `RiscvSession::step`.
+#[derive(Serialize)]
+struct LSPRVProgress {
+    /// The documents whose diagnostics were brought up to date
+    diagnostics: Vec<LSPRVDiagnostic>,
+    done: bool,
 }
 
-impl FileReader for LSPFileReader {
-    fn get_filename(&self, uuid: uuid::Uuid) -> Option<String> {
-        self.file_uris.get(&uuid).map(|x| x.uri.clone())
-    }
-
-    fn import_file(
-        &mut self,
-        path: &str,
-        in_file: Option<uuid::Uuid>,
-    ) -> Result<(Uuid, Peekable<Lexer>), FileReaderError> {
-        // if there is an in_file, find its path and use that as the parent
-        let fulluri = match in_file {
-            Some(uuid) => {
-                let doc = self.file_uris.get(&uuid).unwrap();
-                let uri = lsp_types::Url::parse(&doc.uri).unwrap();
-                let fileuri = uri.join(path).unwrap();
-                fileuri.to_string()
-            }
-            // otherwise, this is the full path to the file, denoted by its uri
-            None => lsp_types::Url::parse(path).unwrap().to_string(),
-        };
-
-        // find file in values of hashmap
-        let doc = self
-            .file_uris
-            .clone()
-            .into_iter()
-            .find(|x| x.1.uri == fulluri);
-
-        // if file not found, return error
-        if doc.is_none() {
-            return Err(FileReaderError::InternalFileNotFound);
-        }
-
-        // if file found, return lexer
-        let doc = doc.unwrap();
-        let lexer = Lexer::new(&doc.1.text, doc.0);
-        Ok((doc.0, lexer.peekable()))
+fn diagnostic_value(
+    session: &Session,
+    uri: String,
+    diagnostics: Vec<Diagnostic>,
+) -> LSPRVDiagnostic {
+    LSPRVDiagnostic {
+        stats: session.stats(&uri).cloned(),
+        uri,
+        diagnostics,
     }
 }
 
-impl LSPFileReader {
-    fn new(docs: Vec<LSPRVDocument>) -> Self {
-        let mut map = HashMap::new();
-
-        for doc in docs {
-            let uuid = Uuid::new_v4();
-            map.insert(uuid, doc);
+fn diagnostics_value(session: &mut Session) -> Result<JsValue, JsValue> {
+    match session.diagnostics() {
+        Ok(diags) => {
+            let errs = diags
+                .into_iter()
+                .map(|(uri, diagnostics)| diagnostic_value(session, uri, diagnostics))
+                .collect::<Vec<_>>();
+            Ok(to_value(&errs)?)
         }
-
-        LSPFileReader { file_uris: map }
+        Err(e) => Ok(WrapperDiag::new(&format!("{:#?}", e)).into()),
     }
 }
 
-#[derive(Deserialize, Clone)]
-pub struct LSPRVDocument {
-    uri: String,
-    text: String,
-}
-
-#[derive(Serialize, Deserialize, Clone)]
-struct LSPRVDiagnostic {
-    uri: String,
-    diagnostics: Vec<Diagnostic>,
+/// The diagnostics of a list of documents.
+///
+/// If `stats` is true, the result of each root document also has a `stats`
+/// field with the time taken by each stage of its analysis. Documents that
+/// are not a list of `{ uri, text }` throw an error.
+#[wasm_bindgen]
+pub fn riscv_get_diagnostics(docs: JsValue, stats: Option<bool>) -> Result<JsValue, JsValue> {
+    let docs: Vec<LSPRVDocument> = serde_wasm_bindgen::from_value(docs)?;
+    let mut session = Session::new();
+    session.record_stats(stats.unwrap_or(false));
+    for doc in docs {
+        session.open(&doc.uri, &doc.text);
+    }
+    diagnostics_value(&mut session)
 }
 
-struct LSPRVSingleDiagnostic {
-    uri: String,
-    diagnostic: Diagnostic,
+/// An analysis session that is kept between edits.
+///
+/// Unlike `riscv_get_diagnostics`, which starts from scratch every time, a
+/// session only lexes the lines that were edited and only analyses the
+/// documents that were affected by an edit.
+#[wasm_bindgen]
+pub struct RiscvSession {
+    session: Session,
 }
 
 #[wasm_bindgen]
-pub fn riscv_get_diagnostics(docs: JsValue) -> JsValue {
-    // convert docs to Vec<LSPRVDocument>
-    let docs: Vec<LSPRVDocument> = serde_wasm_bindgen::from_value(docs).unwrap();
-    // let mut import_map = HashMap::new();
-    let mut imported = HashSet::new();
-
-    // parse and lex all files, without imports and collect that info
-    for doc in docs.clone() {
-        // let mut imports = HashSet::new();
-        let mut parser = RVParser::new(LSPFileReader::new(docs.clone()));
-        let items = parser.parse(&doc.uri, true);
-        for item in items.0 {
-            match item {
-                ParserNode::Directive(x) => match x.dir {
-                    DirectiveType::Include(name) => {
-                        // get full file path
-                        let this_uri = parser.get_full_url(&name.data, x.token.file);
-                        // add to set
-                        imported.insert(this_uri);
-                        // imports.insert(this_uri);
-                    }
-                    _ => {}
-                },
-                _ => {}
-            }
+impl RiscvSession {
+    #[wasm_bindgen(constructor)]
+    #[allow(clippy::new_without_default)]
+    pub fn new() -> RiscvSession {
+        RiscvSession {
+            session: Session::new(),
         }
-        // import_map.insert(doc.uri, imports);
     }
 
-    // filter out files that are imported by anything
-    let to_parse = docs
-        .clone()
-        .into_iter()
-        .filter(|x| !imported.contains(&x.uri));
-
-    // lint errors
-    let mut errs = Vec::new();
-    // parse and lex all files, with imports
-    for doc in to_parse {
-        let mut parser = RVParser::new(LSPFileReader::new(docs.clone()));
-        let items = parser.parse(&doc.uri, false);
-
-        // add parse errors to errs
-        items
-            .1
-            .iter()
-            .map(|x| LSPRVSingleDiagnostic {
-                uri: parser
-                    .reader
-                    .get_filename(x.file())
-                    .unwrap_or("".to_string()),
-                diagnostic: Diagnostic::from(x),
-            })
-            .for_each(|x| errs.push(x));
+    /// Open a document, or replace the text of one that is already open.
+    pub fn open(&mut self, uri: &str, text: &str) {
+        self.session.open(uri, text);
+    }
 
-        // make CFG
-        let cfg = Cfg::new(items.0).unwrap();
-        let res = Manager::run(cfg, false);
-        match res {
-            Ok(new_res) => {
-                // add all lint errors to errs
-                new_res
-                    .iter()
-                    .map(|x| LSPRVSingleDiagnostic {
-                        uri: parser
-                            .reader
-                            .get_filename(x.file())
-                            .unwrap_or("".to_string()),
-                        diagnostic: Diagnostic::from(x),
-                    })
-                    .for_each(|x| errs.push(x));
-            }
-            Err(e) => return WrapperDiag::new(&format!("{:#?}", e)).into(),
+    /// Apply a list of LSP content changes to an open document, in order.
+    /// Changes that are not in that form throw an error, and none of them
+    /// are applied.
+    pub fn change(&mut self, uri: &str, changes: JsValue) -> Result<(), JsValue> {
+        let changes: Vec<LSPRVChange> = serde_wasm_bindgen::from_value(changes)?;
+        for change in changes {
+            self.session.change(uri, change.range, &change.text);
         }
+        Ok(())
     }
 
-    // insert empty vec for each file
-    let mut diag_map = HashMap::new();
-    for doc in docs {
-        diag_map.insert(doc.uri, Vec::new());
+    pub fn close(&mut self, uri: &str) {
+        self.session.close(uri);
     }
 
-    // collect all diagnostics by file
-    for err in errs {
-        let uri = err.uri;
-        let diag = err.diagnostic;
-        let diags = diag_map.entry(uri).or_insert(Vec::new());
-        diags.push(diag);
+    /// Add the time taken by each stage to the results of `diagnostics`.
+    pub fn record_stats(&mut self, record: bool) {
+        self.session.record_stats(record);
     }
 
-    // convert to Vec<LSPRVDiagnostic>
-    let mut errs = Vec::new();
-    for (uri, diags) in diag_map {
-        errs.push(LSPRVDiagnostic {
-            uri: uri,
-            diagnostics: diags,
-        });
+    /// The diagnostics of every open document, in the same form as
+    /// `riscv_get_diagnostics`.
+    pub fn diagnostics(&mut self) -> Result<JsValue, JsValue> {
+        diagnostics_value(&mut self.session)
     }
 
-    serde_wasm_bindgen::to_value(&errs).unwrap()
+    /// Do up to `budget` stages of analysis, returning
+    /// `{ diagnostics, done }`. `diagnostics` holds every diagnostic of each
+    /// document whose analysis finished in this call, in the same form as
+    /// `riscv_get_diagnostics`, and `done` is whether every document is
+    /// up to date.
+    ///
+    /// Each stage is a parse, a pass or the lints of one root document, so
+    /// an editor can call this with a small budget until it is done,
+    /// handling edits in between. Work that an edit made stale is started
+    /// again.
+    pub fn step(&mut self, budget: u32) -> Result<JsValue, JsValue> {
+        let progress = self.session.step(budget as usize);
+        let diagnostics = progress
+            .published
+            .into_iter()
+            .map(|(uri, diagnostics)| diagnostic_value(&self.session, uri, diagnostics))
+            .collect();
+        Ok(to_value(&LSPRVProgress {
+            diagnostics,
+            done: progress.done,
+        })?)
+    }
 }
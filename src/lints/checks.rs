@@ -1,115 +1,78 @@
-use crate::analysis::AvailableRegisterValues;
 use crate::analysis::AvailableValue;
-use crate::analysis::CustomClonedSets;
 use crate::cfg::CFGNode;
 use crate::cfg::Cfg;
+use crate::cfg::Function;
 use crate::parser::ParserNode;
 use crate::parser::RegSets;
 use crate::parser::Register;
 use crate::parser::With;
+use crate::passes::FunctionLint;
 use crate::passes::LintError;
 use crate::passes::LintPass;
-use std::collections::{HashSet, VecDeque};
+use crate::passes::NodeLint;
 use std::rc::Rc;
 
-// If we need to add an error to a register at its first use/store, we need to
-// know their ranges. This function will take a register and return the ranges
-// that need to be annotated. If it cannot find any, then it will return the original
-// node's range.
+// If we need to add an error to a register at its first use, we need to
+// know its range. This function will take a register and return the range
+// of its nearest use after the node, if there is one.
 impl Cfg {
     // TODO move to a more appropriate place
-    // TODO make better, what even is this?
-    fn error_ranges_for_first_usage(node: &Rc<CFGNode>, item: Register) -> Vec<With<Register>> {
-        let mut queue = VecDeque::new();
-        let mut ranges = Vec::new();
-        // push the next nodes onto the queue
-
-        queue.extend(node.nexts().clone().into_iter());
-
-        // keep track of visited nodes
-        let mut visited = HashSet::new();
-        visited.insert(Rc::clone(node));
-
-        // visit each node in the queue
-        // if the error is found, add error
-        // if not, add the next nodes to the queue
-        while let Some(next) = queue.pop_front() {
-            if visited.contains(&next) {
-                continue;
-            }
-            visited.insert(Rc::clone(&next));
-            if next.node().gen_reg().contains(&item) {
-                // find the use
-                let regs = next.node().reads_from();
-                let mut it = None;
-                for reg in regs {
-                    if reg == item {
-                        it = Some(reg);
-                        break;
-                    }
-                }
-                if let Some(reg) = it {
-                    ranges.push(reg);
-                    break;
-                }
-                break;
-            }
-
-            queue.extend(next.nexts().clone().into_iter());
-        }
-        ranges
+    fn error_range_for_first_usage(
+        &self,
+        node: &Rc<CFGNode>,
+        item: Register,
+    ) -> Option<With<Register>> {
+        let next = self.node(self.next_use(node.id(), item)?);
+        let found = next.node().reads_from().into_iter().find(|x| *x == item);
+        found
     }
 }
 
 // Checks are passes that occur after the CFG is built. As much data as possible is collected
 // during the CFG build. Then, the data is applied via a check.
+// Most checks look at one node or one function at a time, so that the lint
+// engine can run all of them in a single walk over the graph.
 
 pub struct SaveToZeroCheck;
-impl LintPass for SaveToZeroCheck {
-    fn run(cfg: &Cfg, errors: &mut Vec<LintError>) {
-        for node in &cfg.clone() {
-            if let Some(register) = node.node().stores_to() {
-                if register == Register::X0 && !node.node().is_return() {
-                    errors.push(LintError::SaveToZero(register.clone()));
-                }
+impl NodeLint for SaveToZeroCheck {
+    fn check(_cfg: &Cfg, node: &Rc<CFGNode>, errors: &mut Vec<LintError>) {
+        if let Some(register) = node.node().stores_to() {
+            if register == Register::X0 && !node.node().is_return() {
+                errors.push(LintError::SaveToZero(register.clone()));
             }
         }
     }
 }
 
 pub struct DeadValueCheck;
-impl LintPass for DeadValueCheck {
-    fn run(cfg: &Cfg, errors: &mut Vec<LintError>) {
-        for (_i, node) in cfg.clone().into_iter().enumerate() {
-            // check for any assignments that don't make it
-            // to the end of the node
-            if let Some(def) = node.node().stores_to() {
-                if !node.live_out().contains(&def.data) {
-                    // TODO dead assignment register
+impl NodeLint for DeadValueCheck {
+    fn check(cfg: &Cfg, node: &Rc<CFGNode>, errors: &mut Vec<LintError>) {
+        // check for any assignments that don't make it
+        // to the end of the node
+        if let Some(def) = node.node().stores_to() {
+            if !cfg.liveness.live_out[node.id()].contains(def.data) {
+                // TODO dead assignment register
 
-                    errors.push(LintError::DeadAssignment(def));
-                }
+                errors.push(LintError::DeadAssignment(def));
             }
+        }
 
-            // check the out of the node for any uses that
-            // should not be there (temporaries)
-            // TODO merge with Callee saved register check
-            if let Some(name) = node.calls_to(cfg) {
-                // check the expected return values of the function:
-                let out: HashSet<Register> = RegSets::caller_saved()
-                    .difference_c(&name.returns())
-                    .intersection_c(&node.live_out());
+        // check the out of the node for any uses that
+        // should not be there (temporaries)
+        // TODO merge with Callee saved register check
+        if let Some(name) = node.calls_to(cfg) {
+            // check the expected return values of the function:
+            let out = (RegSets::caller_saved() - cfg.summary(&name).returns)
+                & cfg.liveness.live_out[node.id()];
 
-                // if there is anything left, then there is an error
-                // for each item, keep going to the next node until a use of
-                // that item is found
-                let mut ranges = Vec::new();
-                for item in out {
-                    ranges.append(&mut Cfg::error_ranges_for_first_usage(&node, item));
-                }
-                for item in ranges {
-                    errors.push(LintError::InvalidUseAfterCall(item, Rc::clone(&name)));
-                }
+            // if there is anything left, then there is an error
+            // for each item, keep going to the next node until a use of
+            // that item is found
+            let ranges = out
+                .into_iter()
+                .filter_map(|x| cfg.error_range_for_first_usage(node, x));
+            for item in ranges {
+                errors.push(LintError::InvalidUseAfterCall(item, Rc::clone(&name)));
             }
         }
     }
@@ -117,25 +80,23 @@ impl LintPass for DeadValueCheck {
 
 // Check if you can enter a function through the first line of code
 // Check if you can enter a function through a jump (a previous exists)
-// Check if any code has no previous (except for the first line of code)
+// Check if any code cannot be reached from an entry
 // TODO fix for program entry
 pub struct ControlFlowCheck;
-impl LintPass for ControlFlowCheck {
-    fn run(cfg: &Cfg, errors: &mut Vec<LintError>) {
-        for (i, node) in cfg.clone().into_iter().enumerate() {
-            match node.node() {
-                ParserNode::FuncEntry(_) => {
-                    if i == 0 || !node.prevs().is_empty() {
-                        if let Some(function) = node.function().clone() {
-                            errors
-                                .push(LintError::ImproperFuncEntry(node.node().clone(), function));
-                        }
+impl NodeLint for ControlFlowCheck {
+    fn check(cfg: &Cfg, node: &Rc<CFGNode>, errors: &mut Vec<LintError>) {
+        let first = node.id().index() == 0;
+        match &*node.node() {
+            ParserNode::FuncEntry(_) => {
+                if first || !node.prevs().is_empty() {
+                    if let Some(function) = node.function().clone() {
+                        errors.push(LintError::ImproperFuncEntry(node.node().clone(), function));
                     }
                 }
-                _ => {
-                    if i != 0 && node.prevs().is_empty() {
-                        errors.push(LintError::UnreachableCode(node.node().clone()));
-                    }
+            }
+            _ => {
+                if !first && !cfg.reachable[node.id()] {
+                    errors.push(LintError::UnreachableCode(node.node().clone()));
                 }
             }
         }
@@ -145,12 +106,10 @@ impl LintPass for ControlFlowCheck {
 // Check if every ecall has a known call number
 // Check if there are any instructions after an ecall to terminate the program
 pub struct EcallCheck;
-impl LintPass for EcallCheck {
-    fn run(cfg: &Cfg, errors: &mut Vec<LintError>) {
-        for (_i, node) in cfg.clone().into_iter().enumerate() {
-            if node.node().is_ecall() && node.known_ecall().is_none() {
-                errors.push(LintError::UnknownEcall(node.node().clone()));
-            }
+impl NodeLint for EcallCheck {
+    fn check(_cfg: &Cfg, node: &Rc<CFGNode>, errors: &mut Vec<LintError>) {
+        if node.node().is_ecall() && node.known_ecall().is_none() {
+            errors.push(LintError::UnknownEcall(node.node().clone()));
         }
     }
 }
@@ -159,43 +118,28 @@ impl LintPass for EcallCheck {
 // Check if there are any in values to the start of functions that are not args or saved registers
 // Check if there are any in values at the start of a program
 pub struct GarbageInputValueCheck;
-impl LintPass for GarbageInputValueCheck {
-    fn run(cfg: &Cfg, errors: &mut Vec<LintError>) {
-        for node in &cfg.clone() {
-            if node.node().is_program_entry() {
-                let mut garbage = node.live_in().clone();
-                garbage.retain(|x| !RegSets::saved().contains(x));
-                if !garbage.is_empty() {
-                    let mut ranges = Vec::new();
-                    for reg in garbage {
-                        let mut ranges_tmp = Cfg::error_ranges_for_first_usage(&node, reg);
-                        ranges.append(&mut ranges_tmp);
-                    }
-                    for range in ranges {
-                        errors.push(LintError::InvalidUseBeforeAssignment(range.clone()));
-                    }
-                }
-            } else if let Some(func) = node.is_function_entry() {
-                let args = func.arguments();
-                let mut garbage = node.live_in().clone();
-                garbage.retain(|reg| !args.contains(reg));
-                garbage.retain(|reg| !RegSets::saved().contains(reg));
-                if !garbage.is_empty() {
-                    let mut ranges = Vec::new();
-                    for reg in garbage {
-                        let mut ranges_tmp = Cfg::error_ranges_for_first_usage(&node, reg);
-                        ranges.append(&mut ranges_tmp);
-                    }
-                    for range in ranges {
-                        errors.push(LintError::InvalidUseBeforeAssignment(range.clone()));
-                    }
-                }
-            }
+impl NodeLint for GarbageInputValueCheck {
+    fn check(cfg: &Cfg, node: &Rc<CFGNode>, errors: &mut Vec<LintError>) {
+        let garbage = if node.node().is_program_entry() {
+            cfg.liveness.live_in[node.id()] - RegSets::saved()
+        } else if let Some(func) = node.is_function_entry() {
+            let args = cfg.summary(&func).arguments;
+            cfg.liveness.live_in[node.id()] - args - RegSets::saved()
+        } else {
+            return;
+        };
+
+        let ranges = garbage
+            .into_iter()
+            .filter_map(|x| cfg.error_range_for_first_usage(node, x));
+        for range in ranges {
+            errors.push(LintError::InvalidUseBeforeAssignment(range));
         }
     }
 }
 
 // Check that we know the stack position at every point in the program (aka. within scopes)
+// This stops at the first error, so it walks the graph by itself.
 pub struct StackCheckPass;
 impl LintPass for StackCheckPass {
     fn run(cfg: &Cfg, errors: &mut Vec<LintError>) {
@@ -203,21 +147,21 @@ impl LintPass for StackCheckPass {
         // check that we know the stack position at every point in the program
         // check that the stack is never in an invalid position
         // TODO move to impl methods
-        'outer: for (_i, node) in cfg.clone().into_iter().enumerate() {
+        'outer: for (_i, node) in cfg.nodes.iter().enumerate() {
             let values = node.reg_values_out();
-            match values.get(&Register::X2) {
+            match values.get(Register::X2) {
                 None => {
                     errors.push(LintError::UnknownStack(node.node().clone()));
                     break 'outer;
                 }
                 Some(x) => {
                     if let AvailableValue::OriginalRegisterWithScalar(reg, off) = x {
-                        if reg != &Register::X2 {
+                        if reg != Register::X2 {
                             errors.push(LintError::InvalidStackPointer(node.node().clone()));
                             break 'outer;
                         }
-                        if off > &0 {
-                            errors.push(LintError::InvalidStackPosition(node.node().clone(), *off));
+                        if off > 0 {
+                            errors.push(LintError::InvalidStackPosition(node.node().clone(), off));
                             break 'outer;
                         }
                     } else {
@@ -234,56 +178,80 @@ impl LintPass for StackCheckPass {
 
 // check if the value of a calle-saved register is read as its original value
 pub struct CalleeSavedGarbageReadCheck;
-impl LintPass for CalleeSavedGarbageReadCheck {
-    fn run(cfg: &Cfg, errors: &mut Vec<LintError>) {
-        for (_i, node) in cfg.nodes.clone().into_iter().enumerate() {
-            for read in node.node().reads_from() {
-                // if the node uses a calle saved register but not a memory access and the value going in is the original value, then we are reading a garbage value
-                // DESIGN DECISION: we allow any memory accesses for calle saved registers
+impl NodeLint for CalleeSavedGarbageReadCheck {
+    fn check(_cfg: &Cfg, node: &Rc<CFGNode>, errors: &mut Vec<LintError>) {
+        for read in node.node().reads_from() {
+            // if the node uses a calle saved register but not a memory access and the value going in is the original value, then we are reading a garbage value
+            // DESIGN DECISION: we allow any memory accesses for calle saved registers
 
-                if RegSets::saved().contains(&read.data)
-                    && (!node.node().is_memory_access())
-                    && node.reg_values_in().is_original_value(read.data)
-                {
-                    errors.push(LintError::InvalidUseBeforeAssignment(read.clone()));
-                    // then we are reading a garbage value
-                }
+            if RegSets::saved().contains(read.data)
+                && (!node.node().is_memory_access())
+                && node.reg_values_in().is_original_value(read.data)
+            {
+                errors.push(LintError::InvalidUseBeforeAssignment(read.clone()));
+                // then we are reading a garbage value
             }
         }
     }
 }
 
 pub struct CalleeSavedRegisterCheck;
-impl LintPass for CalleeSavedRegisterCheck {
-    fn run(cfg: &Cfg, errors: &mut Vec<LintError>) {
-        use Register::{X1, X18, X19, X2, X20, X21, X22, X23, X24, X25, X26, X27, X8, X9};
-        // for all functions
-        for func in cfg.label_function_map.values() {
-            // TODO scan function to find all "first" definitions of function,
-            // then mark those up
+impl FunctionLint for CalleeSavedRegisterCheck {
+    fn check(cfg: &Cfg, func: &Function, errors: &mut Vec<LintError>) {
+        // TODO scan function to find all "first" definitions of function,
+        // then mark those up
 
-            // check if the original values for all calle saved are available at the end
-            let val = func.exit.reg_values_in();
-            for reg in [
-                X1, X2, X8, X9, X18, X19, X20, X21, X22, X23, X24, X25, X26, X27,
-            ] {
-                match val.get(&reg) {
-                    Some(AvailableValue::OriginalRegisterWithScalar(reg2, offset))
-                        if reg2 != &reg || offset != &0 =>
-                    {
-                        errors.push(LintError::OverwriteCalleeSavedRegister(
-                            func.exit.node().clone(),
-                            reg,
-                        ));
-                    }
-                    _ => {
-                        errors.push(LintError::OverwriteCalleeSavedRegister(
-                            func.exit.node().clone(),
-                            reg,
-                        ));
-                    }
-                }
-            }
+        // check if the original values for all calle saved are available at the end
+        for reg in cfg.summary(func).overwritten {
+            errors.push(LintError::OverwriteCalleeSavedRegister(
+                func.exit.node().clone(),
+                reg,
+            ));
         }
     }
 }
+
+#[cfg(test)]
+mod test {
+    use crate::helpers::analyse;
+    use crate::parser::Register;
+    use crate::passes::{LintError, Manager};
+
+    /// The callee-saved registers reported as overwritten, in order.
+    fn overwritten(source: &str) -> Vec<Register> {
+        Manager::lint(&analyse(source))
+            .into_iter()
+            .filter_map(|x| match x {
+                LintError::OverwriteCalleeSavedRegister(_, reg) => Some(reg),
+                _ => None,
+            })
+            .collect()
+    }
+
+    #[test]
+    fn only_overwritten_callee_saved_registers_are_reported() {
+        // Every function used to get a report for each of ra, sp, s0 and
+        // s1 to s11, 14 in all, whether it wrote them or not. Now f only
+        // gets one for s1. The reports for s0, which is saved and
+        // restored, and for the registers that are never written are gone.
+        let reports = overwritten(
+            "main:
+                call f
+                call g
+                li a7, 10
+                ecall
+            f:
+                addi sp, sp, -4
+                sw s0, 0(sp)
+                li s0, 5
+                li s1, 1
+                lw s0, 0(sp)
+                addi sp, sp, 4
+                ret
+            g:
+                ret
+            ",
+        );
+        assert_eq!(reports, vec![Register::X9]);
+    }
+}
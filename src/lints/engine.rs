@@ -0,0 +1,380 @@
+use std::fmt::Display;
+use std::rc::Rc;
+use std::str::FromStr;
+
+use crate::cfg::{CFGNode, Cfg, Facts, Function};
+use crate::passes::{
+    FunctionLint, LintError, LintPass, LintStats, NoStats, NodeLint, Recorder, Stopwatch,
+};
+
+use super::{
+    CalleeSavedGarbageReadCheck, CalleeSavedRegisterCheck, ControlFlowCheck, DeadValueCheck,
+    EcallCheck, GarbageInputValueCheck, SaveToZeroCheck, StackCheckPass,
+};
+
+/// A lint that can be turned on or off.
+#[derive(Clone, Copy, Debug, PartialEq, Eq, Hash)]
+pub enum Lint {
+    SaveToZero,
+    DeadValue,
+    Ecall,
+    ControlFlow,
+    GarbageInputValue,
+    Stack,
+    CalleeSavedRegister,
+    CalleeSavedGarbageRead,
+}
+
+impl Lint {
+    /// Every lint, in the order that they are run in.
+    pub const ALL: [Lint; 8] = [
+        Lint::SaveToZero,
+        Lint::DeadValue,
+        Lint::Ecall,
+        Lint::ControlFlow,
+        Lint::GarbageInputValue,
+        Lint::Stack,
+        Lint::CalleeSavedRegister,
+        Lint::CalleeSavedGarbageRead,
+    ];
+
+    /// The name of the lint, as it is written in a config.
+    pub fn name(self) -> &'static str {
+        match self {
+            Lint::SaveToZero => "save-to-zero",
+            Lint::DeadValue => "dead-value",
+            Lint::Ecall => "ecall",
+            Lint::ControlFlow => "control-flow",
+            Lint::GarbageInputValue => "garbage-input-value",
+            Lint::Stack => "stack",
+            Lint::CalleeSavedRegister => "callee-saved-register",
+            Lint::CalleeSavedGarbageRead => "callee-saved-garbage-read",
+        }
+    }
+
+    /// The facts about each node that the lint reads, other than the
+    /// graph's edges, functions and summaries.
+    pub fn reads(self) -> Option<Facts> {
+        match self {
+            Lint::SaveToZero | Lint::ControlFlow | Lint::CalleeSavedRegister => None,
+            Lint::Ecall | Lint::Stack | Lint::CalleeSavedGarbageRead => Some(Facts::RegValues),
+            Lint::DeadValue | Lint::GarbageInputValue => Some(Facts::Liveness),
+        }
+    }
+
+    #[inline(always)]
+    fn bit(self) -> u16 {
+        1 << self as u16
+    }
+}
+
+impl Display for Lint {
+    fn fmt(&self, f: &mut std::fmt::Formatter<'_>) -> std::fmt::Result {
+        f.write_str(self.name())
+    }
+}
+
+impl FromStr for Lint {
+    type Err = String;
+
+    fn from_str(s: &str) -> Result<Self, Self::Err> {
+        Lint::ALL
+            .into_iter()
+            .find(|x| x.name() == s)
+            .ok_or_else(|| {
+                let names = Lint::ALL.map(Lint::name).join(", ");
+                format!("unknown lint `{s}`, expected one of: {names}")
+            })
+    }
+}
+
+/// The lints that are enabled. Every lint is enabled by default.
+#[derive(Clone, Copy, Debug, PartialEq, Eq)]
+pub struct LintConfig {
+    enabled: u16,
+}
+
+impl Default for LintConfig {
+    fn default() -> Self {
+        LintConfig::all()
+    }
+}
+
+impl LintConfig {
+    pub fn all() -> Self {
+        LintConfig {
+            enabled: Lint::ALL.into_iter().fold(0, |acc, x| acc | x.bit()),
+        }
+    }
+
+    pub fn none() -> Self {
+        LintConfig { enabled: 0 }
+    }
+
+    pub fn enable(&mut self, lint: Lint) {
+        self.enabled |= lint.bit();
+    }
+
+    pub fn disable(&mut self, lint: Lint) {
+        self.enabled &= !lint.bit();
+    }
+
+    #[inline(always)]
+    pub fn is_enabled(&self, lint: Lint) -> bool {
+        self.enabled & lint.bit() != 0
+    }
+}
+
+type NodeCheck = fn(&Cfg, &Rc<CFGNode>, &mut Vec<LintError>);
+type FunctionCheck = fn(&Cfg, &Function, &mut Vec<LintError>);
+type GraphCheck = fn(&Cfg, &mut Vec<LintError>);
+
+/// Runs every enabled lint over a graph.
+///
+/// The node lints share a single walk over the nodes, and the function
+/// lints share a single walk over the functions. Lints that are disabled
+/// are never added to the engine, so they cost nothing.
+#[derive(Clone, Debug, Default)]
+pub struct LintEngine {
+    nodes: Vec<(Lint, NodeCheck)>,
+    functions: Vec<(Lint, FunctionCheck)>,
+    graphs: Vec<(Lint, GraphCheck)>,
+}
+
+impl LintEngine {
+    pub fn new(config: &LintConfig) -> Self {
+        let mut engine = LintEngine::default();
+        for lint in Lint::ALL.into_iter().filter(|&x| config.is_enabled(x)) {
+            match lint {
+                Lint::SaveToZero => engine.nodes.push((lint, SaveToZeroCheck::check)),
+                Lint::DeadValue => engine.nodes.push((lint, DeadValueCheck::check)),
+                Lint::Ecall => engine.nodes.push((lint, EcallCheck::check)),
+                Lint::ControlFlow => engine.nodes.push((lint, ControlFlowCheck::check)),
+                Lint::GarbageInputValue => {
+                    engine.nodes.push((lint, GarbageInputValueCheck::check));
+                }
+                Lint::Stack => engine.graphs.push((lint, StackCheckPass::run)),
+                Lint::CalleeSavedRegister => {
+                    engine
+                        .functions
+                        .push((lint, CalleeSavedRegisterCheck::check));
+                }
+                Lint::CalleeSavedGarbageRead => {
+                    engine
+                        .nodes
+                        .push((lint, CalleeSavedGarbageReadCheck::check));
+                }
+            }
+        }
+        engine
+    }
+
+    pub fn run(&self, cfg: &Cfg) -> Vec<LintError> {
+        self.run_recorded(cfg, &mut NoStats)
+    }
+
+    /// Run every enabled lint, like `run`, recording the time of each lint.
+    pub fn run_recorded<R: Recorder>(&self, cfg: &Cfg, recorder: &mut R) -> Vec<LintError> {
+        let mut errors = Vec::new();
+        self.stream(cfg, recorder, |x| errors.push(x));
+        errors
+    }
+
+    /// Run every enabled lint, passing each error to `emit` as soon as it
+    /// is found instead of collecting them.
+    ///
+    /// Errors are found in the same order every time: node by node, then
+    /// function by function in order of their entries, then by the lints
+    /// of the whole graph. To time them apart, each lint gets a walk of its
+    /// own when statistics are recorded, which takes longer than the shared
+    /// walk.
+    pub fn stream<R: Recorder>(
+        &self,
+        cfg: &Cfg,
+        recorder: &mut R,
+        mut emit: impl FnMut(LintError),
+    ) {
+        let Some(stats) = recorder.stats() else {
+            LintEngine::walk(cfg, &self.nodes, &self.functions, &self.graphs, &mut emit);
+            return;
+        };
+
+        let mut timed = |lint: Lint, f: &dyn Fn(&mut dyn FnMut(LintError))| {
+            let mut errors = 0;
+            let start = Stopwatch::start();
+            f(&mut |x| {
+                errors += 1;
+                emit(x);
+            });
+            stats.lints.push(LintStats {
+                lint,
+                time: start.elapsed(),
+                errors,
+            });
+        };
+        for check in &self.nodes {
+            timed(check.0, &|emit| {
+                LintEngine::walk(cfg, std::slice::from_ref(check), &[], &[], emit);
+            });
+        }
+        for check in &self.functions {
+            timed(check.0, &|emit| {
+                LintEngine::walk(cfg, &[], std::slice::from_ref(check), &[], emit);
+            });
+        }
+        for check in &self.graphs {
+            timed(check.0, &|emit| {
+                LintEngine::walk(cfg, &[], &[], std::slice::from_ref(check), emit);
+            });
+        }
+    }
+
+    /// Run every enabled lint, like `stream`, freeing each of the facts
+    /// about the nodes of the graph as soon as the lints that read it are
+    /// done.
+    ///
+    /// The lints run in one walk for each of the facts, so errors are found
+    /// fact by fact, and in the same order as `stream` within each walk.
+    /// The graph can't be linted again afterwards.
+    pub fn stream_freeing<R: Recorder>(
+        &self,
+        cfg: &mut Cfg,
+        recorder: &mut R,
+        mut emit: impl FnMut(LintError),
+    ) {
+        // Nothing reads the stack values once the graph is generated
+        cfg.free(Facts::StackValues);
+        let phases = [
+            (&[None, Some(Facts::RegValues)][..], Facts::RegValues),
+            (&[Some(Facts::Liveness)][..], Facts::Liveness),
+        ];
+        for (reads, frees) in phases {
+            let phase = self.only(|x| reads.contains(&x.reads()));
+            phase.stream(cfg, recorder, &mut emit);
+            cfg.free(frees);
+        }
+    }
+
+    /// The checks of the lints that `keep` is true for.
+    fn only(&self, keep: impl Fn(Lint) -> bool) -> Self {
+        LintEngine {
+            nodes: self.nodes.iter().copied().filter(|x| keep(x.0)).collect(),
+            functions: self
+                .functions
+                .iter()
+                .copied()
+                .filter(|x| keep(x.0))
+                .collect(),
+            graphs: self.graphs.iter().copied().filter(|x| keep(x.0)).collect(),
+        }
+    }
+
+    fn walk(
+        cfg: &Cfg,
+        nodes: &[(Lint, NodeCheck)],
+        functions: &[(Lint, FunctionCheck)],
+        graphs: &[(Lint, GraphCheck)],
+        emit: &mut dyn FnMut(LintError),
+    ) {
+        // The checks push to this, which is emptied after each of them
+        let mut found = Vec::new();
+
+        if !nodes.is_empty() {
+            for node in cfg {
+                for (_, check) in nodes {
+                    check(cfg, node, &mut found);
+                }
+                found.drain(..).for_each(&mut *emit);
+            }
+        }
+
+        if !functions.is_empty() {
+            // A function with many labels is in the map once for each label
+            let mut funcs = cfg.label_function_map.values().collect::<Vec<_>>();
+            funcs.sort_unstable_by_key(|x| x.entry.id());
+            funcs.dedup_by_key(|x| x.entry.id());
+            for func in funcs {
+                for (_, check) in functions {
+                    check(cfg, func, &mut found);
+                }
+                found.drain(..).for_each(&mut *emit);
+            }
+        }
+
+        for (_, check) in graphs {
+            check(cfg, &mut found);
+            found.drain(..).for_each(&mut *emit);
+        }
+    }
+}
+
+#[cfg(test)]
+mod test {
+    use super::{Lint, LintConfig, LintEngine};
+    use crate::helpers::analyse;
+    use crate::parser::Register;
+    use crate::passes::{LintError, NoStats};
+
+    const PROGRAM: &str = "main:
+        li zero, 1
+        li a7, 3
+        ecall
+        li a7, 10
+        ecall
+    ";
+
+    #[test]
+    fn names_round_trip() {
+        for lint in Lint::ALL {
+            assert_eq!(lint.name().parse::<Lint>(), Ok(lint));
+        }
+        assert!("nothing".parse::<Lint>().is_err());
+    }
+
+    #[test]
+    fn freed_facts_find_the_same_errors() {
+        let sorted = |errors: Vec<LintError>| {
+            let mut errors = errors.iter().map(|x| format!("{x:?}")).collect::<Vec<_>>();
+            errors.sort();
+            errors
+        };
+        let all = LintEngine::new(&LintConfig::default()).run(&analyse(PROGRAM));
+
+        let mut cfg = analyse(PROGRAM);
+        let mut freed = Vec::new();
+        LintEngine::new(&LintConfig::default()).stream_freeing(&mut cfg, &mut NoStats, |x| {
+            freed.push(x);
+        });
+        assert_eq!(sorted(freed), sorted(all));
+
+        assert!(cfg.nodes.iter().all(|x| {
+            cfg.liveness.live_in[x.id()].is_empty() && cfg.liveness.live_out[x.id()].is_empty()
+        }));
+        assert!(cfg
+            .nodes
+            .iter()
+            .all(|x| x.reg_values_in().get(Register::X2).is_none()));
+    }
+
+    #[test]
+    fn disabled_lints_are_not_run() {
+        let cfg = analyse(PROGRAM);
+        let zero =
+            |errors: &[LintError]| errors.iter().any(|x| matches!(x, LintError::SaveToZero(_)));
+
+        let all = LintEngine::new(&LintConfig::default()).run(&cfg);
+        assert!(zero(&all));
+
+        let mut config = LintConfig::default();
+        config.disable(Lint::SaveToZero);
+        let some = LintEngine::new(&config).run(&cfg);
+        assert!(!zero(&some));
+        assert!(!some.is_empty());
+
+        let mut config = LintConfig::none();
+        config.enable(Lint::SaveToZero);
+        let only = LintEngine::new(&config).run(&cfg);
+        assert!(only.iter().all(|x| matches!(x, LintError::SaveToZero(_))));
+        assert_eq!(only.len(), 1);
+    }
+}
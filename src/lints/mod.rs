@@ -1,2 +1,5 @@
 mod checks;
 pub use checks::*;
+
+mod engine;
+pub use engine::*;
@@ -7,6 +7,9 @@ use crate::passes::LintError::*;
 use crate::passes::{LintError, WarningLevel};
 use lsp_types::{Diagnostic, DiagnosticSeverity, Position, Range};
 
+mod session;
+pub use session::*;
+
 impl From<&MyRange> for Range {
     fn from(r: &MyRange) -> Self {
         lsp_types::Range {
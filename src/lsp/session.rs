@@ -0,0 +1,910 @@
+// INCREMENTAL ANALYSIS SESSION
+// ============================
+
+use std::collections::HashMap;
+use std::iter::Peekable;
+use std::sync::Arc;
+use std::time::Duration;
+
+use lsp_types::{Diagnostic, DiagnosticSeverity, Position, Range, Url};
+
+use crate::cfg::Cfg;
+use crate::lints::LintConfig;
+use crate::parser::{
+    DirectiveType, FileId, Info, Lexer, LineDisplay, ParsedFile, ParserNode, RVParser, Token,
+};
+use crate::passes::{CFGError, FileStats, Manager, Stats, Stopwatch};
+use crate::reader::{content_hash, FileReader, FileReaderError, FileTable, ParseCache};
+
+/// The open documents of an editor, and the diagnostics for them.
+///
+/// Documents are kept between edits, along with the work that was done on
+/// them the last time diagnostics were asked for:
+/// - every line keeps its tokens, so only the lines that were edited are
+///   lexed again,
+/// - every document keeps its parse and its list of includes, which are
+///   only found again when the document changes. A document that is
+///   included by many others is only parsed once,
+/// - every root document (one that is not included by any other) keeps its
+///   diagnostics, along with the version of every document it read. The
+///   root is only analysed again if one of those documents changed.
+///
+/// Diagnostics can be asked for all at once, or a few stages of work at a
+/// time with `step`, so that an editor can handle edits in between.
+#[derive(Default)]
+pub struct Session {
+    documents: HashMap<String, Document>,
+    results: HashMap<String, Analysis>,
+    /// The analysis that `step` is part way through, if any
+    job: Option<Job>,
+    parses: ParseCache,
+    /// Source of document versions, so that a document that is closed and
+    /// opened again never has the same version as before.
+    clock: u64,
+    /// The number of times a root document was analysed.
+    analyses: usize,
+    /// Whether each analysis records where its time went.
+    record_stats: bool,
+}
+
+struct Document {
+    id: FileId,
+    version: u64,
+    /// Lines of the document, without their newlines.
+    lines: Vec<Line>,
+    /// The full uris of the documents that this one includes, if they are
+    /// up to date.
+    includes: Option<Vec<String>>,
+    /// A hash of the text, if it is up to date.
+    hash: Option<u64>,
+}
+
+struct Line {
+    text: String,
+    tokens: Option<LineTokens>,
+}
+
+/// The tokens of a single line, lexed on their own as if the line was the
+/// first line of the document.
+struct LineTokens {
+    tokens: Vec<Info>,
+    /// Whether the line was lexed as the last line of the document, which
+    /// has no newline at the end.
+    last: bool,
+    /// Whether the lexer read the whole line. If it stopped early at a
+    /// character it does not know, the rest of the document is never read.
+    complete: bool,
+    /// Whether the tokens are the same as when the line is lexed as part of
+    /// the document. A string that is not closed on its line carries on into
+    /// the next lines, so the document has to be lexed as a whole.
+    local: bool,
+}
+
+/// The diagnostics from analysing a root document.
+struct Analysis {
+    /// Every document that was read, with its version (or `None` if it was
+    /// not open).
+    inputs: Vec<(String, Option<u64>)>,
+    diagnostics: Vec<(String, Diagnostic)>,
+    stats: Option<Stats>,
+}
+
+/// An analysis of a root document that has been started but not finished.
+///
+/// The documents are parsed when the job is made, and every stage after
+/// that is run by its own call to `advance`.
+struct Job {
+    root: String,
+    /// The uri of every document that was read, by its id
+    files: FileTable,
+    /// The documents that were read and the diagnostics found so far
+    analysis: Analysis,
+    /// The stage that runs next, or `None` once the lints have run
+    stage: Option<Stage>,
+}
+
+enum Stage {
+    /// The documents were parsed, and the graph is made next
+    Parsed(Vec<ParserNode>),
+    /// The graph was made and this many generation passes were run on it.
+    /// The lints run after the last pass.
+    Generating(Cfg, usize),
+}
+
+/// What a call to `Session::step` did.
+#[derive(Debug, Default, PartialEq)]
+pub struct Progress {
+    /// The diagnostics of every open document that a finished analysis
+    /// read, sorted by uri. These are every diagnostic of the document, not
+    /// only the ones from that analysis.
+    pub published: Vec<(String, Vec<Diagnostic>)>,
+    /// Whether every root is up to date, so there is nothing more to do
+    /// until a document changes.
+    pub done: bool,
+}
+
+impl Job {
+    /// Run the next stage. Returns true once the diagnostics are complete.
+    fn advance(&mut self) -> Result<bool, Box<CFGError>> {
+        let stats = &mut self.analysis.stats;
+        match self.stage.take() {
+            Some(Stage::Parsed(nodes)) => {
+                self.stage = Some(Stage::Generating(Cfg::new(nodes)?, 0));
+            }
+            Some(Stage::Generating(mut cfg, passes)) if passes < Manager::PASSES => {
+                Manager::gen_pass(&mut cfg, passes, 1, stats)?;
+                self.stage = Some(Stage::Generating(cfg, passes + 1));
+            }
+            Some(Stage::Generating(cfg, _)) => {
+                let lints = Manager::lint_recorded(&cfg, &LintConfig::default(), stats);
+                let files = &self.files;
+                self.analysis.diagnostics.extend(lints.iter().map(|x| {
+                    let uri = files.path(x.file()).unwrap_or_default();
+                    (uri.to_owned(), Diagnostic::from(x))
+                }));
+            }
+            None => {}
+        }
+        Ok(self.stage.is_none())
+    }
+
+    /// The analysis, with a diagnostic at the start of the root for an
+    /// error that stopped it. The diagnostics found before the error are
+    /// kept.
+    fn fail(self, err: &CFGError) -> Analysis {
+        let mut analysis = self.analysis;
+        let diag = Diagnostic {
+            severity: Some(DiagnosticSeverity::ERROR),
+            ..Diagnostic::new_simple(Range::default(), format!("Unable to run lint: {err:?}"))
+        };
+        analysis.diagnostics.push((self.root, diag));
+        analysis
+    }
+}
+
+impl LineTokens {
+    fn new(text: &str, last: bool, id: FileId) -> Self {
+        let source = if last {
+            text.to_owned()
+        } else {
+            format!("{text}\n")
+        };
+        let mut lexer = Lexer::new(source, id);
+        let tokens = lexer.by_ref().collect::<Vec<_>>();
+        let local = !tokens
+            .iter()
+            .any(|x| matches!(&x.token, Token::String(s) if s.contains('\n')));
+        LineTokens {
+            tokens,
+            last,
+            complete: lexer.is_done(),
+            local,
+        }
+    }
+}
+
+impl Document {
+    fn new(text: &str, version: u64, id: FileId) -> Self {
+        Document {
+            id,
+            version,
+            lines: split_lines(text),
+            includes: None,
+            hash: None,
+        }
+    }
+
+    /// The length of the text in bytes.
+    fn len(&self) -> usize {
+        self.lines.iter().map(|x| x.text.len() + 1).sum::<usize>() - 1
+    }
+
+    fn text(&self) -> String {
+        self.lines
+            .iter()
+            .map(|x| x.text.as_str())
+            .collect::<Vec<_>>()
+            .join("\n")
+    }
+
+    fn hash(&mut self) -> u64 {
+        match self.hash {
+            Some(hash) => hash,
+            None => *self.hash.insert(content_hash(&self.text())),
+        }
+    }
+
+    /// Replace the text in `range` with `text`.
+    ///
+    /// Only the lines that the range touches are replaced; every other line
+    /// keeps its tokens.
+    fn splice(&mut self, range: Range, text: &str) {
+        let (start_line, start) = self.offset(range.start);
+        let (end_line, end) = self.offset(range.end);
+        let (end_line, end) = if (end_line, end) < (start_line, start) {
+            (start_line, start)
+        } else {
+            (end_line, end)
+        };
+
+        let mut replaced = self.lines[start_line].text[..start].to_owned();
+        replaced.push_str(text);
+        replaced.push_str(&self.lines[end_line].text[end..]);
+        self.lines
+            .splice(start_line..=end_line, split_lines(&replaced));
+    }
+
+    /// The line and byte offset of an LSP position, which counts characters
+    /// in UTF-16 code units. Positions past the end are clamped to the end.
+    fn offset(&self, pos: Position) -> (usize, usize) {
+        let last = self.lines.len() - 1;
+        let line = pos.line as usize;
+        if line > last {
+            return (last, self.lines[last].text.len());
+        }
+
+        let text = &self.lines[line].text;
+        let mut units = 0;
+        for (i, c) in text.char_indices() {
+            if units >= pos.character as usize {
+                return (line, i);
+            }
+            units += c.len_utf16();
+        }
+        (line, text.len())
+    }
+
+    /// The tokens of the document, lexing only the lines that changed since
+    /// the last call.
+    fn tokens(&mut self) -> Vec<Info> {
+        let count = self.lines.len();
+        let mut tokens = Vec::new();
+        for (row, line) in self.lines.iter_mut().enumerate() {
+            let last = row + 1 == count;
+            let lexed = match &mut line.tokens {
+                Some(x) if x.last == last => x,
+                x => x.insert(LineTokens::new(&line.text, last, self.id)),
+            };
+            if !lexed.local {
+                return Lexer::new(self.text(), self.id).collect();
+            }
+
+            tokens.extend(lexed.tokens.iter().map(|x| {
+                let mut token = x.clone();
+                token.pos.start.line += row;
+                token.pos.end.line += row;
+                token
+            }));
+            if !lexed.complete {
+                break;
+            }
+        }
+        tokens
+    }
+}
+
+fn split_lines(text: &str) -> Vec<Line> {
+    text.split('\n')
+        .map(|x| Line {
+            text: x.to_owned(),
+            tokens: None,
+        })
+        .collect()
+}
+
+impl Session {
+    pub fn new() -> Self {
+        Session::default()
+    }
+
+    fn next_version(&mut self) -> u64 {
+        self.clock += 1;
+        self.clock
+    }
+
+    /// Open a document, or replace the text of one that is already open.
+    pub fn open(&mut self, uri: &str, text: &str) {
+        let version = self.next_version();
+        // A document keeps its id when it is opened again. Once every id
+        // has been given out, new documents share one, and diagnostics in
+        // them may be reported against each other.
+        let id = self.parses.file_id(uri).unwrap_or_default();
+        self.documents
+            .insert(uri.to_owned(), Document::new(text, version, id));
+    }
+
+    /// Record where the time went in each analysis from now on, or stop.
+    ///
+    /// Results from before the change are analysed again, so that every
+    /// root has statistics or none do.
+    pub fn record_stats(&mut self, record: bool) {
+        if self.record_stats != record {
+            self.record_stats = record;
+            self.results.clear();
+        }
+    }
+
+    /// The statistics of the last analysis of a root document, if they
+    /// were recorded.
+    pub fn stats(&self, uri: &str) -> Option<&Stats> {
+        self.results.get(uri).and_then(|x| x.stats.as_ref())
+    }
+
+    /// Close a document.
+    pub fn close(&mut self, uri: &str) {
+        self.documents.remove(uri);
+        self.results.remove(uri);
+        self.parses.remove(uri);
+    }
+
+    /// Change the text of an open document.
+    ///
+    /// The text in `range` is replaced with `text`, or the whole document
+    /// is if there is no range. This is the same as an LSP
+    /// `TextDocumentContentChangeEvent`.
+    pub fn change(&mut self, uri: &str, range: Option<Range>, text: &str) {
+        let version = self.next_version();
+        let Some(doc) = self.documents.get_mut(uri) else {
+            return;
+        };
+        match range {
+            Some(range) => doc.splice(range, text),
+            None => doc.lines = split_lines(text),
+        }
+        doc.version = version;
+        doc.includes = None;
+        doc.hash = None;
+    }
+
+    /// The text of an open document.
+    pub fn text(&self, uri: &str) -> Option<String> {
+        self.documents.get(uri).map(Document::text)
+    }
+
+    /// The root documents, sorted by uri, finding the includes of every
+    /// document that changed. Results of documents that are no longer roots
+    /// are dropped.
+    pub fn roots(&mut self) -> Vec<String> {
+        let mut uris = self.documents.keys().cloned().collect::<Vec<_>>();
+        uris.sort_unstable();
+
+        // Find the documents that are included by anything
+        let mut imported = std::collections::HashSet::new();
+        for uri in &uris {
+            if self.documents[uri].includes.is_none() {
+                let includes = self.find_includes(uri);
+                if let Some(doc) = self.documents.get_mut(uri) {
+                    doc.includes = Some(includes);
+                }
+            }
+            imported.extend(self.documents[uri].includes.iter().flatten().cloned());
+        }
+        let roots = uris
+            .into_iter()
+            .filter(|x| !imported.contains(x))
+            .collect::<Vec<_>>();
+        self.results.retain(|uri, _| roots.contains(uri));
+        roots
+    }
+
+    /// Whether every document that was read still has the same version.
+    fn is_current(&self, inputs: &[(String, Option<u64>)]) -> bool {
+        inputs
+            .iter()
+            .all(|(uri, version)| self.documents.get(uri).map(|x| x.version) == *version)
+    }
+
+    fn is_fresh(&self, root: &str) -> bool {
+        self.results
+            .get(root)
+            .is_some_and(|x| self.is_current(&x.inputs))
+    }
+
+    /// The diagnostics of every open document, sorted by uri.
+    ///
+    /// Documents that are included by another document are analysed as part
+    /// of the document that includes them.
+    pub fn diagnostics(&mut self) -> Result<Vec<(String, Vec<Diagnostic>)>, Box<CFGError>> {
+        // Whatever `step` was doing is done again from the start
+        self.job = None;
+        let roots = self.roots();
+        for root in &roots {
+            if !self.is_fresh(root) {
+                let analysis = self.analyse(root)?;
+                self.results.insert(root.clone(), analysis);
+            }
+        }
+
+        // Collect all diagnostics by document
+        let mut diags = self
+            .documents
+            .keys()
+            .map(|x| (x.clone(), Vec::new()))
+            .collect::<HashMap<_, _>>();
+        for root in &roots {
+            for (uri, diag) in &self.results[root].diagnostics {
+                diags.entry(uri.clone()).or_default().push(diag.clone());
+            }
+        }
+        let mut diags = diags.into_iter().collect::<Vec<_>>();
+        diags.sort_unstable_by(|a, b| a.0.cmp(&b.0));
+        Ok(diags)
+    }
+
+    /// Do up to `budget` stages of the work of keeping diagnostics up to
+    /// date, and publish the diagnostics of the documents of each root that
+    /// was finished.
+    ///
+    /// A stage is the parse of a root, making its graph, one generation
+    /// pass or its lints, so each call takes a bounded amount of time and
+    /// edits can be made between calls. An analysis that read a document
+    /// which was edited since is dropped and started again on the next
+    /// call. Errors that stop an analysis are published as a diagnostic on
+    /// its root, so one broken document does not hold up the others.
+    pub fn step(&mut self, budget: usize) -> Progress {
+        let mut published = std::collections::BTreeSet::new();
+        for _ in 0..budget {
+            let job = self
+                .job
+                .take()
+                .filter(|x| self.is_current(&x.analysis.inputs));
+            let Some(mut job) = job else {
+                match self.roots().into_iter().find(|x| !self.is_fresh(x)) {
+                    Some(root) => self.job = Some(self.start(&root)),
+                    None => break,
+                }
+                continue;
+            };
+            let root = job.root.clone();
+            let analysis = match job.advance() {
+                Ok(false) => {
+                    self.job = Some(job);
+                    continue;
+                }
+                Ok(true) => job.analysis,
+                Err(err) => job.fail(&err),
+            };
+            // A document that the root stopped reading still has to be
+            // published, so that its old diagnostics are cleared
+            let old = self.results.insert(root.clone(), analysis);
+            let read = old.iter().chain(self.results.get(&root));
+            for (uri, _) in read.flat_map(|x| &x.inputs) {
+                if self.documents.contains_key(uri) {
+                    published.insert(uri.clone());
+                }
+            }
+        }
+
+        let published = published
+            .into_iter()
+            .map(|uri| {
+                let mut roots = self.results.iter().collect::<Vec<_>>();
+                roots.sort_unstable_by(|a, b| a.0.cmp(b.0));
+                let diags = roots
+                    .into_iter()
+                    .flat_map(|(_, x)| &x.diagnostics)
+                    .filter(|(x, _)| *x == uri)
+                    .map(|(_, x)| x.clone())
+                    .collect();
+                (uri, diags)
+            })
+            .collect();
+        let done = self.job.is_none() && self.roots().iter().all(|x| self.is_fresh(x));
+        Progress { published, done }
+    }
+
+    /// The diagnostics of every document that a root document read, or
+    /// tried to, analysing the root if any of them changed since the last
+    /// time. Every document is listed, even if it has no diagnostics, so
+    /// that old diagnostics can be cleared.
+    ///
+    /// `cancelled` is checked before each stage of the analysis, which is
+    /// given up on with `None` as soon as it returns true.
+    pub fn analyse_root(
+        &mut self,
+        root: &str,
+        cancelled: impl Fn() -> bool,
+    ) -> Option<Vec<(String, Vec<Diagnostic>)>> {
+        if !self.is_fresh(root) {
+            let mut job = self.start(root);
+            let analysis = loop {
+                if cancelled() {
+                    return None;
+                }
+                match job.advance() {
+                    Ok(false) => {}
+                    Ok(true) => break job.analysis,
+                    Err(err) => break job.fail(&err),
+                }
+            };
+            self.results.insert(root.to_owned(), analysis);
+        }
+
+        let analysis = &self.results[root];
+        let mut diags = std::collections::BTreeMap::<_, Vec<_>>::new();
+        for (uri, _) in &analysis.inputs {
+            diags.entry(uri.clone()).or_default();
+        }
+        for (uri, diag) in &analysis.diagnostics {
+            diags.entry(uri.clone()).or_default().push(diag.clone());
+        }
+        Some(diags.into_iter().collect())
+    }
+
+    /// Find the full uris of the documents that a document includes.
+    fn find_includes(&mut self, uri: &str) -> Vec<String> {
+        let mut parser = RVParser::new(SessionReader::new(&mut self.documents, &self.parses));
+        let (nodes, _) = parser.parse(uri, true);
+        nodes
+            .iter()
+            .filter_map(|x| match x {
+                ParserNode::Directive(x) => match &x.dir {
+                    DirectiveType::Include(name) => join(uri, &name.data),
+                },
+                _ => None,
+            })
+            .collect()
+    }
+
+    /// Parse and lint a root document, along with everything it includes.
+    fn analyse(&mut self, root: &str) -> Result<Analysis, Box<CFGError>> {
+        let mut job = self.start(root);
+        while !job.advance()? {}
+        Ok(job.analysis)
+    }
+
+    /// Parse a root document, along with everything it includes, to start
+    /// analysing it.
+    fn start(&mut self, root: &str) -> Job {
+        self.analyses += 1;
+        let mut stats = self.record_stats.then(Stats::new);
+        let mut reader = SessionReader::new(&mut self.documents, &self.parses);
+        if stats.is_some() {
+            reader.lexed = Some(Vec::new());
+        }
+        let mut parser = RVParser::new(reader);
+        // Time is only measured when it is recorded
+        let start = stats.as_ref().map(|_| Stopwatch::start());
+        let (nodes, errors) = parser.parse(root, false);
+        if let (Some(stats), Some(start)) = (&mut stats, start) {
+            stats.parse = start.elapsed();
+            stats.files = parser.reader.lexed.take().unwrap_or_default();
+        }
+
+        let reader = parser.reader;
+        let diagnostics = errors
+            .iter()
+            .map(|x| (reader.uri(x.file()), Diagnostic::from(x)))
+            .collect::<Vec<_>>();
+        Job {
+            root: root.to_owned(),
+            files: reader.files,
+            analysis: Analysis {
+                inputs: reader.inputs,
+                diagnostics,
+                stats,
+            },
+            stage: Some(Stage::Parsed(nodes)),
+        }
+    }
+}
+
+/// Resolve a path relative to a document uri.
+fn join(base: &str, path: &str) -> Option<String> {
+    Url::parse(base)
+        .and_then(|x| x.join(path))
+        .ok()
+        .map(|x| x.to_string())
+}
+
+/// A file reader over the documents of a session.
+///
+/// Documents are looked up by their uri, and their tokens and parses are
+/// taken from the session, so nothing is copied but the tokens that are
+/// read.
+struct SessionReader<'a> {
+    documents: &'a mut HashMap<String, Document>,
+    parses: &'a ParseCache,
+    /// The uri of every document that was read, by its id
+    files: FileTable,
+    /// Every document that was asked for, with its version at the time
+    inputs: Vec<(String, Option<u64>)>,
+    /// Documents that were found in the cache, by their id
+    cached: HashMap<FileId, Arc<ParsedFile>>,
+    /// The uri and hash of documents that were not
+    uncached: HashMap<FileId, (String, u64)>,
+    /// The documents that were lexed and how long each took, if statistics
+    /// are being recorded
+    lexed: Option<Vec<FileStats>>,
+}
+
+impl<'a> SessionReader<'a> {
+    fn new(documents: &'a mut HashMap<String, Document>, parses: &'a ParseCache) -> Self {
+        SessionReader {
+            documents,
+            parses,
+            files: FileTable::new(),
+            inputs: Vec::new(),
+            cached: HashMap::new(),
+            uncached: HashMap::new(),
+            lexed: None,
+        }
+    }
+
+    fn uri(&self, id: FileId) -> String {
+        self.get_filename(id).unwrap_or_default()
+    }
+}
+
+impl FileReader for SessionReader<'_> {
+    fn import_file(
+        &mut self,
+        path: &str,
+        in_file: Option<FileId>,
+    ) -> Result<(FileId, Peekable<Lexer>), FileReaderError> {
+        // if there is an in_file, the path is relative to it, otherwise
+        // this is the full uri of the document
+        let uri = match in_file {
+            Some(id) => self.files.path(id).and_then(|x| join(x, path)),
+            None => Url::parse(path).ok().map(|x| x.to_string()),
+        }
+        .ok_or(FileReaderError::InvalidPath)?;
+
+        let Some(doc) = self.documents.get_mut(&uri) else {
+            self.inputs.push((uri, None));
+            return Err(FileReaderError::InternalFileNotFound);
+        };
+        self.inputs.push((uri.clone(), Some(doc.version)));
+        if self.files.contains_path(&uri) {
+            return Err(FileReaderError::FileAlreadyRead(uri));
+        }
+
+        // reuse the id of a cached parse, since its nodes refer to it
+        let hash = doc.hash();
+        if let Some(parsed) = self.parses.get(&uri, hash) {
+            if let Some(lexed) = &mut self.lexed {
+                lexed.push(FileStats {
+                    path: uri.clone(),
+                    bytes: doc.len(),
+                    cached: true,
+                    lex: Duration::ZERO,
+                });
+            }
+            let id = parsed.id;
+            self.files.insert(uri, id);
+            self.cached.insert(id, parsed);
+            return Ok((id, Lexer::from_tokens(Vec::new(), id).peekable()));
+        }
+
+        self.files.insert(uri.clone(), doc.id);
+        let start = self.lexed.as_ref().map(|_| Stopwatch::start());
+        let tokens = doc.tokens();
+        if let (Some(lexed), Some(start)) = (&mut self.lexed, start) {
+            lexed.push(FileStats {
+                path: uri.clone(),
+                bytes: doc.len(),
+                cached: false,
+                lex: start.elapsed(),
+            });
+        }
+        self.uncached.insert(doc.id, (uri, hash));
+        Ok((doc.id, Lexer::from_tokens(tokens, doc.id).peekable()))
+    }
+
+    fn get_filename(&self, id: FileId) -> Option<String> {
+        self.files.path(id).map(str::to_owned)
+    }
+
+    fn cached_parse(&self, id: FileId) -> Option<Arc<ParsedFile>> {
+        self.cached.get(&id).cloned()
+    }
+
+    fn store_parse(&mut self, parsed: &Arc<ParsedFile>) {
+        if let Some((uri, hash)) = self.uncached.remove(&parsed.id) {
+            self.parses.insert(&uri, hash, parsed);
+        }
+    }
+}
+
+#[cfg(test)]
+mod test {
+    use lsp_types::{Position, Range};
+
+    use std::sync::Arc;
+
+    use super::{Document, Session};
+    use crate::helpers::FACTORIAL_PROGRAM;
+    use crate::parser::{FileId, Lexer};
+    use crate::reader::content_hash;
+
+    fn range(start: (u32, u32), end: (u32, u32)) -> Range {
+        Range::new(Position::new(start.0, start.1), Position::new(end.0, end.1))
+    }
+
+    #[test]
+    fn line_tokens_match_lexer() {
+        let sources = [
+            FACTORIAL_PROGRAM,
+            "main: # comment\n  la a0, msg\n.data\nmsg: .string \"hi\"\n",
+            "li a0, 1\n# comment at the end",
+            "  .string \"not\nclosed\n  li a0, 1\n",
+            "li a0, 1\n  $ what\nli a1, 2\n",
+            "",
+        ];
+        for source in sources {
+            let mut doc = Document::new(source, 0, FileId::default());
+            let expected = Lexer::new(source, doc.id).collect::<Vec<_>>();
+            assert_eq!(doc.tokens(), expected, "{source:?}");
+        }
+    }
+
+    #[test]
+    fn edits_match_opening() {
+        let mut session = Session::new();
+        session.open("file:///main.s", FACTORIAL_PROGRAM);
+        session.diagnostics().unwrap();
+
+        // Break a register, add a line, then remove the last `ret`
+        session.change("file:///main.s", Some(range((2, 7), (2, 9))), "a1");
+        session.change(
+            "file:///main.s",
+            Some(range((3, 0), (3, 0))),
+            "    li t0, 1\n",
+        );
+        let lines = FACTORIAL_PROGRAM.lines().count() as u32;
+        session.change("file:///main.s", Some(range((lines, 4), (lines, 7))), "");
+
+        let text = session.documents["file:///main.s"].text();
+        assert!(text.starts_with("\nmain:\n    li a1, 5\n    li t0, 1\n    li s1, 3\n"));
+        assert!(text.ends_with("addi sp, sp, 16\n    \n"));
+
+        let mut fresh = Session::new();
+        fresh.open("file:///main.s", &text);
+        assert_eq!(session.diagnostics().unwrap(), fresh.diagnostics().unwrap());
+    }
+
+    #[test]
+    fn unchanged_roots_are_reused() {
+        let mut session = Session::new();
+        session.open("file:///a.s", "main:\n  li a0, 1\n  li a7, 10\n  ecall\n");
+        session.open("file:///b.s", "main:\n  li a0, 1\n  li a7, 10\n  ecall\n");
+        session.diagnostics().unwrap();
+        assert_eq!(session.analyses, 2);
+
+        session.change("file:///b.s", Some(range((1, 5), (1, 7))), "t0");
+        session.diagnostics().unwrap();
+        assert_eq!(session.analyses, 3);
+        session.diagnostics().unwrap();
+        assert_eq!(session.analyses, 3);
+    }
+
+    #[test]
+    fn includes_are_analysed_with_root() {
+        let mut session = Session::new();
+        session.open(
+            "file:///dir/main.s",
+            "main:\n  .include \"lib.s\"\n  li a7, 10\n  ecall\n",
+        );
+        session.diagnostics().unwrap();
+        assert_eq!(session.analyses, 1);
+
+        // Opening the included document changes the analysis of the root,
+        // and editing it analyses the root again
+        session.open("file:///dir/lib.s", "  li a0, 1\n");
+        let diags = session.diagnostics().unwrap();
+        assert_eq!(session.analyses, 2);
+        assert_eq!(diags.len(), 2);
+
+        session.change("file:///dir/lib.s", None, "  li a0, 2\n");
+        session.diagnostics().unwrap();
+        assert_eq!(session.analyses, 3);
+    }
+
+    #[test]
+    fn shared_includes_are_parsed_once() {
+        let mut session = Session::new();
+        let root = "main:\n  .include \"lib.s\"\n  li a7, 10\n  ecall\n";
+        session.open("file:///a.s", root);
+        session.open("file:///b.s", root);
+        session.open("file:///lib.s", "  li a0, 1\n");
+        session.diagnostics().unwrap();
+
+        let hash = content_hash("  li a0, 1\n");
+        let lib = session.parses.get("file:///lib.s", hash).unwrap();
+
+        session.change("file:///a.s", Some(range((2, 5), (2, 7))), "a0");
+        session.diagnostics().unwrap();
+        assert_eq!(session.analyses, 3);
+        let after = session.parses.get("file:///lib.s", hash).unwrap();
+        assert!(Arc::ptr_eq(&lib, &after));
+    }
+
+    #[test]
+    fn steps_publish_each_root() {
+        let mut session = Session::new();
+        session.open(
+            "file:///dir/main.s",
+            "main:\n  .include \"lib.s\"\n  li a7, 10\n  ecall\n",
+        );
+        session.open("file:///dir/lib.s", "  li zero, 1\n");
+        session.open("file:///dir/other.s", "main:\n  li a7, 10\n  ecall\n");
+        let full = session.diagnostics().unwrap();
+
+        // An edit part way through starts the analysis again, and nothing
+        // is published until every stage has run
+        session.change("file:///dir/lib.s", None, "  li zero, 2\n");
+        assert!(session.step(3).published.is_empty());
+        session.change("file:///dir/lib.s", None, "  li zero, 1\n");
+        let mut published = Vec::new();
+        let mut steps = 0;
+        loop {
+            let progress = session.step(1);
+            published.extend(progress.published);
+            steps += 1;
+            if progress.done {
+                break;
+            }
+        }
+        // The parse, the graph, every pass and the lints of one root
+        assert_eq!(steps, 1 + 1 + 7 + 1);
+        assert_eq!(session.analyses, 4);
+
+        let uris = published.iter().map(|x| x.0.as_str()).collect::<Vec<_>>();
+        assert_eq!(uris, ["file:///dir/lib.s", "file:///dir/main.s"]);
+        assert!(full.iter().any(|x| x == &published[0]));
+        assert_eq!(
+            session.step(1),
+            super::Progress {
+                published: vec![],
+                done: true
+            }
+        );
+    }
+
+    #[test]
+    fn failed_roots_do_not_stop_steps() {
+        let mut session = Session::new();
+        session.open("file:///a.s", "main:\n  j nowhere\n");
+        session.open("file:///b.s", "main:\n  li zero, 1\n  li a7, 10\n  ecall\n");
+        assert!(session.diagnostics().is_err());
+
+        let progress = session.step(100);
+        assert!(progress.done);
+        let uris = progress
+            .published
+            .iter()
+            .map(|x| x.0.as_str())
+            .collect::<Vec<_>>();
+        assert_eq!(uris, ["file:///a.s", "file:///b.s"]);
+        assert!(progress.published.iter().all(|x| !x.1.is_empty()));
+    }
+
+    #[test]
+    fn stats_are_recorded_for_roots() {
+        let mut session = Session::new();
+        session.record_stats(true);
+        session.open(
+            "file:///dir/main.s",
+            "main:\n  .include \"lib.s\"\n  li a7, 10\n  ecall\n",
+        );
+        session.open("file:///dir/lib.s", "  li a0, 1\n");
+        session.diagnostics().unwrap();
+        let stats = session.stats("file:///dir/main.s").unwrap();
+        let files = stats
+            .files
+            .iter()
+            .map(|x| x.path.as_str())
+            .collect::<Vec<_>>();
+        assert_eq!(files, ["file:///dir/main.s", "file:///dir/lib.s"]);
+        assert_eq!(stats.files[1].bytes, "  li a0, 1\n".len());
+        assert_eq!(stats.passes.len(), 7);
+        assert!(session.stats("file:///dir/lib.s").is_none());
+
+        // Includes are found before the analysis, which parses everything
+        assert!(stats.files.iter().all(|x| x.cached));
+
+        session.record_stats(false);
+        session.diagnostics().unwrap();
+        assert!(session.stats("file:///dir/main.s").is_none());
+    }
+}
@@ -22,26 +22,39 @@
 #![allow(clippy::too_many_lines)]
 #![allow(clippy::inline_always)]
 
-use std::{collections::HashMap, iter::Peekable, str::FromStr};
+use std::{
+    cell::Cell, collections::HashMap, io, iter::Peekable, path::Path, rc::Rc, str::FromStr,
+    sync::Arc, time::Duration,
+};
 
 use cfg::Cfg;
-use clap::{Args, Parser, Subcommand};
-use parser::{Lexer, RVParser};
+use clap::{Args, Parser, Subcommand, ValueEnum};
+use parser::{FileId, Lexer, ParsedFile, RVParser};
 use std::path::PathBuf;
-use uuid::Uuid;
 
-use crate::{parser::LineDisplay, passes::Manager};
+use crate::{
+    lints::{Lint as LintName, LintConfig},
+    output::{DiagnosticWriter, Format},
+    parser::LineDisplay,
+    passes::{peak_rss, FileStats, LintError, Manager, NoStats, Recorder, Stats, Stopwatch},
+};
 
 mod analysis;
+mod batch;
+mod bench;
 mod cfg;
+mod export;
 mod gen;
 mod helpers;
 mod lints;
+mod lsp;
+mod output;
 mod parser;
 mod passes;
 mod reader;
+mod server;
 
-use reader::{FileReader, FileReaderError};
+use reader::{CachedOutput, DiskCache, FileReader, FileReaderError, FileTable, Input, ParseCache};
 
 #[derive(Parser)]
 #[command(author, version, about)]
@@ -62,18 +75,175 @@ enum Commands {
     /// (not implemented)
     #[clap(name = "fix")]
     Fix(Fix),
+    /// Time each stage of the analysis on generated programs
+    ///
+    /// Allocation counts are only measured when built with the `bench` feature.
+    #[clap(name = "bench")]
+    Bench(Bench),
+    /// Run a language server over stdin and stdout
+    ///
+    /// Documents are analysed on a pool of threads once they have stopped
+    /// changing, with the most recently edited first.
+    #[clap(name = "lsp")]
+    Lsp(Lsp),
+    /// Write the analysis of a file to a binary export, for other tools
+    ///
+    /// The export has every node with its edges, function, liveness and
+    /// available values, every function and every diagnostic. It can be
+    /// queried where it is, without being parsed.
+    #[clap(name = "export")]
+    Export(Export),
 }
 
 #[derive(Args)]
 struct Lint {
-    /// Input file
-    input: PathBuf,
+    /// Input files, directories or patterns (like `subs/*.s`)
+    #[clap(required_unless_present = "files_from")]
+    inputs: Vec<PathBuf>,
+    /// Also lint the files listed in this file, one per line (`-` for stdin)
+    #[clap(long)]
+    files_from: Option<PathBuf>,
     /// Debug mode
     #[clap(short, long)]
     debug: bool,
     /// Remove output
     #[clap(long)]
     no_output: bool,
+    /// Number of threads to use
+    ///
+    /// With many files, this many files are linted at the same time. With a
+    /// single file, its functions are analysed on this many threads.
+    #[clap(short, long, default_value_t = 1)]
+    jobs: usize,
+    /// Lints to turn off (like `--disable dead-value,stack`)
+    #[clap(long, value_delimiter = ',')]
+    disable: Vec<LintName>,
+    /// Only run these lints, instead of all of them
+    #[clap(long, value_delimiter = ',')]
+    only: Vec<LintName>,
+    /// Print the time taken by each stage of the analysis for each file
+    ///
+    /// This includes the lex time of every file and the counters of every
+    /// pass, as a table or as one line of JSON for each file.
+    #[clap(long, value_enum, num_args = 0..=1, require_equals = true, default_missing_value = "human")]
+    stats: Option<StatsFormat>,
+    /// How to write the diagnostics
+    ///
+    /// Every format but `text` writes each diagnostic as soon as it is
+    /// found. With `jsonl` and `sarif`, anything else that would be printed
+    /// goes to stderr.
+    #[clap(long, value_enum, default_value_t = Format::Text)]
+    format: Format,
+    /// Keep the output for each file in this directory, and reuse it while
+    /// the file and everything it includes are unchanged
+    ///
+    /// Nothing is kept or reused with `--stats` or `--debug`, which
+    /// describe the run itself.
+    #[clap(long)]
+    cache_dir: Option<PathBuf>,
+    /// Free what is known about each instruction as soon as nothing will
+    /// read it again, for programs that are too large to analyse otherwise
+    ///
+    /// The lints are run a few at a time, so diagnostics that are written
+    /// as they are found come in a different order.
+    #[clap(long)]
+    low_memory: bool,
+}
+
+#[derive(Clone, Copy, ValueEnum)]
+enum StatsFormat {
+    Human,
+    Json,
+}
+
+impl Lint {
+    /// The lints that are turned on by the arguments.
+    fn config(&self) -> LintConfig {
+        let mut config = if self.only.is_empty() {
+            LintConfig::all()
+        } else {
+            LintConfig::none()
+        };
+        for &lint in &self.only {
+            config.enable(lint);
+        }
+        for &lint in &self.disable {
+            config.disable(lint);
+        }
+        config
+    }
+
+    /// Everything but the file that changes what is written for it.
+    fn options(&self) -> String {
+        format!(
+            "{:?} {:?} {} {}",
+            self.format,
+            self.config(),
+            self.no_output,
+            self.low_memory
+        )
+    }
+}
+
+#[derive(Args)]
+struct Bench {
+    /// Number of functions, or a list of them to see how stages scale (like `100,200,400`)
+    #[clap(long, value_delimiter = ',', default_value = "200")]
+    functions: Vec<usize>,
+    /// Number of other functions that each function calls
+    #[clap(long, default_value_t = 2)]
+    fanout: usize,
+    /// How deeply the loops in each function are nested
+    #[clap(long, default_value_t = 1)]
+    loops: usize,
+    /// How many files deep the chain of includes is
+    #[clap(long, default_value_t = 0)]
+    includes: usize,
+    /// Number of runs of each program, keeping the fastest time of each stage
+    #[clap(long, default_value_t = 5)]
+    iterations: usize,
+    /// Print comma separated values instead of tables
+    #[clap(long)]
+    csv: bool,
+    /// Write the generated programs to this directory instead of timing them
+    #[clap(long)]
+    write: Option<PathBuf>,
+}
+
+impl Bench {
+    fn shapes(&self) -> Vec<bench::CorpusShape> {
+        self.functions
+            .iter()
+            .map(|&functions| bench::CorpusShape {
+                functions,
+                fanout: self.fanout,
+                loops: self.loops,
+                includes: self.includes,
+            })
+            .collect()
+    }
+}
+
+#[derive(Args)]
+struct Lsp {
+    /// Number of threads that analyse documents (all of them by default)
+    #[clap(short, long)]
+    jobs: Option<usize>,
+    /// How long to wait after an edit before analysing, in milliseconds
+    #[clap(long, default_value_t = 200)]
+    debounce: u64,
+}
+
+#[derive(Args)]
+struct Export {
+    /// Input file
+    input: PathBuf,
+    /// Where to write the export
+    #[clap(short, long)]
+    output: PathBuf,
+    /// Number of threads to analyse the functions of the file on
+    #[clap(short, long, default_value_t = 1)]
+    jobs: usize,
 }
 
 #[derive(Args)]
@@ -85,39 +255,73 @@ struct Fix {
     input: PathBuf,
 }
 
-struct IOFileReader {
-    files: HashMap<String, uuid::Uuid>,
+struct IOFileReader<'a> {
+    files: FileTable,
+    /// Parses that are shared with other readers, if any
+    cache: Option<&'a ParseCache>,
+    /// Files that were found in the cache, by their id
+    cached: HashMap<FileId, Arc<ParsedFile>>,
+    /// The path and hash of files that were not, so their parse can be added
+    /// to the cache
+    uncached: HashMap<FileId, (String, u64)>,
+    /// The files that were read and the time that the parser spent lexing
+    /// each, if statistics are being recorded
+    lexed: Option<Vec<(FileStats, Rc<Cell<Duration>>)>>,
+    /// Every file that was imported, or that could not be, with the hash of
+    /// what was read
+    inputs: Vec<Input>,
 }
 
-impl IOFileReader {
-    fn new() -> Self {
+impl<'a> IOFileReader<'a> {
+    fn new(cache: Option<&'a ParseCache>) -> Self {
         IOFileReader {
-            files: HashMap::new(),
+            files: FileTable::new(),
+            cache,
+            cached: HashMap::new(),
+            uncached: HashMap::new(),
+            lexed: None,
+            inputs: Vec::new(),
         }
     }
 }
 
-impl FileReader for IOFileReader {
-    fn get_filename(&self, uuid: uuid::Uuid) -> Option<String> {
-        self.files
-            .iter()
-            .find(|(_, id)| **id == uuid)
-            .map(|(path, _)| path.to_owned())
+impl IOFileReader<'_> {
+    /// The files that were read, with the time spent lexing each.
+    fn take_lexed(&mut self) -> Vec<FileStats> {
+        let lexed = self.lexed.take().unwrap_or_default();
+        lexed
+            .into_iter()
+            .map(|(file, timer)| FileStats {
+                lex: timer.get(),
+                ..file
+            })
+            .collect()
+    }
+}
+
+impl FileReader for IOFileReader<'_> {
+    fn get_filename(&self, id: FileId) -> Option<String> {
+        self.files.path(id).map(str::to_owned)
+    }
+
+    fn cached_parse(&self, id: FileId) -> Option<Arc<ParsedFile>> {
+        self.cached.get(&id).cloned()
+    }
+
+    fn store_parse(&mut self, parsed: &Arc<ParsedFile>) {
+        if let (Some(cache), Some((path, hash))) = (self.cache, self.uncached.remove(&parsed.id)) {
+            cache.insert(&path, hash, parsed);
+        }
     }
 
     fn import_file(
         &mut self,
         path: &str,
-        in_file: Option<uuid::Uuid>,
-    ) -> Result<(Uuid, Peekable<Lexer>), FileReaderError> {
+        in_file: Option<FileId>,
+    ) -> Result<(FileId, Peekable<Lexer>), FileReaderError> {
         let path = if let Some(id) = in_file {
-            // get parent from uuid
-            let parent = self
-                .files
-                .iter()
-                .find(|(_, uuid)| **uuid == id)
-                .map(|(path, _)| path);
-            if let Some(parent) = parent {
+            // get parent from id
+            if let Some(parent) = self.files.path(id) {
                 // join parent path to path
                 let parent = PathBuf::from_str(parent)
                     .ok()
@@ -135,78 +339,355 @@ impl FileReader for IOFileReader {
             let full_path = PathBuf::from_str(path).map_err(|_| FileReaderError::InvalidPath)?;
             full_path
                 .canonicalize()
-                .map_err(|_| FileReaderError::Unexpected)?
+                .map_err(|_| {
+                    self.inputs.push((path.to_owned(), None));
+                    FileReaderError::Unexpected
+                })?
                 .to_str()
                 .ok_or(FileReaderError::Unexpected)?
                 .to_owned()
         };
 
-        // open file and read it
-        let file = match std::fs::read_to_string(path.clone()) {
+        if self.files.contains_path(&path) {
+            return Err(FileReaderError::FileAlreadyRead(path));
+        }
+
+        // open file and read it. The lexer takes the text as it is, so it
+        // is never copied.
+        let file = match std::fs::read_to_string(&path) {
             Ok(file) => file,
-            Err(err) => return Err(FileReaderError::IOError(err)),
+            Err(err) => {
+                self.inputs.push((path, None));
+                return Err(FileReaderError::IOError(err));
+            }
         };
 
-        dbg!(&file);
+        // The nodes of a cached parse refer to the id of their file, so
+        // readers that share a cache take their ids from it. Once it has
+        // none left, this reader numbers the rest of its files itself.
+        let id = match self.cache.map(|x| x.file_id(&path)) {
+            Some(Some(id)) => id,
+            shared => {
+                if shared.is_some() {
+                    self.cache = None;
+                }
+                self.files.unused_id().ok_or(FileReaderError::Unexpected)?
+            }
+        };
+        let hash = reader::content_hash(&file);
+        self.inputs.push((path.clone(), Some(hash)));
+        let cached = self
+            .cache
+            .and_then(|x| x.get(&path, hash))
+            .filter(|x| x.id == id);
 
         // store full path to file
-        let uuid = uuid::Uuid::new_v4();
-        if let Some(_) = self.files.insert(path.to_owned(), uuid) {
-            return Err(FileReaderError::FileAlreadyRead(path.to_owned()));
+        if !self.files.insert(path.clone(), id) {
+            return Err(FileReaderError::FileAlreadyRead(path));
         }
 
+        // The parser lexes as it goes, so the lexer keeps track of its own
+        // time while it is being used
+        let timer = self.lexed.as_mut().map(|lexed| {
+            let timer = Rc::default();
+            let file = FileStats {
+                path: path.clone(),
+                bytes: file.len(),
+                cached: cached.is_some(),
+                lex: Duration::ZERO,
+            };
+            lexed.push((file, Rc::clone(&timer)));
+            timer
+        });
+
+        if let Some(parsed) = cached {
+            self.cached.insert(id, parsed);
+            return Ok((id, Lexer::new(String::new(), id).peekable()));
+        }
+        self.uncached.insert(id, (path, hash));
+
         // create lexer
-        let lexer = Lexer::new(&file, uuid);
+        let lexer = match timer {
+            Some(timer) => Lexer::new(file, id).timed(timer),
+            None => Lexer::new(file, id),
+        };
+
+        Ok((id, lexer.peekable()))
+    }
+}
 
-        Ok((uuid, lexer.peekable()))
+/// Lint a single file, writing everything that should be printed for it.
+///
+/// Files that are included by many of the files in a batch are only parsed
+/// once if a `cache` is shared between them. If there is a `disk` cache, the
+/// output of an unchanged file is written from it without being parsed.
+fn lint_file<W: io::Write>(
+    path: &Path,
+    lint: &Lint,
+    jobs: usize,
+    cache: Option<&ParseCache>,
+    disk: Option<&DiskCache>,
+    out: &mut DiagnosticWriter<W>,
+) -> io::Result<()> {
+    if let Some(disk) = disk.filter(|_| lint.stats.is_none() && !lint.debug) {
+        return lint_file_cached(path, lint, jobs, cache, disk, out);
+    }
+    let Some(format) = lint.stats else {
+        return lint_file_recorded(path, lint, jobs, cache, &mut NoStats, out).map(drop);
+    };
+    let mut stats = Stats::new();
+    lint_file_recorded(path, lint, jobs, cache, &mut stats, out)?;
+    stats.peak_rss = peak_rss();
+    match format {
+        StatsFormat::Human => out.line(format_args!("stats:\n{stats}")),
+        StatsFormat::Json => out.line(serde_json::to_string(&stats)?),
+    }
+}
+
+/// Write the kept output of a file, or lint it and keep its output.
+fn lint_file_cached<W: io::Write>(
+    path: &Path,
+    lint: &Lint,
+    jobs: usize,
+    cache: Option<&ParseCache>,
+    disk: &DiskCache,
+    out: &mut DiagnosticWriter<W>,
+) -> io::Result<()> {
+    let key = DiskCache::key(path, &lint.options());
+    let result = if let Some(result) = disk.get(key) {
+        result
+    } else {
+        let mut part = DiagnosticWriter::new(Vec::new(), out.format());
+        let inputs = lint_file_recorded(path, lint, jobs, cache, &mut NoStats, &mut part)?;
+        let (output, written) = part.into_parts();
+        let result = CachedOutput {
+            inputs,
+            written,
+            output,
+        };
+        if let Err(err) = disk.insert(key, &result) {
+            eprintln!("Unable to cache {}: {err}", path.display());
+        }
+        result
+    };
+    DiagnosticWriter::from_parts(result.output, result.written, out.format()).append(out)
+}
+
+/// Lint a file, returning every file that was read for it.
+fn lint_file_recorded<R: Recorder, W: io::Write>(
+    path: &Path,
+    lint: &Lint,
+    jobs: usize,
+    cache: Option<&ParseCache>,
+    recorder: &mut R,
+    out: &mut DiagnosticWriter<W>,
+) -> io::Result<Vec<Input>> {
+    let mut reader = IOFileReader::new(cache);
+    if recorder.stats().is_some() {
+        reader.lexed = Some(Vec::new());
+    }
+    let mut parser = RVParser::new(reader);
+    let name = path.to_str().expect("unable to convert path to string");
+    let start = Stopwatch::start();
+    let parsed = parser.parse(name, false);
+    if let Some(stats) = recorder.stats() {
+        stats.parse = start.elapsed();
+        stats.files = parser.reader.take_lexed();
+    }
+    let inputs = std::mem::take(&mut parser.reader.inputs);
+    let files = &parser.reader.files;
+    let path_of = |id| files.path(id).unwrap_or(name);
+
+    for err in &parsed.1 {
+        out.parse_error(path_of(err.file()), err)?;
+    }
+
+    let cfg = match Cfg::new(parsed.0) {
+        Ok(cfg) => cfg,
+        _ => return out.failure(name, "Unable to parse file").map(|()| inputs),
+    };
+    // The graph is written with its stack values in debug mode
+    let gen = if lint.low_memory && !lint.debug {
+        Manager::gen_full_cfg_freeing
+    } else {
+        Manager::gen_full_cfg_recorded
+    };
+    let mut cfg = match gen(cfg, jobs, recorder) {
+        Ok(cfg) => cfg,
+        Err(_) if lint.no_output => return Ok(inputs),
+        Err(err) => {
+            return out
+                .failure(name, format_args!("Unable to run lint: {err:#?}"))
+                .map(|()| inputs)
+        }
+    };
+    if lint.debug {
+        out.line(&cfg)?;
+    }
+
+    let config = lint.config();
+    let mut run = |emit: &mut dyn FnMut(LintError)| {
+        if lint.low_memory {
+            Manager::lint_freeing(&mut cfg, &config, recorder, emit);
+        } else {
+            Manager::lint_streamed(&cfg, &config, recorder, emit);
+        }
+    };
+    if lint.no_output {
+        run(&mut drop);
+    } else if out.format().streams() {
+        let mut res = Ok(());
+        run(&mut |err| {
+            if res.is_ok() {
+                res = out.lint_error(path_of(err.file()), &err);
+            }
+        });
+        res?;
+    } else {
+        // Sort by position, so that the text reads from the top of the file
+        let mut lints = Vec::new();
+        run(&mut |err| lints.push(err));
+        lints.sort_by(|a, b| {
+            let key = |x: &LintError| {
+                let range = x.range();
+                let (start, end) = (range.start, range.end);
+                (start.line, start.column, end.line, end.column, x.name())
+            };
+            key(a)
+                .cmp(&key(b))
+                .then_with(|| a.long_description().cmp(&b.long_description()))
+        });
+        for err in &lints {
+            out.lint_error(path_of(err.file()), err)?;
+        }
     }
+    Ok(inputs)
+}
+
+/// Analyse a file and write everything that is known about it to an export.
+fn export_file(args: &Export) -> Result<(), String> {
+    let mut parser = RVParser::new(IOFileReader::new(None));
+    let name = args
+        .input
+        .to_str()
+        .ok_or("unable to convert path to string")?;
+    let (nodes, parse_errors) = parser.parse(name, false);
+    let cfg = Cfg::new(nodes).map_err(|err| format!("Unable to parse file: {err:#?}"))?;
+    let cfg = Manager::gen_full_cfg_with_jobs(cfg, args.jobs)
+        .map_err(|err| format!("Unable to run lint: {err:#?}"))?;
+    let lints = Manager::lint(&cfg);
+
+    let file = std::fs::File::create(&args.output)
+        .map_err(|err| format!("Unable to create {}: {err}", args.output.display()))?;
+    export::write_export(
+        &cfg,
+        &parser.reader.files,
+        &parse_errors,
+        &lints,
+        io::BufWriter::new(file),
+    )
+    .map_err(|err| format!("Unable to write {}: {err}", args.output.display()))
 }
 
 fn main() {
     let args = Cli::parse();
     match args.command {
         Commands::Lint(lint) => {
-            let reader = IOFileReader::new();
-            let mut parser = RVParser::new(reader);
-            let parsed = parser.parse(
-                &lint
-                    .input
-                    .to_str()
-                    .expect("unable to convert path to string"),
-                false,
-            );
-
-            for err in parsed.1 {
-                println!("{}({}, {}): {}", err, err.file(), err.range(), err);
-            }
+            let files = match batch::collect_inputs(&lint.inputs, lint.files_from.as_deref()) {
+                Ok(files) => files,
+                Err(err) => {
+                    println!("Unable to read inputs: {err}");
+                    return;
+                }
+            };
 
-            let cfg = match Cfg::new(parsed.0) {
-                Ok(cfg) => cfg,
-                _ => {
-                    println!("Unable to parse file");
+            let stdout = io::stdout();
+            let mut out = DiagnosticWriter::new(io::BufWriter::new(stdout.lock()), lint.format);
+            let disk = match lint.cache_dir.as_deref().map(DiskCache::new).transpose() {
+                Ok(disk) => disk,
+                Err(err) => {
+                    println!("Unable to open cache directory: {err}");
                     return;
                 }
             };
+            let res = out.begin().and_then(|()| {
+                // A single file is split up by function instead
+                if let [file] = files.as_slice() {
+                    return lint_file(file, &lint, lint.jobs, None, disk.as_ref(), &mut out);
+                }
 
-            let res = Manager::run(cfg.clone(), lint.debug);
-            if !lint.no_output {
-                match res {
-                    Ok(lints) => {
-                        for err in lints {
-                            println!(
-                                "{}({}, {}): {}",
-                                err,
-                                err.file(),
-                                err.range(),
-                                err.long_description()
-                            );
+                let cache = ParseCache::new();
+                let mut res = Ok(());
+                batch::run_ordered(
+                    &files,
+                    lint.jobs,
+                    |file| {
+                        let mut part = DiagnosticWriter::new(Vec::new(), lint.format);
+                        lint_file(file, &lint, 1, Some(&cache), disk.as_ref(), &mut part)
+                            .map(|()| part)
+                    },
+                    |file, part| {
+                        // The first error is kept, like a write error, so
+                        // that a batch fails the same way as a single file
+                        let part = match part {
+                            Ok(part) => part,
+                            Err(err) => {
+                                if res.is_ok() {
+                                    res = Err(err);
+                                }
+                                return;
+                            }
+                        };
+                        if res.is_ok() && lint.format == Format::Text {
+                            res = out.line(format_args!("{}:", file.display()));
+                        }
+                        if res.is_ok() {
+                            res = part.append(&mut out);
                         }
+                    },
+                );
+                res
+            });
+            if let Err(err) = res.and_then(|()| out.finish().map(drop)) {
+                eprintln!("Unable to write output: {err}");
+            }
+        }
+        Commands::Fix(_) => {}
+        Commands::Lsp(lsp) => {
+            let jobs = lsp.jobs.unwrap_or_else(|| {
+                std::thread::available_parallelism().map_or(1, std::num::NonZeroUsize::get)
+            });
+            let options = server::Options {
+                jobs,
+                debounce: std::time::Duration::from_millis(lsp.debounce),
+            };
+            if let Err(err) = server::serve_stdio(options) {
+                eprintln!("Unable to run language server: {err}");
+            }
+        }
+        Commands::Export(args) => {
+            if let Err(err) = export_file(&args) {
+                println!("{err}");
+            }
+        }
+        Commands::Bench(bench) => {
+            let shapes = bench.shapes();
+            if let Some(dir) = &bench.write {
+                for shape in shapes {
+                    let corpus = bench::Corpus::generate(shape);
+                    let dir = dir.join(format!("functions-{}", shape.functions));
+                    if let Err(err) = bench::write_corpus(&corpus, &dir) {
+                        println!("Unable to write {}: {err}", dir.display());
+                        return;
                     }
-                    Err(err) => println!("Unable to run lint: {err:#?}"),
                 }
+                return;
+            }
+            match bench::report(&shapes, bench.iterations, bench.csv) {
+                Ok(out) => print!("{out}"),
+                Err(err) => println!("Unable to run benchmark: {err:#?}"),
             }
         }
-        Commands::Fix(_) => {}
     }
 }
 
@@ -335,6 +816,22 @@ mod tests {
         );
     }
 
+    #[test]
+    fn lex_strings() {
+        let tokens = tokenize(".string \"hi, there\"\n");
+        assert_eq!(
+            tokens,
+            vec![
+                Token::Directive("string".to_owned()),
+                Token::String("hi, there".to_owned()),
+            ]
+        );
+
+        // An unterminated string ends at the end of the file
+        let tokens = tokenize("\"abc");
+        assert_eq!(tokens, vec![Token::String("abc".to_owned())]);
+    }
+
     // #[test]
     // fn parse_int_from_symbol() {
     //     assert_eq!(Imm::from_str("1234").unwrap(), Imm(1234));
@@ -0,0 +1,398 @@
+// DIAGNOSTIC OUTPUT
+// =================
+
+use std::fmt::Display;
+use std::io::{self, Write};
+
+use clap::ValueEnum;
+use serde::{Serialize, Serializer};
+
+use crate::parser::{LineDisplay, ParseError, Range};
+use crate::passes::{LintError, WarningLevel};
+
+/// How diagnostics are written.
+#[derive(Clone, Copy, Debug, PartialEq, Eq, ValueEnum)]
+pub enum Format {
+    /// The full description of each diagnostic, sorted by position
+    Text,
+    /// One `path:line:column: level[code]: message` line for each diagnostic
+    Compact,
+    /// One JSON object for each diagnostic, on its own line
+    Jsonl,
+    /// A SARIF 2.1.0 log
+    Sarif,
+}
+
+impl Format {
+    /// Whether diagnostics are written as they are found, rather than
+    /// sorted first.
+    pub fn streams(self) -> bool {
+        self != Format::Text
+    }
+
+    /// Whether the output is only diagnostics, so nothing else can be
+    /// written in between them.
+    pub fn is_machine_readable(self) -> bool {
+        matches!(self, Format::Jsonl | Format::Sarif)
+    }
+}
+
+/// A diagnostic, as it is written by every format but `Text`.
+struct Record<'a> {
+    kind: &'static str,
+    path: &'a str,
+    code: &'static str,
+    level: WarningLevel,
+    message: &'a dyn Display,
+    description: &'a dyn Display,
+    range: Range,
+}
+
+fn display<S: Serializer>(x: &&dyn Display, s: S) -> Result<S::Ok, S::Error> {
+    s.collect_str(x)
+}
+
+fn level_name(x: &WarningLevel) -> &'static str {
+    match x {
+        WarningLevel::Warning => "warning",
+        WarningLevel::Error => "error",
+    }
+}
+
+#[derive(Serialize)]
+struct Point {
+    line: usize,
+    column: usize,
+}
+
+/// A line of `Jsonl` output. Lines and columns start at 0, like in LSP.
+#[derive(Serialize)]
+struct JsonRecord<'a> {
+    kind: &'static str,
+    file: &'a str,
+    code: &'static str,
+    level: &'static str,
+    #[serde(serialize_with = "display")]
+    message: &'a dyn Display,
+    #[serde(serialize_with = "display")]
+    description: &'a dyn Display,
+    start: Point,
+    end: Point,
+}
+
+#[derive(Serialize)]
+#[serde(rename_all = "camelCase")]
+struct SarifResult<'a> {
+    rule_id: &'static str,
+    level: &'static str,
+    message: SarifMessage<'a>,
+    locations: [SarifLocation<'a>; 1],
+}
+
+#[derive(Serialize)]
+struct SarifMessage<'a> {
+    #[serde(serialize_with = "display")]
+    text: &'a dyn Display,
+}
+
+#[derive(Serialize)]
+#[serde(rename_all = "camelCase")]
+struct SarifLocation<'a> {
+    physical_location: SarifPhysicalLocation<'a>,
+}
+
+#[derive(Serialize)]
+#[serde(rename_all = "camelCase")]
+struct SarifPhysicalLocation<'a> {
+    artifact_location: SarifArtifact<'a>,
+    region: SarifRegion,
+}
+
+#[derive(Serialize)]
+struct SarifArtifact<'a> {
+    uri: &'a str,
+}
+
+/// Lines and columns start at 1 in SARIF.
+#[derive(Serialize)]
+#[serde(rename_all = "camelCase")]
+struct SarifRegion {
+    start_line: usize,
+    start_column: usize,
+    end_line: usize,
+    end_column: usize,
+}
+
+/// Writes diagnostics to `out` in one of the formats.
+///
+/// Every format but `Text` writes each diagnostic as soon as it is given
+/// one, straight to `out` without building a string for it, so `out`
+/// should be buffered.
+pub struct DiagnosticWriter<W: Write> {
+    out: W,
+    format: Format,
+    /// The number of diagnostics written
+    written: usize,
+}
+
+impl<W: Write> DiagnosticWriter<W> {
+    pub fn new(out: W, format: Format) -> Self {
+        DiagnosticWriter {
+            out,
+            format,
+            written: 0,
+        }
+    }
+
+    pub fn format(&self) -> Format {
+        self.format
+    }
+
+    /// Write what comes before the diagnostics.
+    pub fn begin(&mut self) -> io::Result<()> {
+        if self.format == Format::Sarif {
+            write!(
+                self.out,
+                "{{\"version\":\"2.1.0\",\
+                 \"$schema\":\"https://json.schemastore.org/sarif-2.1.0.json\",\
+                 \"runs\":[{{\"tool\":{{\"driver\":{{\"name\":\"{}\",\"version\":\"{}\",\
+                 \"informationUri\":\"{}\"}}}},\"results\":[",
+                env!("CARGO_PKG_NAME"),
+                env!("CARGO_PKG_VERSION"),
+                env!("CARGO_PKG_REPOSITORY"),
+            )?;
+        }
+        Ok(())
+    }
+
+    /// Write what comes after the diagnostics, and flush the output.
+    pub fn finish(mut self) -> io::Result<W> {
+        if self.format == Format::Sarif {
+            writeln!(self.out, "\n]}}]}}")?;
+        }
+        self.out.flush()?;
+        Ok(self.out)
+    }
+
+    /// Write a line that is not a diagnostic, like a header or the graph.
+    ///
+    /// The machine readable formats only hold diagnostics, so these lines
+    /// go to stderr instead.
+    pub fn line(&mut self, text: impl Display) -> io::Result<()> {
+        if self.format.is_machine_readable() {
+            eprintln!("{text}");
+            Ok(())
+        } else {
+            writeln!(self.out, "{text}")
+        }
+    }
+
+    /// Write that a file could not be analysed.
+    pub fn failure(&mut self, path: &str, message: impl Display) -> io::Result<()> {
+        match self.format {
+            Format::Text => writeln!(self.out, "{message}"),
+            Format::Compact => writeln!(self.out, "{path}: error: {message}"),
+            Format::Jsonl | Format::Sarif => {
+                eprintln!("{path}: {message}");
+                Ok(())
+            }
+        }
+    }
+
+    pub fn parse_error(&mut self, path: &str, err: &ParseError) -> io::Result<()> {
+        if self.format == Format::Text {
+            return writeln!(
+                self.out,
+                "{}({}, {}): {}",
+                err,
+                err.file(),
+                err.range(),
+                err
+            );
+        }
+        self.record(&Record {
+            kind: "parse",
+            path,
+            code: err.code(),
+            level: err.into(),
+            message: err,
+            description: err,
+            range: err.range(),
+        })
+    }
+
+    pub fn lint_error(&mut self, path: &str, err: &LintError) -> io::Result<()> {
+        if self.format == Format::Text {
+            return writeln!(
+                self.out,
+                "{}({}, {}): {}",
+                err,
+                err.file(),
+                err.range(),
+                err.description()
+            );
+        }
+        self.record(&Record {
+            kind: "lint",
+            path,
+            code: err.code(),
+            level: err.into(),
+            message: err,
+            description: &err.description(),
+            range: err.range(),
+        })
+    }
+
+    fn record(&mut self, record: &Record) -> io::Result<()> {
+        let Range { start, end } = &record.range;
+        match self.format {
+            Format::Text => unreachable!("text is written by each kind of diagnostic"),
+            Format::Compact => writeln!(
+                self.out,
+                "{}:{}:{}: {}[{}]: {}",
+                record.path,
+                start.line + 1,
+                start.column + 1,
+                level_name(&record.level),
+                record.code,
+                record.message
+            )?,
+            Format::Jsonl => {
+                serde_json::to_writer(
+                    &mut self.out,
+                    &JsonRecord {
+                        kind: record.kind,
+                        file: record.path,
+                        code: record.code,
+                        level: level_name(&record.level),
+                        message: record.message,
+                        description: record.description,
+                        start: Point {
+                            line: start.line,
+                            column: start.column,
+                        },
+                        end: Point {
+                            line: end.line,
+                            column: end.column,
+                        },
+                    },
+                )?;
+                self.out.write_all(b"\n")?;
+            }
+            Format::Sarif => {
+                self.out
+                    .write_all(if self.written == 0 { b"\n" } else { b",\n" })?;
+                serde_json::to_writer(
+                    &mut self.out,
+                    &SarifResult {
+                        rule_id: record.code,
+                        level: level_name(&record.level),
+                        message: SarifMessage {
+                            text: record.description,
+                        },
+                        locations: [SarifLocation {
+                            physical_location: SarifPhysicalLocation {
+                                artifact_location: SarifArtifact { uri: record.path },
+                                region: SarifRegion {
+                                    start_line: start.line + 1,
+                                    start_column: start.column + 1,
+                                    end_line: end.line + 1,
+                                    end_column: end.column + 1,
+                                },
+                            },
+                        }],
+                    },
+                )?;
+            }
+        }
+        self.written += 1;
+        Ok(())
+    }
+}
+
+impl DiagnosticWriter<Vec<u8>> {
+    /// A writer that has already written `out`, which holds `written`
+    /// diagnostics.
+    pub fn from_parts(out: Vec<u8>, written: usize, format: Format) -> Self {
+        DiagnosticWriter {
+            out,
+            format,
+            written,
+        }
+    }
+
+    /// The output that was written and the number of diagnostics in it.
+    pub fn into_parts(self) -> (Vec<u8>, usize) {
+        (self.out, self.written)
+    }
+
+    /// Add the output of another writer, which was written on its own (for
+    /// example on another thread) with the same format and without `begin`.
+    pub fn append<W: Write>(self, to: &mut DiagnosticWriter<W>) -> io::Result<()> {
+        // Each part starts its own list of results in SARIF
+        if to.format == Format::Sarif && to.written > 0 && self.written > 0 {
+            to.out.write_all(b",")?;
+        }
+        to.out.write_all(&self.out)?;
+        to.written += self.written;
+        Ok(())
+    }
+}
+
+#[cfg(test)]
+mod test {
+    use super::{DiagnosticWriter, Format};
+    use crate::cfg::Cfg;
+    use crate::helpers::analyse;
+    use crate::passes::{LintError, Manager};
+
+    const PROGRAM: &str = "main:
+        li zero, 1
+        li a7, 10
+        ecall
+    ";
+
+    fn lints(cfg: &Cfg) -> Vec<LintError> {
+        Manager::lint(cfg)
+    }
+
+    fn write(format: Format, parts: usize) -> String {
+        let cfg = analyse(PROGRAM);
+        let mut out = DiagnosticWriter::new(Vec::new(), format);
+        out.begin().unwrap();
+        for _ in 0..parts {
+            let mut part = DiagnosticWriter::new(Vec::new(), format);
+            for err in lints(&cfg) {
+                part.lint_error("main.s", &err).unwrap();
+            }
+            part.append(&mut out).unwrap();
+        }
+        String::from_utf8(out.finish().unwrap()).unwrap()
+    }
+
+    #[test]
+    fn compact_lines_start_at_one() {
+        let out = write(Format::Compact, 1);
+        assert!(out.contains("main.s:2:11: warning[save-to-zero]: Saving to zero register\n"));
+    }
+
+    #[test]
+    fn json_lines_are_objects() {
+        let out = write(Format::Jsonl, 1);
+        for line in out.lines() {
+            let value = serde_json::from_str::<serde_json::Value>(line).unwrap();
+            assert_eq!(value["file"], "main.s");
+        }
+        assert!(out.contains("\"code\":\"save-to-zero\""));
+    }
+
+    #[test]
+    fn sarif_parts_are_one_log() {
+        for parts in [0, 1, 3] {
+            let out = write(Format::Sarif, parts);
+            let value = serde_json::from_str::<serde_json::Value>(&out).unwrap();
+            let results = value["runs"][0]["results"].as_array().unwrap();
+            assert_eq!(results.len(), parts * lints(&analyse(PROGRAM)).len());
+        }
+    }
+}
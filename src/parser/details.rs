@@ -1,6 +1,6 @@
 use std::fmt::Display;
 
-use uuid::Uuid;
+use super::{FileId, NodeKey};
 
 use super::{
     ArithType, BasicType, BranchType, CSRIType, CSRImm, CSRType, DirectiveToken, IArithType,
@@ -14,7 +14,7 @@ pub struct Arith {
     pub rd: With<Register>,
     pub rs1: With<Register>,
     pub rs2: With<Register>,
-    pub key: Uuid,
+    pub key: NodeKey,
 }
 
 #[derive(Debug, Clone)]
@@ -23,20 +23,20 @@ pub struct IArith {
     pub rd: With<Register>,
     pub rs1: With<Register>,
     pub imm: With<Imm>,
-    pub key: Uuid,
+    pub key: NodeKey,
 }
 
 #[derive(Debug, Clone)]
 pub struct Label {
     pub name: With<LabelString>,
-    pub key: Uuid,
+    pub key: NodeKey,
 }
 #[derive(Debug, Clone)]
 pub struct JumpLink {
     pub inst: With<JumpLinkType>,
     pub rd: With<Register>,
     pub name: With<LabelString>,
-    pub key: Uuid,
+    pub key: NodeKey,
 }
 
 #[derive(Debug, Clone)]
@@ -45,13 +45,13 @@ pub struct JumpLinkR {
     pub rd: With<Register>,
     pub rs1: With<Register>,
     pub imm: With<Imm>,
-    pub key: Uuid,
+    pub key: NodeKey,
 }
 
 #[derive(Debug, Clone)]
 pub struct Basic {
     pub inst: With<BasicType>,
-    pub key: Uuid,
+    pub key: NodeKey,
 }
 
 #[derive(Debug, Clone)]
@@ -60,7 +60,7 @@ pub struct Branch {
     pub rs1: With<Register>,
     pub rs2: With<Register>,
     pub name: With<LabelString>,
-    pub key: Uuid,
+    pub key: NodeKey,
 }
 
 #[derive(Debug, Clone)]
@@ -69,7 +69,7 @@ pub struct Load {
     pub rd: With<Register>,
     pub rs1: With<Register>,
     pub imm: With<Imm>,
-    pub key: Uuid,
+    pub key: NodeKey,
 }
 
 #[derive(Debug, Clone)]
@@ -78,7 +78,7 @@ pub struct Store {
     pub rs1: With<Register>,
     pub rs2: With<Register>,
     pub imm: With<Imm>,
-    pub key: Uuid,
+    pub key: NodeKey,
 }
 
 #[derive(Debug, Clone, PartialEq, Eq)]
@@ -98,7 +98,7 @@ impl Display for DirectiveType {
 pub struct Directive {
     pub token: With<DirectiveToken>,
     pub dir: DirectiveType,
-    pub key: Uuid,
+    pub key: NodeKey,
 }
 
 #[derive(Debug, Clone)]
@@ -107,7 +107,7 @@ pub struct Csr {
     pub rd: With<Register>,
     pub csr: With<CSRImm>,
     pub rs1: With<Register>,
-    pub key: Uuid,
+    pub key: NodeKey,
 }
 
 #[derive(Debug, Clone)]
@@ -116,13 +116,13 @@ pub struct CsrI {
     pub rd: With<Register>,
     pub csr: With<CSRImm>,
     pub imm: With<Imm>,
-    pub key: Uuid,
+    pub key: NodeKey,
 }
 
 #[derive(Debug, Clone)]
 pub struct Ignore {
     pub inst: With<IgnoreType>,
-    pub key: Uuid,
+    pub key: NodeKey,
 }
 
 #[derive(Debug, Clone)]
@@ -130,7 +130,7 @@ pub struct LoadAddr {
     pub inst: With<PseudoType>,
     pub rd: With<Register>,
     pub name: With<LabelString>,
-    pub key: Uuid,
+    pub key: NodeKey,
 }
 
 #[derive(Debug, Clone)]
@@ -138,17 +138,17 @@ pub struct UpperArith {
     pub inst: With<UpperArithType>,
     pub rd: With<Register>,
     pub imm: With<Imm>,
-    pub key: Uuid,
+    pub key: NodeKey,
 }
 
 #[derive(Debug, Clone)]
 pub struct FuncEntry {
-    pub file: Uuid,
-    pub key: Uuid,
+    pub file: FileId,
+    pub key: NodeKey,
 }
 
 #[derive(Debug, Clone)]
 pub struct ProgramEntry {
-    pub file: Uuid,
-    pub key: Uuid,
+    pub file: FileId,
+    pub key: NodeKey,
 }
@@ -3,6 +3,8 @@ use std::{
     str::FromStr,
 };
 
+use crate::parser::keyword::{lowercase_keyword, MAX_KEYWORD_LEN};
+
 #[derive(Debug, PartialEq, Clone)]
 pub enum DirectiveToken {
     Align,
@@ -61,7 +63,8 @@ impl FromStr for DirectiveToken {
 
     fn from_str(s: &str) -> Result<Self, Self::Err> {
         // ensure first char is a "."
-        match s.to_lowercase().as_str() {
+        let mut buf = [0; MAX_KEYWORD_LEN];
+        match lowercase_keyword(s, &mut buf) {
             "align" => Ok(DirectiveToken::Align),
             "ascii" => Ok(DirectiveToken::Ascii),
             "asciz" => Ok(DirectiveToken::Asciz),
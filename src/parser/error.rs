@@ -1,10 +1,8 @@
 use std::fmt::Display;
 
-use uuid::Uuid;
-
 use crate::passes::WarningLevel;
 
-use super::{Info, LineDisplay, ParserNode, With};
+use super::{FileId, Info, LineDisplay, ParserNode, With};
 
 #[derive(Debug, Clone)]
 /// Lexer error
@@ -63,8 +61,24 @@ impl Display for ParseError {
     }
 }
 
+impl ParseError {
+    /// A stable identifier for the kind of error, for tools that read the
+    /// diagnostics.
+    pub fn code(&self) -> &'static str {
+        match self {
+            ParseError::Expected(..) => "expected",
+            ParseError::Unsupported(_) => "unsupported",
+            ParseError::UnexpectedToken(_) => "unexpected-token",
+            ParseError::UnexpectedError(_) => "unexpected-error",
+            ParseError::UnknownDirective(_) => "unknown-directive",
+            ParseError::CyclicDependency(_) => "cyclic-dependency",
+            ParseError::FileNotFound(_) => "file-not-found",
+        }
+    }
+}
+
 impl LineDisplay for ParseError {
-    fn file(&self) -> Uuid {
+    fn file(&self) -> FileId {
         match self {
             ParseError::Expected(_, info)
             | ParseError::Unsupported(info)
@@ -72,7 +86,7 @@ impl LineDisplay for ParseError {
             | ParseError::UnexpectedError(info)
             | ParseError::UnknownDirective(info)
             | ParseError::CyclicDependency(info) => info.file,
-            ParseError::FileNotFound(file) => file.file,
+            ParseError::FileNotFound(file) => file.span.file,
         }
     }
 
@@ -84,7 +98,7 @@ impl LineDisplay for ParseError {
             | ParseError::UnexpectedError(info)
             | ParseError::UnknownDirective(info)
             | ParseError::CyclicDependency(info) => info.pos.clone(),
-            ParseError::FileNotFound(file) => file.pos.clone(),
+            ParseError::FileNotFound(file) => file.span.range(),
         }
     }
 }
@@ -0,0 +1,47 @@
+use std::fmt::Display;
+
+/// The file that a token came from, numbered by the reader that read it.
+///
+/// Ids are small and dense, so that they are cheap to keep in every token
+/// and can index a table of files. They are only unique among the files of
+/// one program, or of every program that shares a `ParseCache`.
+#[derive(Clone, Copy, Debug, Default, PartialEq, Eq, Hash, PartialOrd, Ord)]
+pub struct FileId(u16);
+
+impl FileId {
+    /// The id of the `index`th file, if there are few enough files.
+    pub fn new(index: usize) -> Option<Self> {
+        u16::try_from(index).ok().map(FileId)
+    }
+
+    #[inline(always)]
+    pub fn index(self) -> usize {
+        self.0 as usize
+    }
+}
+
+impl Display for FileId {
+    fn fmt(&self, f: &mut std::fmt::Formatter<'_>) -> std::fmt::Result {
+        self.0.fmt(f)
+    }
+}
+
+/// The key of a parsed node, which its equality and hash go through.
+///
+/// The parser numbers nodes in the order that it adds them to the
+/// program, and the graph numbers them again by their place in it, so that
+/// the nodes it adds have keys of their own. Nodes that are made anywhere
+/// else all have the same key until they are numbered.
+#[derive(Clone, Copy, Debug, Default, PartialEq, Eq, Hash, PartialOrd, Ord)]
+pub struct NodeKey(u32);
+
+impl NodeKey {
+    pub fn new(index: usize) -> Self {
+        NodeKey(u32::try_from(index).expect("too many nodes in program"))
+    }
+
+    #[inline(always)]
+    pub fn index(self) -> usize {
+        self.0 as usize
+    }
+}
@@ -1,5 +1,6 @@
 use std::str::FromStr;
 
+use crate::parser::keyword::{lowercase_keyword, MAX_KEYWORD_LEN};
 use crate::parser::token::{Info, Token};
 
 #[derive(Debug, PartialEq, Clone)]
@@ -34,8 +35,8 @@ impl FromStr for CSRImm {
     type Err = ();
 
     fn from_str(s: &str) -> Result<Self, Self::Err> {
-        let string = s.to_lowercase();
-        let num = match string.as_str() {
+        let mut buf = [0; MAX_KEYWORD_LEN];
+        let num = match lowercase_keyword(s, &mut buf) {
             "ustatus" => 0x000,
             "fflags" => 0x001,
             "frm" => 0x002,
@@ -64,8 +65,6 @@ impl FromStr for Imm {
     type Err = ();
 
     fn from_str(s: &str) -> Result<Self, Self::Err> {
-        let s = s.to_lowercase();
-        let s = s.as_str();
         let s = s.trim();
         let (s, mul) = if let Some(stripped) = s.strip_prefix('-') {
             (stripped, -1)
@@ -73,9 +72,9 @@ impl FromStr for Imm {
             (s, 1)
         };
 
-        if s == "zero" {
+        if s.eq_ignore_ascii_case("zero") {
             Ok(Imm(0))
-        } else if let Some(stripped) = s.strip_prefix("0x") {
+        } else if let Some(stripped) = s.strip_prefix("0x").or_else(|| s.strip_prefix("0X")) {
             if stripped.starts_with('-') {
                 Err(())
             } else {
@@ -85,7 +84,7 @@ impl FromStr for Imm {
                     Err(_) => Err(()),
                 }
             }
-        } else if let Some(stripped) = s.strip_prefix("0b") {
+        } else if let Some(stripped) = s.strip_prefix("0b").or_else(|| s.strip_prefix("0B")) {
             if stripped.starts_with('-') {
                 Err(())
             } else {
@@ -178,6 +177,7 @@ mod test {
         assert_eq!(Imm::from_str("0x00000100"), Ok(Imm(256)));
         assert_eq!(Imm::from_str("0x0000000A"), Ok(Imm(10)));
         assert_eq!(Imm::from_str("-0x0000000A"), Ok(Imm(-10)));
+        assert_eq!(Imm::from_str("0X1f"), Ok(Imm(31)));
     }
 
     #[test]
@@ -191,6 +191,7 @@ mod test {
         assert_eq!(Imm::from_str("-0b00000000"), Ok(Imm(0)));
         assert_eq!(Imm::from_str("-0b00000001"), Ok(Imm(-1)));
         assert_eq!(Imm::from_str("-0b00000010"), Ok(Imm(-2)));
+        assert_eq!(Imm::from_str("0B101"), Ok(Imm(5)));
     }
 
     #[test]
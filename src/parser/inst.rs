@@ -1,5 +1,7 @@
 use std::{fmt::Display, str::FromStr};
 
+use crate::parser::keyword::{lowercase_keyword, MAX_KEYWORD_LEN};
+
 #[derive(Debug, Clone, PartialEq, Copy)]
 pub enum BasicType {
     Ebreak,
@@ -388,7 +390,8 @@ impl FromStr for Inst {
 
     #[allow(clippy::too_many_lines)]
     fn from_str(s: &str) -> Result<Self, Self::Err> {
-        match s.to_lowercase().as_str() {
+        let mut buf = [0; MAX_KEYWORD_LEN];
+        match lowercase_keyword(s, &mut buf) {
             "ret" => Ok(Inst::Ret),
             "ebreak" => Ok(Inst::Ebreak),
             "ecall" => Ok(Inst::Ecall),
@@ -0,0 +1,41 @@
+/// The longest keyword (instruction, register, directive or CSR name) that
+/// is looked up with [`lowercase_keyword`].
+pub const MAX_KEYWORD_LEN: usize = 16;
+
+/// Lowercase a possible keyword into a buffer on the stack.
+///
+/// Keywords are matched case-insensitively, and this lets the match run on
+/// the lowercase text without allocating a new string for every token. Only
+/// ASCII letters are changed, as every keyword is ASCII. Text that is longer
+/// than any keyword becomes the empty string, which matches no keyword.
+#[inline(always)]
+pub fn lowercase_keyword<'a>(s: &str, buf: &'a mut [u8; MAX_KEYWORD_LEN]) -> &'a str {
+    let Some(buf) = buf.get_mut(..s.len()) else {
+        return "";
+    };
+    buf.copy_from_slice(s.as_bytes());
+    buf.make_ascii_lowercase();
+    std::str::from_utf8(buf).unwrap_or_default()
+}
+
+#[cfg(test)]
+mod test {
+    use std::str::FromStr;
+
+    use super::{lowercase_keyword, MAX_KEYWORD_LEN};
+    use crate::parser::{Inst, Register};
+
+    #[test]
+    fn keywords_ignore_case() {
+        let mut buf = [0; MAX_KEYWORD_LEN];
+        assert_eq!(lowercase_keyword("AddI", &mut buf), "addi");
+        assert_eq!(lowercase_keyword("a_very_long_label_name", &mut buf), "");
+
+        assert_eq!(Inst::from_str("MULHSU"), Ok(Inst::Mulhsu));
+        assert_eq!(Register::from_str("Sp"), Ok(Register::X2));
+        assert_eq!(
+            Register::from_str("zero_but_longer_than_a_keyword"),
+            Err(())
+        );
+    }
+}
@@ -1,52 +1,136 @@
-use uuid::Uuid;
+use std::cell::Cell;
+use std::rc::Rc;
+use std::time::Duration;
 
 use crate::parser::token::Token;
 use crate::parser::token::{Info, Position, Range};
-
-const EOF_CONST: char = 3 as char;
+use crate::parser::FileId;
+use crate::passes::Stopwatch;
+
+const EOF_CONST: u8 = 3;
+
+/// Whitespace: space, tab and comma (newlines are tokens)
+const WS: u8 = 1;
+/// Characters that can start a symbol: letters, underscore and dash
+const SYMBOL: u8 = 2;
+/// Characters that can only continue a symbol: digits
+const DIGIT: u8 = 4;
+
+/// The class of every byte, so that each check in the scanning loops is a
+/// single table lookup.
+static CLASSES: [u8; 256] = classes();
+
+const fn classes() -> [u8; 256] {
+    let mut table = [0; 256];
+    let mut i = 0;
+    while i < table.len() {
+        #[allow(clippy::cast_possible_truncation)]
+        let c = i as u8;
+        table[i] = if c == b' ' || c == b'\t' || c == b',' {
+            WS
+        } else if c.is_ascii_alphabetic() || c == b'_' || c == b'-' {
+            SYMBOL
+        } else if c.is_ascii_digit() {
+            DIGIT
+        } else {
+            0
+        };
+        i += 1;
+    }
+    table
+}
 
 /// Lexer for RISC-V assembly
 ///
 /// The lexer implements the Iterator trait, so it can be used in a for loop for
 /// getting the next token.
+///
+/// The source is scanned one byte at a time. The text of a token is copied
+/// out of the source in one go once its end is found.
 pub struct Lexer {
     source: String,
-    pub source_id: Uuid,
-    ch: char,
+    pub source_id: FileId,
+    ch: u8,
     pos: usize,
     row: usize,
     col: usize,
+    /// Tokens that were lexed ahead of time, which are returned instead of
+    /// scanning the source.
+    tokens: Option<std::vec::IntoIter<Info>>,
+    /// Where to add the time spent finding each token, if it is measured
+    timer: Option<Rc<Cell<Duration>>>,
 }
 
 impl Lexer {
     /// Create a new lexer from a string.
-    pub fn new<S: Into<String>>(source: S, id: Uuid) -> Lexer {
+    pub fn new<S: Into<String>>(source: S, id: FileId) -> Lexer {
         let mut lex = Lexer {
             source: source.into(),
             source_id: id,
-            ch: '\0',
+            ch: 0,
             pos: 0,
             row: 0,
             col: 0,
+            tokens: None,
+            timer: None,
         };
         lex.next_char();
         lex
     }
 
+    /// Create a lexer that returns tokens that were already lexed.
+    ///
+    /// This is used to replay tokens that were cached between runs, so that
+    /// only the parts of a file that changed need to be lexed again.
+    pub fn from_tokens(tokens: Vec<Info>, id: FileId) -> Lexer {
+        Lexer {
+            source: String::new(),
+            source_id: id,
+            ch: EOF_CONST,
+            pos: 0,
+            row: 0,
+            col: 0,
+            tokens: Some(tokens.into_iter()),
+            timer: None,
+        }
+    }
+
+    /// Add the time spent finding each token to `timer`.
+    ///
+    /// This measures the lexer while it is being used by the parser, so
+    /// the time includes the clock being read around every token.
+    #[must_use]
+    pub fn timed(self, timer: Rc<Cell<Duration>>) -> Lexer {
+        Lexer {
+            timer: Some(timer),
+            ..self
+        }
+    }
+
+    /// Whether the whole source has been read.
+    ///
+    /// The lexer stops early if it finds a character it does not know, so
+    /// this is false if the lexer ended before the end of the source.
+    pub fn is_done(&self) -> bool {
+        self.tokens
+            .as_ref()
+            .map_or(self.pos > self.source.len(), |x| x.as_slice().is_empty())
+    }
+
     /// Get the next character in the source.
     ///
     /// This function will update the current character and the position
     /// of the Lexer struct.
+    #[inline(always)]
     fn next_char(&mut self) {
-        let b = self.source.as_bytes();
-
-        if self.pos >= self.source.len() {
-            self.ch = EOF_CONST;
-        } else {
-            self.ch = b[self.pos] as char;
-        }
-
-        if self.ch == '\n' {
+        self.ch = self
+            .source
+            .as_bytes()
+            .get(self.pos)
+            .copied()
+            .unwrap_or(EOF_CONST);
+
+        if self.ch == b'\n' {
             self.row += 1;
             self.col = 0;
         } else {
@@ -61,24 +145,30 @@ impl Lexer {
     /// This function will return true if the current character is a space,
     /// tab, or comma. Newlines are not considered whitespace as it is a
     /// token in the lexer.
+    #[inline(always)]
     fn is_ws(&self) -> bool {
-        self.ch == ' ' || self.ch == '\t' || self.ch == ','
-    }
-
-    /// Check if the current character is a character usable in a symbol.
-    ///
-    /// This function will return true if the current character is a lowercase
-    /// or uppercase letter, an underscore, or a dash.
-    fn is_symbol_char(&self) -> bool {
-        let c = self.ch;
-        c.is_ascii_lowercase() || c.is_ascii_uppercase() || c == '_' || c == '-'
+        CLASSES[self.ch as usize] & WS != 0
     }
 
     /// Check if the current character is a character usable in a symbol
     /// or a digit.
+    #[inline(always)]
     fn is_symbol_item(&self) -> bool {
-        let c = self.ch;
-        self.is_symbol_char() || c.is_ascii_digit()
+        CLASSES[self.ch as usize] & (SYMBOL | DIGIT) != 0
+    }
+
+    /// Advance while `f` is true for the current character, returning the
+    /// text that was skipped over.
+    ///
+    /// The text starts at the current character and ends before the first
+    /// character where `f` is false.
+    fn take_while(&mut self, f: impl Fn(&Lexer) -> bool) -> String {
+        let start = self.pos - 1;
+        while f(self) {
+            self.next_char();
+        }
+        let end = (self.pos - 1).min(self.source.len());
+        self.source.get(start..end).unwrap_or_default().to_owned()
     }
 
     /// Skip whitespace.
@@ -116,10 +206,29 @@ impl Iterator for Lexer {
     type Item = Info;
 
     fn next(&mut self) -> Option<Self::Item> {
+        if self.timer.is_none() {
+            return self.lex();
+        }
+        let start = Stopwatch::start();
+        let token = self.lex();
+        if let Some(timer) = &self.timer {
+            timer.set(timer.get() + start.elapsed());
+        }
+        token
+    }
+}
+
+impl Lexer {
+    /// Find the next token.
+    fn lex(&mut self) -> Option<Info> {
+        if let Some(tokens) = &mut self.tokens {
+            return tokens.next();
+        }
+
         self.skip_ws();
 
         match self.ch {
-            '\n' => {
+            b'\n' => {
                 let pos = self.get_range();
                 self.next_char();
 
@@ -129,7 +238,7 @@ impl Iterator for Lexer {
                     pos,
                 })
             }
-            '(' => {
+            b'(' => {
                 let pos = self.get_range();
                 self.next_char();
 
@@ -139,7 +248,7 @@ impl Iterator for Lexer {
                     pos,
                 })
             }
-            ')' => {
+            b')' => {
                 let pos = self.get_range();
                 self.next_char();
 
@@ -149,18 +258,13 @@ impl Iterator for Lexer {
                     pos,
                 })
             }
-            '.' => {
+            b'.' => {
                 // directive
 
                 let start = self.get_pos();
                 self.next_char();
 
-                let mut dir_str: String = String::new();
-
-                while self.is_symbol_item() {
-                    dir_str += &self.ch.to_string();
-                    self.next_char();
-                }
+                let dir_str = self.take_while(Lexer::is_symbol_item);
 
                 let end = self.get_pos();
 
@@ -169,14 +273,14 @@ impl Iterator for Lexer {
                 }
 
                 Some(Info {
-                    token: Token::Directive(dir_str.clone()),
+                    token: Token::Directive(dir_str),
                     pos: Range { start, end },
                     file: self.source_id,
                 })
             }
-            '#' => {
+            b'#' => {
                 // skip line till newline
-                while self.ch != '\n' && self.ch != EOF_CONST {
+                while self.ch != b'\n' && self.ch != EOF_CONST {
                     self.next_char();
                 }
 
@@ -192,17 +296,13 @@ impl Iterator for Lexer {
                 })
             }
 
-            '"' => {
+            b'"' => {
                 // string
                 let start = self.get_pos();
-                let mut string_str: String = String::new();
 
                 self.next_char();
 
-                while self.ch != '"' {
-                    string_str += &self.ch.to_string();
-                    self.next_char();
-                }
+                let string_str = self.take_while(|x| x.ch != b'"' && x.ch != EOF_CONST);
 
                 self.next_char();
 
@@ -211,7 +311,7 @@ impl Iterator for Lexer {
                 self.next_char();
 
                 Some(Info {
-                    token: Token::String(string_str.clone()),
+                    token: Token::String(string_str),
                     pos: Range { start, end },
                     file: self.source_id,
                 })
@@ -221,23 +321,18 @@ impl Iterator for Lexer {
 
                 let start = self.get_pos();
 
-                let mut symbol_str: String = String::new();
-
-                while self.is_symbol_item() {
-                    symbol_str += &self.ch.to_string();
-                    self.next_char();
-                }
+                let symbol_str = self.take_while(Lexer::is_symbol_item);
 
                 if symbol_str.is_empty() {
                     // this is an error or end of line?
                     return None;
-                } else if self.ch == ':' {
+                } else if self.ch == b':' {
                     // this is a label
                     self.next_char();
                     let end = self.get_pos();
 
                     return Some(Info {
-                        token: Token::Label(symbol_str.clone()),
+                        token: Token::Label(symbol_str),
                         pos: Range { start, end },
                         file: self.source_id,
                     });
@@ -246,7 +341,7 @@ impl Iterator for Lexer {
                 let end = self.get_pos();
 
                 Some(Info {
-                    token: Token::Symbol(symbol_str.clone()),
+                    token: Token::Symbol(symbol_str),
                     pos: Range { start, end },
                     file: self.source_id,
                 })
@@ -10,12 +10,18 @@ pub use inst::*;
 mod lexer;
 pub use lexer::*;
 
+mod keyword;
+pub use keyword::*;
+
 mod parsing;
 pub use parsing::*;
 
 mod register;
 pub use register::*;
 
+mod id;
+pub use id::*;
+
 mod token;
 pub use token::*;
 
@@ -12,13 +12,35 @@ use std::collections::HashSet;
 
 use std::hash::{Hash, Hasher};
 
-use uuid::Uuid;
-
 use super::{
-    Arith, Basic, Branch, Csr, CsrI, Directive, DirectiveToken, DirectiveType, FuncEntry, IArith,
-    JumpLink, JumpLinkR, Label, LabelString, Load, LoadAddr, ProgramEntry, Store, UpperArith,
+    Arith, Basic, Branch, Csr, CsrI, Directive, DirectiveToken, DirectiveType, FileId, FuncEntry,
+    IArith, JumpLink, JumpLinkR, Label, LabelString, Load, LoadAddr, NodeKey, ProgramEntry, RegSet,
+    Store, UpperArith,
 };
 
+/// The register operands of a node. Slots that the kind of node does not
+/// have are `None`.
+#[derive(Clone, Copy, Debug, Default)]
+pub struct Operands<'a> {
+    /// The register that is written
+    pub rd: Option<&'a With<Register>>,
+    /// The registers that are read
+    pub rs: [Option<&'a With<Register>>; 2],
+}
+
+impl Operands<'_> {
+    pub fn writes(&self) -> RegSet {
+        self.rd.map_or(RegSet::EMPTY, |x| RegSet::single(x.data))
+    }
+
+    pub fn reads(&self) -> RegSet {
+        self.rs
+            .iter()
+            .flatten()
+            .fold(RegSet::EMPTY, |acc, x| acc | RegSet::single(x.data))
+    }
+}
+
 #[derive(Debug, Clone)]
 pub enum ParserNode {
     ProgramEntry(ProgramEntry),
@@ -40,7 +62,7 @@ pub enum ParserNode {
 }
 
 impl ParserNode {
-    pub fn id(&self) -> Uuid {
+    pub fn id(&self) -> NodeKey {
         match self {
             ParserNode::Arith(a) => a.key,
             ParserNode::IArith(a) => a.key,
@@ -107,7 +129,7 @@ impl ParserNode {
             rd,
             rs1,
             rs2,
-            key: Uuid::new_v4(),
+            key: NodeKey::default(),
         })
     }
 
@@ -122,7 +144,7 @@ impl ParserNode {
             rd,
             rs1,
             imm,
-            key: Uuid::new_v4(),
+            key: NodeKey::default(),
         })
     }
 
@@ -135,7 +157,7 @@ impl ParserNode {
             inst,
             rd,
             imm,
-            key: Uuid::new_v4(),
+            key: NodeKey::default(),
         })
     }
 
@@ -148,7 +170,7 @@ impl ParserNode {
             inst,
             rd,
             name,
-            key: Uuid::new_v4(),
+            key: NodeKey::default(),
         })
     }
 
@@ -163,14 +185,14 @@ impl ParserNode {
             rd,
             rs1,
             imm,
-            key: Uuid::new_v4(),
+            key: NodeKey::default(),
         })
     }
 
     pub fn new_basic(inst: With<BasicType>) -> ParserNode {
         ParserNode::Basic(Basic {
             inst,
-            key: Uuid::new_v4(),
+            key: NodeKey::default(),
         })
     }
 
@@ -178,7 +200,7 @@ impl ParserNode {
         ParserNode::Directive(Directive {
             token,
             dir,
-            key: Uuid::new_v4(),
+            key: NodeKey::default(),
         })
     }
 
@@ -193,7 +215,7 @@ impl ParserNode {
             rs1,
             rs2,
             name,
-            key: Uuid::new_v4(),
+            key: NodeKey::default(),
         })
     }
 
@@ -208,7 +230,7 @@ impl ParserNode {
             rs1,
             rs2,
             imm,
-            key: Uuid::new_v4(),
+            key: NodeKey::default(),
         })
     }
 
@@ -223,7 +245,7 @@ impl ParserNode {
             rd,
             rs1,
             imm,
-            key: Uuid::new_v4(),
+            key: NodeKey::default(),
         })
     }
 
@@ -238,20 +260,20 @@ impl ParserNode {
             rd,
             rs1,
             csr,
-            key: Uuid::new_v4(),
+            key: NodeKey::default(),
         })
     }
 
-    pub fn new_func_entry(file: Uuid) -> ParserNode {
+    pub fn new_func_entry(file: FileId) -> ParserNode {
         ParserNode::FuncEntry(FuncEntry {
-            key: Uuid::new_v4(),
+            key: NodeKey::default(),
             file,
         })
     }
 
-    pub fn new_program_entry(file: Uuid) -> ParserNode {
+    pub fn new_program_entry(file: FileId) -> ParserNode {
         ParserNode::ProgramEntry(ProgramEntry {
-            key: Uuid::new_v4(),
+            key: NodeKey::default(),
             file,
         })
     }
@@ -267,14 +289,14 @@ impl ParserNode {
             rd,
             imm,
             csr,
-            key: Uuid::new_v4(),
+            key: NodeKey::default(),
         })
     }
 
     pub fn new_label(name: With<LabelString>) -> ParserNode {
         ParserNode::Label(Label {
             name,
-            key: Uuid::new_v4(),
+            key: NodeKey::default(),
         })
     }
 
@@ -287,7 +309,7 @@ impl ParserNode {
             inst,
             rd,
             name,
-            key: Uuid::new_v4(),
+            key: NodeKey::default(),
         })
     }
 
@@ -341,67 +363,63 @@ impl ParserNode {
         matches!(self, ParserNode::ProgramEntry(_))
     }
 
-    // NOTE: This is in context to a register store, not a memory store
-    pub fn stores_to(&self) -> Option<With<Register>> {
-        match self {
-            ParserNode::Load(load) => Some(load.rd.clone()),
-            ParserNode::LoadAddr(load) => Some(load.rd.clone()),
-            ParserNode::Arith(arith) => Some(arith.rd.clone()),
-            ParserNode::IArith(iarith) => Some(iarith.rd.clone()),
-            ParserNode::UpperArith(upper_arith) => Some(upper_arith.rd.clone()),
-            ParserNode::JumpLink(jump_link) => Some(jump_link.rd.clone()),
-            ParserNode::JumpLinkR(jump_link_r) => Some(jump_link_r.rd.clone()),
-            ParserNode::Csr(csr) => Some(csr.rd.clone()),
-            ParserNode::CsrI(csri) => Some(csri.rd.clone()),
+    /// The register operands of the node, by their role.
+    ///
+    /// Every kind of node keeps its registers in the same slots, so the
+    /// slot says what is done with a register: `rd` is written and `rs` are
+    /// read. Every register set of the analyses is built from this one
+    /// match, so a new kind of node only has to give its slots here.
+    #[inline]
+    pub fn operands(&self) -> Operands<'_> {
+        let (rd, rs1, rs2) = match self {
+            ParserNode::Arith(x) => (Some(&x.rd), Some(&x.rs1), Some(&x.rs2)),
+            ParserNode::IArith(x) => (Some(&x.rd), Some(&x.rs1), None),
+            ParserNode::UpperArith(x) => (Some(&x.rd), None, None),
+            ParserNode::JumpLink(x) => (Some(&x.rd), None, None),
+            ParserNode::JumpLinkR(x) => (Some(&x.rd), Some(&x.rs1), None),
+            ParserNode::Branch(x) => (None, Some(&x.rs1), Some(&x.rs2)),
+            ParserNode::Store(x) => (None, Some(&x.rs1), Some(&x.rs2)),
+            ParserNode::Load(x) => (Some(&x.rd), Some(&x.rs1), None),
+            ParserNode::LoadAddr(x) => (Some(&x.rd), None, None),
+            ParserNode::Csr(x) => (Some(&x.rd), Some(&x.rs1), None),
+            ParserNode::CsrI(x) => (Some(&x.rd), None, None),
             ParserNode::ProgramEntry(_)
             | ParserNode::FuncEntry(_)
             | ParserNode::Label(_)
             | ParserNode::Basic(_)
-            | ParserNode::Directive(_)
-            | ParserNode::Branch(_)
-            | ParserNode::Store(_) => None,
-        }
+            | ParserNode::Directive(_) => (None, None, None),
+        };
+        Operands { rd, rs: [rs1, rs2] }
+    }
+
+    // NOTE: This is in context to a register store, not a memory store
+    pub fn stores_to(&self) -> Option<With<Register>> {
+        self.operands().rd.copied()
     }
 
     pub fn reads_from(&self) -> HashSet<With<Register>> {
-        let vector = match self {
-            ParserNode::Arith(x) => vec![x.rs1.clone(), x.rs2.clone()],
-            ParserNode::IArith(x) => vec![x.rs1.clone()],
-            ParserNode::JumpLinkR(x) => vec![x.rs1.clone()],
-            ParserNode::Branch(x) => vec![x.rs1.clone(), x.rs2.clone()],
-            ParserNode::Store(x) => vec![x.rs1.clone(), x.rs2.clone()],
-            ParserNode::Load(x) => vec![x.rs1.clone()],
-            ParserNode::Csr(x) => vec![x.rs1.clone()],
-            ParserNode::ProgramEntry(_)
-            | ParserNode::FuncEntry(_)
-            | ParserNode::UpperArith(_)
-            | ParserNode::Label(_)
-            | ParserNode::JumpLink(_)
-            | ParserNode::Basic(_)
-            | ParserNode::Directive(_)
-            | ParserNode::LoadAddr(_)
-            | ParserNode::CsrI(_) => vec![],
-        };
-        vector.into_iter().collect()
+        self.operands().rs.into_iter().flatten().copied().collect()
     }
 
-    pub fn set_uuid(&mut self, uuid: Uuid) {
+    /// Number the node, which is what it is compared and hashed by.
+    pub fn set_key(&mut self, key: NodeKey) {
         match self {
-            ParserNode::Arith(x) => x.key = uuid,
-            ParserNode::IArith(x) => x.key = uuid,
-            ParserNode::UpperArith(x) => x.key = uuid,
-            ParserNode::Label(x) => x.key = uuid,
-            ParserNode::JumpLink(x) => x.key = uuid,
-            ParserNode::JumpLinkR(x) => x.key = uuid,
-            ParserNode::Basic(x) => x.key = uuid,
-            ParserNode::Directive(x) => x.key = uuid,
-            ParserNode::Branch(x) => x.key = uuid,
-            ParserNode::Store(x) => x.key = uuid,
-            ParserNode::Load(x) => x.key = uuid,
-            ParserNode::Csr(x) => x.key = uuid,
-            ParserNode::CsrI(x) => x.key = uuid,
-            ParserNode::LoadAddr(x) => x.key = uuid,
-            ParserNode::ProgramEntry(_) | ParserNode::FuncEntry(_) => (),
+            ParserNode::Arith(x) => x.key = key,
+            ParserNode::IArith(x) => x.key = key,
+            ParserNode::UpperArith(x) => x.key = key,
+            ParserNode::Label(x) => x.key = key,
+            ParserNode::JumpLink(x) => x.key = key,
+            ParserNode::JumpLinkR(x) => x.key = key,
+            ParserNode::Basic(x) => x.key = key,
+            ParserNode::Directive(x) => x.key = key,
+            ParserNode::Branch(x) => x.key = key,
+            ParserNode::Store(x) => x.key = key,
+            ParserNode::Load(x) => x.key = key,
+            ParserNode::Csr(x) => x.key = key,
+            ParserNode::CsrI(x) => x.key = key,
+            ParserNode::LoadAddr(x) => x.key = key,
+            ParserNode::FuncEntry(x) => x.key = key,
+            ParserNode::ProgramEntry(x) => x.key = key,
         }
     }
 }
@@ -4,50 +4,29 @@ use crate::parser::inst::{
 };
 use crate::parser::token::With;
 use crate::parser::Register;
+use crate::parser::{Directive, DirectiveType, ParserNode};
 use crate::parser::{DirectiveToken, LexError};
-use crate::parser::{DirectiveType, ParserNode};
 use crate::parser::{Lexer, Token};
 use crate::reader::{FileReader, FileReaderError};
 use std::iter::Peekable;
 use std::str::FromStr;
+use std::sync::Arc;
 
 use super::imm::{CSRImm, Imm};
 use super::token::Info;
-use super::{ExpectedType, LabelString, ParseError};
+use super::{ExpectedType, FileId, LabelString, NodeKey, ParseError};
 
 /// Parser for RISC-V assembly
 pub struct RVParser<T>
 where
     T: FileReader,
 {
-    lexer_stack: Vec<Peekable<Lexer>>,
     pub reader: T,
 }
 
 impl<T: FileReader> RVParser<T> {
     pub fn new(reader: T) -> RVParser<T> {
-        RVParser {
-            lexer_stack: Vec::new(),
-            reader,
-        }
-    }
-
-    /// Skip the rest of the line
-    ///
-    /// This is used to recover from parse errors. If there is a parse error,
-    /// we will skip the rest of the line and try to parse the next line.
-    fn recover_from_parse_error(&mut self) {
-        let lexer = self.lexer();
-        match lexer {
-            Some(x) => {
-                for token in x.by_ref() {
-                    if token == Token::Newline {
-                        break;
-                    }
-                }
-            }
-            None => {}
-        }
+        RVParser { reader }
     }
 
     /// Parse files
@@ -62,7 +41,7 @@ impl<T: FileReader> RVParser<T> {
         let mut parse_errors = Vec::new();
 
         // import base lexer
-        let lexer = match self.reader.import_file(&base, None) {
+        let lexer = match self.reader.import_file(base, None) {
             Ok(x) => x,
             Err(_) => {
                 parse_errors.push(ParseError::FileNotFound(With::new(
@@ -72,95 +51,178 @@ impl<T: FileReader> RVParser<T> {
                 return (nodes, parse_errors);
             }
         };
-        self.lexer_stack.push(lexer.1);
 
         // Add program entry node
-        nodes.push(ParserNode::new_program_entry(lexer.0));
+        push_node(&mut nodes, ParserNode::new_program_entry(lexer.0));
 
-        while let Some(lexer) = self.lexer() {
-            let node = ParserNode::try_from(lexer);
+        let file = self.parse_file(lexer.0, lexer.1);
+        self.expand(file, ignore_imports, &mut nodes, &mut parse_errors);
+        (nodes, parse_errors)
+    }
 
-            match node {
-                Ok(x) => {
-                    if !ignore_imports {
-                        if let ParserNode::Directive(directive) = &x {
-                            if let DirectiveType::Include(path) = &directive.dir {
-                                let lexer = self
-                                    .reader
-                                    .import_file(path.data.as_str(), Some(directive.token.file));
-                                match lexer {
-                                    Ok(x) => {
-                                        self.lexer_stack.push(x.1);
-                                    }
-                                    Err(x) => match x {
-                                        FileReaderError::IOError(_) => {
-                                            parse_errors
-                                                .push(ParseError::FileNotFound(path.clone()));
-                                        }
-                                        FileReaderError::InternalFileNotFound => {
-                                            parse_errors
-                                                .push(ParseError::UnexpectedError(path.info()));
-                                        }
-                                        FileReaderError::FileAlreadyRead(_) => {
-                                            parse_errors
-                                                .push(ParseError::CyclicDependency(path.info()));
-                                        }
-                                        FileReaderError::Unexpected => {
-                                            parse_errors
-                                                .push(ParseError::UnexpectedError(path.info()));
-                                        }
-                                        FileReaderError::InvalidPath => {
-                                            parse_errors
-                                                .push(ParseError::FileNotFound(path.clone()));
-                                        }
-                                    },
-                                }
-                                continue;
-                            }
+    /// Parse a single file, or reuse the reader's earlier parse of it.
+    fn parse_file(&mut self, id: FileId, mut lexer: Peekable<Lexer>) -> Arc<ParsedFile> {
+        if let Some(parsed) = self.reader.cached_parse(id) {
+            return parsed;
+        }
+        let parsed = Arc::new(ParsedFile::new(id, &mut lexer));
+        self.reader.store_parse(&parsed);
+        parsed
+    }
+
+    /// Add the nodes and errors of a parsed file, replacing each include
+    /// with the nodes and errors of the file it includes.
+    fn expand(
+        &mut self,
+        file: Arc<ParsedFile>,
+        ignore_imports: bool,
+        nodes: &mut Vec<ParserNode>,
+        parse_errors: &mut Vec<ParseError>,
+    ) {
+        // If the reader did not keep the parse, the nodes can be moved out
+        let items = match Arc::try_unwrap(file) {
+            Ok(file) => file.items,
+            Err(file) => file.items.clone(),
+        };
+
+        for item in items {
+            match item {
+                ParseItem::Node(x) => push_node(nodes, x),
+                ParseItem::Error(x) => parse_errors.push(x),
+                ParseItem::Include(x) if ignore_imports => {
+                    push_node(nodes, ParserNode::Directive(x));
+                }
+                ParseItem::Include(directive) => {
+                    let DirectiveType::Include(path) = &directive.dir;
+                    let lexer = self
+                        .reader
+                        .import_file(path.data.as_str(), Some(directive.token.span.file));
+                    // The path was read from a string token
+                    let info = || Info {
+                        token: Token::String(path.data.clone()),
+                        pos: path.span.range(),
+                        file: path.span.file,
+                    };
+                    match lexer {
+                        Ok(x) => {
+                            let included = self.parse_file(x.0, x.1);
+                            self.expand(included, ignore_imports, nodes, parse_errors);
                         }
+                        Err(x) => parse_errors.push(match x {
+                            FileReaderError::IOError(_) | FileReaderError::InvalidPath => {
+                                ParseError::FileNotFound(path.clone())
+                            }
+                            FileReaderError::InternalFileNotFound | FileReaderError::Unexpected => {
+                                ParseError::UnexpectedError(info())
+                            }
+                            FileReaderError::FileAlreadyRead(_) => {
+                                ParseError::CyclicDependency(info())
+                            }
+                        }),
                     }
-                    nodes.push(x);
                 }
+            }
+        }
+    }
+}
+
+/// Add a node to the program, numbering it by its place in the program.
+///
+/// Nodes are numbered as they are added rather than as they are parsed, so
+/// that a file that was parsed for another program can be used again.
+fn push_node(nodes: &mut Vec<ParserNode>, mut node: ParserNode) {
+    node.set_key(NodeKey::new(nodes.len()));
+    nodes.push(node);
+}
+
+/// One part of a file that was parsed on its own.
+#[derive(Debug, Clone)]
+pub enum ParseItem {
+    Node(ParserNode),
+    Error(ParseError),
+    /// An include, which is replaced by the file it includes when the file
+    /// is used.
+    Include(Directive),
+}
+
+/// A file that was parsed on its own, with its includes left in place.
+///
+/// The parse of a file does not depend on the files it includes or the
+/// files that include it, so it can be kept and reused for as long as the
+/// contents of the file stay the same.
+#[derive(Debug, Clone)]
+pub struct ParsedFile {
+    pub id: FileId,
+    pub items: Vec<ParseItem>,
+}
+
+impl ParsedFile {
+    /// Parse all of the tokens from a lexer.
+    pub fn new(id: FileId, lexer: &mut Peekable<Lexer>) -> ParsedFile {
+        let mut items = Vec::new();
+
+        loop {
+            let node = ParserNode::try_from(&mut *lexer);
+
+            match node {
+                Ok(ParserNode::Directive(x)) if matches!(x.dir, DirectiveType::Include(_)) => {
+                    items.push(ParseItem::Include(x));
+                }
+                Ok(x) => items.push(ParseItem::Node(x)),
                 Err(x) => match x {
                     LexError::Expected(ex, got) => {
-                        parse_errors.push(ParseError::Expected(ex, got));
-                        self.recover_from_parse_error();
+                        items.push(ParseItem::Error(ParseError::Expected(ex, got)));
+                        recover_from_parse_error(lexer);
                     }
                     LexError::IsNewline(_) => {}
                     LexError::Ignored(y) => {
-                        parse_errors.push(ParseError::Unsupported(y));
-                        self.recover_from_parse_error();
+                        items.push(ParseItem::Error(ParseError::Unsupported(y)));
+                        recover_from_parse_error(lexer);
                     }
                     LexError::UnexpectedToken(got) => {
-                        parse_errors.push(ParseError::UnexpectedToken(got));
-                        self.recover_from_parse_error();
-                    }
-                    LexError::UnexpectedEOF => {
-                        self.lexer_stack.pop();
+                        items.push(ParseItem::Error(ParseError::UnexpectedToken(got)));
+                        recover_from_parse_error(lexer);
                     }
+                    LexError::UnexpectedEOF => break,
                     LexError::NeedTwoNodes(n1, n2) => {
-                        nodes.push(*n1);
-                        nodes.push(*n2);
+                        items.push(ParseItem::Node(*n1));
+                        items.push(ParseItem::Node(*n2));
                     }
                     LexError::UnexpectedError(x) => {
-                        parse_errors.push(ParseError::UnexpectedError(x));
+                        items.push(ParseItem::Error(ParseError::UnexpectedError(x)));
                         // TODO determine how to recover from this and where to markup
-                        self.recover_from_parse_error();
+                        recover_from_parse_error(lexer);
                     }
                     LexError::UnknownDirective(y) => {
-                        parse_errors.push(ParseError::UnknownDirective(y));
-                        self.recover_from_parse_error();
+                        items.push(ParseItem::Error(ParseError::UnknownDirective(y)));
+                        recover_from_parse_error(lexer);
                     }
                 },
             }
         }
-        println!("parse errors: {:?}", parse_errors);
-        (nodes, parse_errors)
+        ParsedFile { id, items }
     }
 
-    fn lexer(&mut self) -> Option<&mut Peekable<Lexer>> {
-        let item = &mut self.lexer_stack;
-        item.last_mut()
+    /// The files that this file includes, as they were written.
+    pub fn includes(&self) -> impl Iterator<Item = &With<String>> {
+        self.items.iter().filter_map(|x| match x {
+            ParseItem::Include(x) => match &x.dir {
+                DirectiveType::Include(path) => Some(path),
+            },
+            _ => None,
+        })
+    }
+}
+
+/// Skip the rest of the line
+///
+/// This is used to recover from parse errors. If there is a parse error,
+/// we will skip the rest of the line and try to parse the next line.
+fn recover_from_parse_error(lexer: &mut Peekable<Lexer>) {
+    for token in lexer.by_ref() {
+        if token == Token::Newline {
+            break;
+        }
     }
 }
 
@@ -500,7 +562,7 @@ impl TryFrom<&mut Peekable<Lexer>> for ParserNode {
                                 return Ok(ParserNode::new_iarith(
                                     With::new(IArithType::Addi, next_node.clone()),
                                     rd,
-                                    With::new(Register::X0, imm.info()),
+                                    With::at(Register::X0, imm.span),
                                     imm,
                                 ));
                             }
@@ -798,3 +860,30 @@ impl TryFrom<&mut Peekable<Lexer>> for ParserNode {
         }
     }
 }
+
+#[cfg(test)]
+mod test {
+    use crate::cfg::Cfg;
+    use crate::helpers::{StringFileReader, FACTORIAL_PROGRAM};
+    use crate::parser::{NodeKey, RVParser};
+
+    #[test]
+    fn nodes_are_numbered_in_order() {
+        let parse = || {
+            RVParser::new(StringFileReader::new(FACTORIAL_PROGRAM))
+                .parse("test.s", true)
+                .0
+        };
+        let nodes = parse();
+        let keys = nodes.iter().map(|x| x.id()).collect::<Vec<_>>();
+        assert_eq!(keys, (0..nodes.len()).map(NodeKey::new).collect::<Vec<_>>());
+        // Parsing again gives the same keys
+        assert_eq!(keys, parse().iter().map(|x| x.id()).collect::<Vec<_>>());
+
+        // The graph adds function entries, and numbers every node by its id
+        let cfg = Cfg::new(nodes).unwrap();
+        for node in &cfg {
+            assert_eq!(node.node().id().index(), node.id().index());
+        }
+    }
+}
@@ -1,3 +1,4 @@
+use crate::parser::keyword::{lowercase_keyword, MAX_KEYWORD_LEN};
 use crate::parser::token::{Info, Token};
 use std::{
     convert::TryFrom,
@@ -57,7 +58,8 @@ impl FromStr for Register {
     type Err = ();
 
     fn from_str(s: &str) -> Result<Self, Self::Err> {
-        match s.to_lowercase().as_str() {
+        let mut buf = [0; MAX_KEYWORD_LEN];
+        match lowercase_keyword(s, &mut buf) {
             "x0" | "zero" => Ok(Register::X0),
             "x1" | "ra" => Ok(Register::X1),
             "x2" | "sp" => Ok(Register::X2),
@@ -134,7 +136,7 @@ impl Register {
         }
     }
 
-    pub fn to_num(self) -> u8 {
+    pub const fn to_num(self) -> u8 {
         match self {
             Register::X0 => 0,
             Register::X1 => 1,
@@ -175,7 +177,7 @@ impl Register {
         self == Register::X2
     }
 
-    pub fn ecall_type() -> Register {
+    pub const fn ecall_type() -> Register {
         Register::X17
     }
 }
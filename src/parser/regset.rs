@@ -1,4 +1,5 @@
 use std::collections::HashSet;
+use std::ops::{BitAnd, BitAndAssign, BitOr, BitOrAssign, Not, Sub, SubAssign};
 
 use crate::parser::Register;
 
@@ -36,43 +37,277 @@ impl ToRegHashset for u32 {
     }
 }
 
+/// A set of registers, stored as a bitmap.
+///
+/// Bit `n` is set if register `xn` is in the set. As there are only 32
+/// registers, every set operation is a single integer operation and a set
+/// can be copied freely. This is the representation used by the dataflow
+/// analyses, where sets are combined on every node of every iteration.
+#[derive(Clone, Copy, PartialEq, Eq, Hash, Default)]
+pub struct RegSet(u32);
+
+impl RegSet {
+    /// The empty set.
+    pub const EMPTY: RegSet = RegSet(0);
+
+    /// The set of all registers.
+    pub const ALL: RegSet = RegSet(u32::MAX);
+
+    pub const fn new() -> Self {
+        RegSet::EMPTY
+    }
+
+    pub const fn from_bits(bits: u32) -> Self {
+        RegSet(bits)
+    }
+
+    pub const fn bits(self) -> u32 {
+        self.0
+    }
+
+    /// Create a set from a list of registers.
+    ///
+    /// This is a `const fn` so that well-known sets can be computed at
+    /// compile time.
+    pub const fn from_regs(regs: &[Register]) -> Self {
+        let mut bits = 0;
+        let mut i = 0;
+        while i < regs.len() {
+            bits |= 1 << regs[i].to_num();
+            i += 1;
+        }
+        RegSet(bits)
+    }
+
+    pub const fn single(reg: Register) -> Self {
+        RegSet(1 << reg.to_num())
+    }
+
+    pub const fn contains(self, reg: Register) -> bool {
+        self.0 & (1 << reg.to_num()) != 0
+    }
+
+    pub fn insert(&mut self, reg: Register) {
+        self.0 |= 1 << reg.to_num();
+    }
+
+    pub fn remove(&mut self, reg: Register) {
+        self.0 &= !(1 << reg.to_num());
+    }
+
+    pub const fn is_empty(self) -> bool {
+        self.0 == 0
+    }
+
+    pub const fn len(self) -> usize {
+        self.0.count_ones() as usize
+    }
+
+    pub const fn union(self, other: RegSet) -> Self {
+        RegSet(self.0 | other.0)
+    }
+
+    pub const fn intersection(self, other: RegSet) -> Self {
+        RegSet(self.0 & other.0)
+    }
+
+    pub const fn difference(self, other: RegSet) -> Self {
+        RegSet(self.0 & !other.0)
+    }
+
+    /// Iterate over the registers in the set, in register number order.
+    pub fn iter(self) -> RegSetIter {
+        RegSetIter(self.0)
+    }
+}
+
+pub struct RegSetIter(u32);
+
+impl Iterator for RegSetIter {
+    type Item = Register;
+
+    fn next(&mut self) -> Option<Self::Item> {
+        if self.0 == 0 {
+            return None;
+        }
+        let num = self.0.trailing_zeros();
+        self.0 &= self.0 - 1;
+        #[allow(clippy::cast_possible_truncation)]
+        Some(Register::from_num(num as u8))
+    }
+
+    fn size_hint(&self) -> (usize, Option<usize>) {
+        let len = self.0.count_ones() as usize;
+        (len, Some(len))
+    }
+}
+
+impl ExactSizeIterator for RegSetIter {}
+
+impl IntoIterator for RegSet {
+    type Item = Register;
+    type IntoIter = RegSetIter;
+
+    fn into_iter(self) -> Self::IntoIter {
+        self.iter()
+    }
+}
+
+impl FromIterator<Register> for RegSet {
+    fn from_iter<I: IntoIterator<Item = Register>>(iter: I) -> Self {
+        let mut set = RegSet::new();
+        set.extend(iter);
+        set
+    }
+}
+
+impl Extend<Register> for RegSet {
+    fn extend<I: IntoIterator<Item = Register>>(&mut self, iter: I) {
+        for reg in iter {
+            self.insert(reg);
+        }
+    }
+}
+
+impl BitOr for RegSet {
+    type Output = RegSet;
+
+    fn bitor(self, rhs: Self) -> Self::Output {
+        self.union(rhs)
+    }
+}
+
+impl BitOrAssign for RegSet {
+    fn bitor_assign(&mut self, rhs: Self) {
+        self.0 |= rhs.0;
+    }
+}
+
+impl BitAnd for RegSet {
+    type Output = RegSet;
+
+    fn bitand(self, rhs: Self) -> Self::Output {
+        self.intersection(rhs)
+    }
+}
+
+impl BitAndAssign for RegSet {
+    fn bitand_assign(&mut self, rhs: Self) {
+        self.0 &= rhs.0;
+    }
+}
+
+impl Sub for RegSet {
+    type Output = RegSet;
+
+    fn sub(self, rhs: Self) -> Self::Output {
+        self.difference(rhs)
+    }
+}
+
+impl SubAssign for RegSet {
+    fn sub_assign(&mut self, rhs: Self) {
+        self.0 &= !rhs.0;
+    }
+}
+
+impl Not for RegSet {
+    type Output = RegSet;
+
+    fn not(self) -> Self::Output {
+        RegSet(!self.0)
+    }
+}
+
+impl From<&HashSet<Register>> for RegSet {
+    fn from(set: &HashSet<Register>) -> Self {
+        RegSet(set.to_bitmap())
+    }
+}
+
+impl From<RegSet> for HashSet<Register> {
+    fn from(set: RegSet) -> Self {
+        set.iter().collect()
+    }
+}
+
+impl std::fmt::Debug for RegSet {
+    fn fmt(&self, f: &mut std::fmt::Formatter<'_>) -> std::fmt::Result {
+        f.debug_set().entries(self.iter()).finish()
+    }
+}
+
 pub struct RegSets;
 impl RegSets {
-    pub fn temporary() -> HashSet<Register> {
+    pub const fn temporary() -> RegSet {
         use Register::{X28, X29, X30, X31, X5, X6, X7};
-        vec![X5, X6, X7, X28, X29, X30, X31].into_iter().collect()
+        RegSet::from_regs(&[X5, X6, X7, X28, X29, X30, X31])
     }
-    pub fn argument() -> HashSet<Register> {
+    pub const fn argument() -> RegSet {
         use Register::{X10, X11, X12, X13, X14, X15, X16, X17};
-        vec![X10, X11, X12, X13, X14, X15, X16, X17]
-            .into_iter()
-            .collect()
+        RegSet::from_regs(&[X10, X11, X12, X13, X14, X15, X16, X17])
     }
-    pub fn ret() -> HashSet<Register> {
+    pub const fn ret() -> RegSet {
         RegSets::argument()
     }
 
-    pub fn saved() -> HashSet<Register> {
+    pub const fn saved() -> RegSet {
         use Register::{X18, X19, X20, X21, X22, X23, X24, X25, X26, X27, X8, X9};
-        vec![X8, X9, X18, X19, X20, X21, X22, X23, X24, X25, X26, X27]
-            .into_iter()
-            .collect()
+        RegSet::from_regs(&[X8, X9, X18, X19, X20, X21, X22, X23, X24, X25, X26, X27])
     }
-    pub fn sp_ra() -> HashSet<Register> {
+    pub const fn sp_ra() -> RegSet {
         use Register::{X1, X2};
-        vec![X2, X1].into_iter().collect()
+        RegSet::from_regs(&[X2, X1])
     }
-    pub fn caller_saved() -> HashSet<Register> {
-        let mut set = RegSets::temporary();
-        set.extend(RegSets::argument());
-        set
+    pub const fn caller_saved() -> RegSet {
+        RegSets::temporary().union(RegSets::argument())
     }
-    pub fn callee_saved() -> HashSet<Register> {
-        let mut set = RegSets::saved();
-        set.extend(RegSets::sp_ra());
-        set
+    pub const fn callee_saved() -> RegSet {
+        RegSets::saved().union(RegSets::sp_ra())
+    }
+    pub const fn ecall_always_argument() -> RegSet {
+        RegSet::single(Register::ecall_type())
+    }
+}
+
+#[cfg(test)]
+mod test {
+    use super::{RegSet, RegSets};
+    use crate::parser::Register;
+
+    #[test]
+    fn set_operations() {
+        let a = RegSet::from_regs(&[Register::X1, Register::X2, Register::X3]);
+        let b = RegSet::from_regs(&[Register::X2, Register::X3, Register::X4]);
+        assert_eq!(
+            a | b,
+            RegSet::from_regs(&[Register::X1, Register::X2, Register::X3, Register::X4])
+        );
+        assert_eq!(a & b, RegSet::from_regs(&[Register::X2, Register::X3]));
+        assert_eq!(a - b, RegSet::single(Register::X1));
+        assert_eq!((a - a).len(), 0);
+        assert!((a - a).is_empty());
     }
-    pub fn ecall_always_argument() -> HashSet<Register> {
-        vec![Register::ecall_type()].into_iter().collect()
+
+    #[test]
+    fn insert_remove() {
+        let mut set = RegSet::new();
+        set.insert(Register::X31);
+        set.insert(Register::X0);
+        assert!(set.contains(Register::X31));
+        assert!(set.contains(Register::X0));
+        set.remove(Register::X0);
+        assert!(!set.contains(Register::X0));
+        assert_eq!(set.iter().collect::<Vec<_>>(), vec![Register::X31]);
+    }
+
+    #[test]
+    fn known_sets() {
+        assert_eq!(RegSets::caller_saved().len(), 15);
+        assert_eq!(RegSets::callee_saved().len(), 14);
+        assert!(RegSets::caller_saved()
+            .intersection(RegSets::callee_saved())
+            .is_empty());
+        assert!(RegSets::ecall_always_argument().contains(Register::X17));
     }
 }
@@ -1,7 +1,7 @@
 use std::fmt::Display;
 use std::hash::{Hash, Hasher};
 
-use uuid::Uuid;
+use super::FileId;
 
 #[derive(Debug, PartialEq, Copy, Clone)]
 pub struct Position {
@@ -19,7 +19,7 @@ pub struct Range {
 pub struct Info {
     pub token: Token,
     pub pos: Range,
-    pub file: Uuid,
+    pub file: FileId,
 }
 
 /// Token type for the parser
@@ -69,21 +69,77 @@ impl PartialEq<Token> for Info {
         self.token == *other
     }
 }
-impl<T> With<T> {
-    pub fn info(&self) -> Info {
-        Info {
-            file: self.file.clone(),
-            token: self.token.clone(),
-            pos: self.pos.clone(),
+/// Where a token was in its file.
+///
+/// This is what `With` keeps of the token that its value was read from. It
+/// is a quarter of the size of a `Range` and never owns any text, so the
+/// operands of a node can be copied freely.
+#[derive(Debug, Default, PartialEq, Eq, Copy, Clone)]
+pub struct Span {
+    pub file: FileId,
+    start_line: u32,
+    start_column: u32,
+    end_line: u32,
+    end_column: u32,
+}
+
+fn narrow(x: usize) -> u32 {
+    u32::try_from(x).unwrap_or(u32::MAX)
+}
+
+impl Span {
+    pub fn new(file: FileId, range: &Range) -> Self {
+        Span {
+            file,
+            start_line: narrow(range.start.line),
+            start_column: narrow(range.start.column),
+            end_line: narrow(range.end.line),
+            end_column: narrow(range.end.column),
+        }
+    }
+
+    pub fn start(&self) -> Position {
+        Position {
+            line: self.start_line as usize,
+            column: self.start_column as usize,
+        }
+    }
+
+    pub fn end(&self) -> Position {
+        Position {
+            line: self.end_line as usize,
+            column: self.end_column as usize,
+        }
+    }
+
+    pub fn range(&self) -> Range {
+        Range {
+            start: self.start(),
+            end: self.end(),
         }
     }
+
+    /// The span from the start of this one to the end of `other`.
+    pub fn to(self, other: Span) -> Span {
+        Span {
+            end_line: other.end_line,
+            end_column: other.end_column,
+            ..self
+        }
+    }
+}
+
+impl From<&Info> for Span {
+    fn from(info: &Info) -> Self {
+        Span::new(info.file, &info.pos)
+    }
 }
 
 impl Default for Info {
     fn default() -> Self {
         Info {
             token: Token::Newline,
-            file: Uuid::nil(),
+            file: FileId::default(),
             pos: Range {
                 start: Position { line: 0, column: 0 },
                 end: Position { line: 0, column: 0 },
@@ -92,11 +148,10 @@ impl Default for Info {
     }
 }
 
-#[derive(Clone)]
+/// A value read from a token, along with where the token was.
+#[derive(Clone, Copy)]
 pub struct With<T> {
-    pub token: Token,
-    pub pos: Range,
-    pub file: Uuid,
+    pub span: Span,
     pub data: T,
 }
 
@@ -169,7 +224,7 @@ impl ToDisplayForTokenVec for Vec<Info> {
 
 pub trait LineDisplay {
     fn range(&self) -> Range;
-    fn file(&self) -> Uuid;
+    fn file(&self) -> FileId;
 }
 
 // implement display for Range
@@ -185,10 +240,10 @@ impl std::fmt::Display for Range {
 
 impl<T> LineDisplay for With<T> {
     fn range(&self) -> Range {
-        self.pos.clone()
+        self.span.range()
     }
-    fn file(&self) -> Uuid {
-        self.file.clone()
+    fn file(&self) -> FileId {
+        self.span.file
     }
 }
 
@@ -208,12 +263,11 @@ where
     T: PartialEq<T>,
 {
     pub fn new(data: T, info: Info) -> Self {
-        With {
-            token: info.token,
-            pos: info.pos,
-            file: info.file,
-            data,
-        }
+        With::at(data, Span::from(&info))
+    }
+
+    pub fn at(data: T, span: Span) -> Self {
+        With { span, data }
     }
 }
 
@@ -225,9 +279,7 @@ where
 
     fn try_from(value: Info) -> Result<Self, Self::Error> {
         Ok(With {
-            pos: value.pos.clone(),
-            token: value.token.clone(),
-            file: value.file,
+            span: Span::from(&value),
             data: T::try_from(value)?,
         })
     }
@@ -267,3 +319,22 @@ impl TokenExpression for Vec<Token> {
         println!();
     }
 }
+
+#[cfg(test)]
+mod test {
+    use super::{Position, Range, Span, With};
+    use crate::parser::{FileId, Register};
+
+    #[test]
+    fn operands_are_small() {
+        // A register and where it was, with no copy of its token
+        assert!(std::mem::size_of::<With<Register>>() <= 24);
+        let range = Range {
+            start: Position { line: 3, column: 4 },
+            end: Position { line: 3, column: 6 },
+        };
+        let span = Span::new(FileId::new(2).unwrap(), &range);
+        assert_eq!(span.range(), range);
+        assert_eq!(With::at(Register::X1, span).span.file.index(), 2);
+    }
+}
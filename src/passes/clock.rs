@@ -0,0 +1,68 @@
+// CLOCK
+// =====
+
+use std::time::Duration;
+
+/// Measures how long something takes, on every target.
+///
+/// `std::time::Instant` panics on `wasm32-unknown-unknown`, which the LSP
+/// module is built for, so everything that is timed uses this instead.
+/// There it reads `performance.now()` from the JS host.
+#[derive(Clone, Copy, Debug)]
+pub struct Stopwatch {
+    #[cfg(not(target_arch = "wasm32"))]
+    start: std::time::Instant,
+    /// Milliseconds since the host started
+    #[cfg(target_arch = "wasm32")]
+    start: f64,
+}
+
+#[cfg(target_arch = "wasm32")]
+mod host {
+    use wasm_bindgen::prelude::*;
+
+    #[wasm_bindgen]
+    extern "C" {
+        #[wasm_bindgen(js_namespace = performance, js_name = now)]
+        pub fn now() -> f64;
+    }
+}
+
+impl Stopwatch {
+    /// Start measuring from now.
+    #[must_use]
+    pub fn start() -> Stopwatch {
+        Stopwatch {
+            #[cfg(not(target_arch = "wasm32"))]
+            start: std::time::Instant::now(),
+            #[cfg(target_arch = "wasm32")]
+            start: host::now(),
+        }
+    }
+
+    /// The time since the stopwatch was started.
+    #[must_use]
+    pub fn elapsed(&self) -> Duration {
+        #[cfg(not(target_arch = "wasm32"))]
+        return self.start.elapsed();
+        #[cfg(target_arch = "wasm32")]
+        return Duration::from_secs_f64((host::now() - self.start).max(0.0) / 1000.0);
+    }
+}
+
+#[cfg(test)]
+mod test {
+    use std::time::Duration;
+
+    use super::Stopwatch;
+
+    #[test]
+    fn elapsed_time_only_grows() {
+        let stopwatch = Stopwatch::start();
+        let first = stopwatch.elapsed();
+        std::thread::sleep(Duration::from_millis(1));
+        let second = stopwatch.elapsed();
+        assert!(second >= first);
+        assert!(second >= Duration::from_millis(1));
+    }
+}
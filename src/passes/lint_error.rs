@@ -1,9 +1,8 @@
 use std::rc::Rc;
 
-use uuid::Uuid;
-
 use crate::cfg::Function;
 
+use crate::parser::FileId;
 use crate::parser::LineDisplay;
 use crate::parser::ParserNode;
 use crate::parser::Range;
@@ -64,53 +63,97 @@ impl From<&LintError> for WarningLevel {
 // implement display for passerror
 impl std::fmt::Display for LintError {
     fn fmt(&self, f: &mut std::fmt::Formatter) -> std::fmt::Result {
-        match self {
-            LintError::DeadAssignment(_) => write!(f, "Unused value"),
-            LintError::SaveToZero(_) => write!(f, "Saving to zero register"),
-            LintError::InvalidUseAfterCall(_, _) => write!(f, "Invalid use after call"),
-            LintError::ImproperFuncEntry(..) => write!(f, "Improper function entry"),
-            LintError::UnknownEcall(_) => write!(f, "Unknown ecall"),
-            LintError::UnreachableCode(_) => write!(f, "Unreachable code"),
-            LintError::InvalidUseBeforeAssignment(_) => write!(f, "Invalid use before assignment"),
-            LintError::UnknownStack(_) => write!(f, "Unknown stack value"),
-            LintError::InvalidStackPointer(_) => write!(f, "Invalid stack pointer"),
-            LintError::InvalidStackPosition(_, _) => write!(f, "Invalid stack position"),
-            LintError::OverwriteCalleeSavedRegister(_, _) => {
-                write!(f, "Overwriting callee-saved register")
-            }
-        }
+        f.write_str(self.name())
     }
 }
 
-impl LintError {
-    pub fn long_description(&self) -> String {
-        match self {
-            LintError::DeadAssignment(_) => "Unused value".to_string(),
-            LintError::SaveToZero(_) => "The result of this instruction is being stored to the zero (x0) register. This instruction has no effect.".to_string(),
-            LintError::InvalidUseAfterCall(_,x) => format!("Register were read from after a function call to {}. Reading from these registers is invalid and likely contain garbage values.\n\nIt is possible that this register was not defined across every path within the function. If you expected this register to be a return value, re-examine the function definition.",
-                x.entry.labels.iter().map(|label| label.data.0.clone()).collect::<Vec<_>>().join(", ")
-        ),
-            LintError::ImproperFuncEntry(..) => "This function can be entered through non-conventional ways. Either by the code before or through a jump. This label is treated like a function because there is either a [jal] instruction or an explicit definition of this function.".to_string(),
-            LintError::UnknownEcall(_) => "The ecall type is not recognized. It is possible that you did not set a7 to a value.".to_string(),
-            LintError::UnreachableCode(_) => "This code is unreachable. It is possible that you have a jump to a label that does not exist.".to_string(),
-            LintError::InvalidUseBeforeAssignment(_) => "This register is being used before it is assigned to.".to_string(),
-            LintError::UnknownStack(_) => "The stack value is not definitely known.".to_string(),
-            LintError::InvalidStackPointer(_) => "The stack pointer is being overwritten.".to_string(),
-            LintError::InvalidStackPosition(_, _) => "The stack value is wrong way (positive).".to_string(),
-            LintError::OverwriteCalleeSavedRegister(_, x) => format!("Register {x} is being overwritten without the original value being restored at the end of the function. This register is callee-saved and should not be overwritten.
+/// The long description of a lint error.
+///
+/// It is written straight to the formatter when displayed, so printing many
+/// errors does not build a string for each.
+pub struct Description<'a>(&'a LintError);
+
+impl std::fmt::Display for Description<'_> {
+    fn fmt(&self, f: &mut std::fmt::Formatter) -> std::fmt::Result {
+        match self.0 {
+            LintError::DeadAssignment(_) => f.write_str("Unused value"),
+            LintError::SaveToZero(_) => f.write_str("The result of this instruction is being stored to the zero (x0) register. This instruction has no effect."),
+            LintError::InvalidUseAfterCall(_,x) => {
+                f.write_str("Register were read from after a function call to ")?;
+                for (i, label) in x.entry.labels.iter().enumerate() {
+                    if i > 0 {
+                        f.write_str(", ")?;
+                    }
+                    f.write_str(&label.data.0)?;
+                }
+                f.write_str(". Reading from these registers is invalid and likely contain garbage values.\n\nIt is possible that this register was not defined across every path within the function. If you expected this register to be a return value, re-examine the function definition.")
+            }
+            LintError::ImproperFuncEntry(..) => f.write_str("This function can be entered through non-conventional ways. Either by the code before or through a jump. This label is treated like a function because there is either a [jal] instruction or an explicit definition of this function."),
+            LintError::UnknownEcall(_) => f.write_str("The ecall type is not recognized. It is possible that you did not set a7 to a value."),
+            LintError::UnreachableCode(_) => f.write_str("This code is unreachable. It is possible that you have a jump to a label that does not exist."),
+            LintError::InvalidUseBeforeAssignment(_) => f.write_str("This register is being used before it is assigned to."),
+            LintError::UnknownStack(_) => f.write_str("The stack value is not definitely known."),
+            LintError::InvalidStackPointer(_) => f.write_str("The stack pointer is being overwritten."),
+            LintError::InvalidStackPosition(_, _) => f.write_str("The stack value is wrong way (positive)."),
+            LintError::OverwriteCalleeSavedRegister(_, x) => write!(f, "Register {x} is being overwritten without the original value being restored at the end of the function. This register is callee-saved and should not be overwritten.
             You should be saving this register to the stack at the start of the function and restoring it at the end of the function."),
             // TODO extend Overwrite with real value analysis if known
             // You saved the value of xx to the stack on line xx. Perhaps you meant
             // to restore from this value instead.
         }
     }
+}
+
+impl LintError {
+    /// A short title for the error.
+    pub fn name(&self) -> &'static str {
+        match self {
+            LintError::DeadAssignment(_) => "Unused value",
+            LintError::SaveToZero(_) => "Saving to zero register",
+            LintError::InvalidUseAfterCall(_, _) => "Invalid use after call",
+            LintError::ImproperFuncEntry(..) => "Improper function entry",
+            LintError::UnknownEcall(_) => "Unknown ecall",
+            LintError::UnreachableCode(_) => "Unreachable code",
+            LintError::InvalidUseBeforeAssignment(_) => "Invalid use before assignment",
+            LintError::UnknownStack(_) => "Unknown stack value",
+            LintError::InvalidStackPointer(_) => "Invalid stack pointer",
+            LintError::InvalidStackPosition(_, _) => "Invalid stack position",
+            LintError::OverwriteCalleeSavedRegister(_, _) => "Overwriting callee-saved register",
+        }
+    }
+
+    /// A stable identifier for the kind of error, for tools that read the
+    /// diagnostics.
+    pub fn code(&self) -> &'static str {
+        match self {
+            LintError::DeadAssignment(_) => "dead-assignment",
+            LintError::SaveToZero(_) => "save-to-zero",
+            LintError::InvalidUseAfterCall(_, _) => "invalid-use-after-call",
+            LintError::ImproperFuncEntry(..) => "improper-function-entry",
+            LintError::UnknownEcall(_) => "unknown-ecall",
+            LintError::UnreachableCode(_) => "unreachable-code",
+            LintError::InvalidUseBeforeAssignment(_) => "invalid-use-before-assignment",
+            LintError::UnknownStack(_) => "unknown-stack",
+            LintError::InvalidStackPointer(_) => "invalid-stack-pointer",
+            LintError::InvalidStackPosition(_, _) => "invalid-stack-position",
+            LintError::OverwriteCalleeSavedRegister(_, _) => "overwrite-callee-saved-register",
+        }
+    }
+
+    pub fn description(&self) -> Description<'_> {
+        Description(self)
+    }
+
+    pub fn long_description(&self) -> String {
+        self.description().to_string()
+    }
 
     pub fn range(&self) -> Range {
         match self {
             LintError::InvalidUseAfterCall(r, _)
             | LintError::SaveToZero(r)
             | LintError::InvalidUseBeforeAssignment(r)
-            | LintError::DeadAssignment(r) => r.pos.clone(),
+            | LintError::DeadAssignment(r) => r.range(),
             LintError::ImproperFuncEntry(r, _)
             | LintError::UnknownEcall(r)
             | LintError::UnreachableCode(r)
@@ -121,12 +164,12 @@ impl LintError {
         }
     }
 
-    pub fn file(&self) -> Uuid {
+    pub fn file(&self) -> FileId {
         match self {
             LintError::InvalidUseAfterCall(r, _)
             | LintError::SaveToZero(r)
             | LintError::InvalidUseBeforeAssignment(r)
-            | LintError::DeadAssignment(r) => r.file,
+            | LintError::DeadAssignment(r) => r.file(),
             LintError::ImproperFuncEntry(r, _)
             | LintError::UnknownEcall(r)
             | LintError::UnreachableCode(r)
@@ -1,43 +1,157 @@
 use crate::{
-    analysis::{AvailableValuePass, LivenessPass},
-    cfg::Cfg,
+    analysis::{AvailableValuePass, FunctionSummaryPass, LivenessPass},
+    cfg::{Cfg, Facts},
     gen::{
         EcallTerminationPass, EliminateDeadCodeDirectionsPass, FunctionMarkupPass,
         NodeDirectionPass,
     },
-    lints::{
-        CalleeSavedGarbageReadCheck, CalleeSavedRegisterCheck, ControlFlowCheck, DeadValueCheck,
-        EcallCheck, GarbageInputValueCheck, SaveToZeroCheck, StackCheckPass,
-    },
+    lints::{LintConfig, LintEngine},
 };
 
-use super::{CFGError, GenerationPass, LintError, LintPass};
+use super::{CFGError, GenerationPass, LintError, NoStats, Recorder};
 
 pub struct Manager;
 impl Manager {
-    pub fn run(cfg: Cfg, debug: bool) -> Result<Vec<LintError>, Box<CFGError>> {
+    /// The number of generation passes, which `gen_pass` runs one at a time.
+    pub const PASSES: usize = 7;
+
+    /// Run the `index`th generation pass on the graph. Each pass expects
+    /// the ones before it to have been run, and passes past the last one do
+    /// nothing.
+    ///
+    /// This lets an analysis stop between passes and carry on later.
+    pub fn gen_pass<R: Recorder>(
+        cfg: &mut Cfg,
+        index: usize,
+        jobs: usize,
+        recorder: &mut R,
+    ) -> Result<(), Box<CFGError>> {
+        match index {
+            0 => recorder.pass("NodeDirectionPass", |_| NodeDirectionPass::run(cfg)),
+            1 => recorder.pass("EliminateDeadCodeDirectionsPass", |x| {
+                EliminateDeadCodeDirectionsPass::run_recorded(cfg, x);
+                Ok(())
+            }),
+            2 => recorder.pass("FunctionMarkupPass", |_| FunctionMarkupPass::run(cfg)),
+            3 => recorder.pass("AvailableValuePass", |x| {
+                AvailableValuePass::run_recorded(cfg, x);
+                Ok(())
+            }),
+            // EliminateDeadCodeDirectionsPass::run(cfg) could follow, to
+            // eliminate ecall terminated code
+            4 => recorder.pass("EcallTerminationPass", |_| EcallTerminationPass::run(cfg)),
+            5 => recorder.pass("LivenessPass", |x| {
+                LivenessPass::run_parallel(cfg, jobs, x);
+                Ok(())
+            }),
+            6 => recorder.pass("FunctionSummaryPass", |_| FunctionSummaryPass::run(cfg)),
+            _ => Ok(()),
+        }
+    }
+
+    /// Run all generation passes on the graph.
+    pub fn gen_full_cfg(cfg: Cfg) -> Result<Cfg, Box<CFGError>> {
+        Manager::gen_full_cfg_with_jobs(cfg, 1)
+    }
+
+    /// Run all generation passes on the graph, using up to `jobs` threads
+    /// for the passes that can be split up by function.
+    pub fn gen_full_cfg_with_jobs(cfg: Cfg, jobs: usize) -> Result<Cfg, Box<CFGError>> {
+        Manager::gen_full_cfg_recorded(cfg, jobs, &mut NoStats)
+    }
+
+    /// Run all generation passes on the graph, recording the time and
+    /// counters of each pass.
+    pub fn gen_full_cfg_recorded<R: Recorder>(
+        cfg: Cfg,
+        jobs: usize,
+        recorder: &mut R,
+    ) -> Result<Cfg, Box<CFGError>> {
+        let mut cfg = cfg;
+        for index in 0..Manager::PASSES {
+            Manager::gen_pass(&mut cfg, index, jobs, recorder)?;
+        }
+        Ok(cfg)
+    }
+
+    /// Run all generation passes, like `gen_full_cfg_recorded`, freeing the
+    /// stack values as soon as the register values have been found from
+    /// them, so that the passes after can reuse their memory.
+    pub fn gen_full_cfg_freeing<R: Recorder>(
+        cfg: Cfg,
+        jobs: usize,
+        recorder: &mut R,
+    ) -> Result<Cfg, Box<CFGError>> {
         let mut cfg = cfg;
-        let mut errors = Vec::new();
-
-        NodeDirectionPass::run(&mut cfg)?;
-        EliminateDeadCodeDirectionsPass::run(&mut cfg)?;
-        FunctionMarkupPass::run(&mut cfg)?;
-        AvailableValuePass::run(&mut cfg)?;
-        EcallTerminationPass::run(&mut cfg)?;
-        // EliminateDeadCodeDirectionsPass::run(&mut cfg)?; // to eliminate ecall terminated code
-        LivenessPass::run(&mut cfg)?;
+        for index in 0..Manager::PASSES {
+            Manager::gen_pass(&mut cfg, index, jobs, recorder)?;
+            // Only the available value pass reads them
+            if index == 3 {
+                cfg.free(Facts::StackValues);
+            }
+        }
+        Ok(cfg)
+    }
+
+    pub fn run(cfg: Cfg, debug: bool) -> Result<Vec<LintError>, Box<CFGError>> {
+        Manager::run_with_jobs(cfg, debug, 1)
+    }
+
+    pub fn run_with_jobs(
+        cfg: Cfg,
+        debug: bool,
+        jobs: usize,
+    ) -> Result<Vec<LintError>, Box<CFGError>> {
+        let cfg = Manager::gen_full_cfg_with_jobs(cfg, jobs)?;
+
         if debug {
             println!("{}", cfg);
         }
-        SaveToZeroCheck::run(&cfg, &mut errors);
-        DeadValueCheck::run(&cfg, &mut errors);
-        EcallCheck::run(&cfg, &mut errors);
-        ControlFlowCheck::run(&cfg, &mut errors);
-        GarbageInputValueCheck::run(&cfg, &mut errors);
-        StackCheckPass::run(&cfg, &mut errors);
-        CalleeSavedRegisterCheck::run(&cfg, &mut errors);
-        CalleeSavedGarbageReadCheck::run(&cfg, &mut errors);
-
-        Ok(errors)
+
+        Ok(Manager::lint(&cfg))
+    }
+
+    /// Run all lints on a graph that has already been generated.
+    pub fn lint(cfg: &Cfg) -> Vec<LintError> {
+        Manager::lint_with(cfg, &LintConfig::default())
+    }
+
+    /// Run the lints that are enabled in `config` on a graph that has
+    /// already been generated.
+    pub fn lint_with(cfg: &Cfg, config: &LintConfig) -> Vec<LintError> {
+        LintEngine::new(config).run(cfg)
+    }
+
+    /// Run the lints that are enabled in `config`, recording the time of
+    /// each lint.
+    pub fn lint_recorded<R: Recorder>(
+        cfg: &Cfg,
+        config: &LintConfig,
+        recorder: &mut R,
+    ) -> Vec<LintError> {
+        LintEngine::new(config).run_recorded(cfg, recorder)
+    }
+
+    /// Run the lints that are enabled in `config`, passing each error to
+    /// `emit` as soon as it is found.
+    pub fn lint_streamed<R: Recorder>(
+        cfg: &Cfg,
+        config: &LintConfig,
+        recorder: &mut R,
+        emit: impl FnMut(LintError),
+    ) {
+        LintEngine::new(config).stream(cfg, recorder, emit);
+    }
+
+    /// Run the lints that are enabled in `config`, like `lint_streamed`,
+    /// freeing the facts about the nodes of the graph as soon as the lints
+    /// that read them are done.
+    pub fn lint_freeing<R: Recorder>(
+        cfg: &mut Cfg,
+        config: &LintConfig,
+        recorder: &mut R,
+        emit: impl FnMut(LintError),
+    ) {
+        LintEngine::new(config).stream_freeing(cfg, recorder, emit);
     }
 }
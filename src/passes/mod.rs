@@ -9,3 +9,9 @@ pub use cfg_error::*;
 
 mod manager;
 pub use manager::*;
+
+mod stats;
+pub use stats::*;
+
+mod clock;
+pub use clock::*;
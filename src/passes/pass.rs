@@ -1,4 +1,6 @@
-use crate::cfg::Cfg;
+use std::rc::Rc;
+
+use crate::cfg::{CFGNode, Cfg, Function};
 
 use super::{CFGError, LintError};
 
@@ -13,3 +15,16 @@ pub trait AssertionPass {
 pub trait LintPass {
     fn run(cfg: &Cfg, errors: &mut Vec<LintError>);
 }
+
+/// A lint that only needs to look at one node at a time.
+///
+/// These are run by a `LintEngine`, which walks the graph once and calls
+/// every enabled lint on each node.
+pub trait NodeLint {
+    fn check(cfg: &Cfg, node: &Rc<CFGNode>, errors: &mut Vec<LintError>);
+}
+
+/// A lint that only needs to look at one function at a time.
+pub trait FunctionLint {
+    fn check(cfg: &Cfg, func: &Function, errors: &mut Vec<LintError>);
+}
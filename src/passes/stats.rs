@@ -0,0 +1,300 @@
+// PIPELINE STATISTICS
+// ===================
+
+use std::fmt::Display;
+use std::ops::AddAssign;
+use std::time::Duration;
+
+use serde::{Serialize, Serializer};
+
+use crate::lints::Lint;
+use crate::passes::Stopwatch;
+
+/// The work done by a pass, as counted by the pass itself.
+///
+/// For the dataflow solver, an iteration is a block taken off the worklist,
+/// `visited` is the number of nodes in those blocks and `changed` is the
+/// number of nodes in the blocks whose facts changed.
+#[derive(Clone, Copy, Debug, Default, PartialEq, Eq, Serialize)]
+pub struct Counters {
+    pub iterations: usize,
+    pub visited: usize,
+    pub changed: usize,
+}
+
+impl AddAssign for Counters {
+    fn add_assign(&mut self, rhs: Self) {
+        self.iterations += rhs.iterations;
+        self.visited += rhs.visited;
+        self.changed += rhs.changed;
+    }
+}
+
+/// Somewhere for a pass to count its work, or nowhere.
+///
+/// Passes are generic over what they count with, so that when nothing is
+/// being recorded they count with `NoStats` and the counting is removed.
+pub trait Count: Default + Send {
+    fn add(&mut self, counters: Counters);
+}
+
+impl Count for Counters {
+    #[inline(always)]
+    fn add(&mut self, counters: Counters) {
+        *self += counters;
+    }
+}
+
+fn micros<S: Serializer>(time: &Duration, s: S) -> Result<S::Ok, S::Error> {
+    s.serialize_u64(u64::try_from(time.as_micros()).unwrap_or(u64::MAX))
+}
+
+/// A file that was read, and how long it took to lex.
+#[derive(Clone, Debug, PartialEq, Eq, Serialize)]
+pub struct FileStats {
+    pub path: String,
+    pub bytes: usize,
+    /// Whether an earlier parse of the file was used, so it was not lexed
+    pub cached: bool,
+    #[serde(rename = "lex_us", serialize_with = "micros")]
+    pub lex: Duration,
+}
+
+/// How long a generation pass took and the work that it counted.
+#[derive(Clone, Debug, PartialEq, Eq, Serialize)]
+pub struct PassStats {
+    pub name: &'static str,
+    #[serde(rename = "time_us", serialize_with = "micros")]
+    pub time: Duration,
+    #[serde(flatten)]
+    pub counters: Counters,
+}
+
+/// How long a lint took and how many errors it found.
+#[derive(Clone, Debug, PartialEq, Eq, Serialize)]
+pub struct LintStats {
+    #[serde(serialize_with = "lint_name")]
+    pub lint: Lint,
+    #[serde(rename = "time_us", serialize_with = "micros")]
+    pub time: Duration,
+    pub errors: usize,
+}
+
+fn lint_name<S: Serializer>(lint: &Lint, s: S) -> Result<S::Ok, S::Error> {
+    s.serialize_str(lint.name())
+}
+
+/// Where the time went while analysing one program.
+#[derive(Clone, Debug, Default, PartialEq, Eq, Serialize)]
+pub struct Stats {
+    /// Every file that was read, in the order that they were read
+    pub files: Vec<FileStats>,
+    /// The time to parse the program, including lexing all of its files
+    #[serde(rename = "parse_us", serialize_with = "micros")]
+    pub parse: Duration,
+    pub passes: Vec<PassStats>,
+    pub lints: Vec<LintStats>,
+    /// The most memory that the process had resident at once by the end,
+    /// in kilobytes, if the system keeps track of it. This is for the whole
+    /// process, so it includes any program that was analysed before.
+    #[serde(rename = "peak_rss_kb")]
+    pub peak_rss: Option<u64>,
+}
+
+impl Stats {
+    pub fn new() -> Self {
+        Stats::default()
+    }
+
+    /// The time spent over the parse, every pass and every lint.
+    pub fn total(&self) -> Duration {
+        self.parse
+            + self.passes.iter().map(|x| x.time).sum::<Duration>()
+            + self.lints.iter().map(|x| x.time).sum::<Duration>()
+    }
+}
+
+/// The most memory that this process has had resident at once, in
+/// kilobytes, on systems that keep track of it.
+pub fn peak_rss() -> Option<u64> {
+    let status = std::fs::read_to_string("/proc/self/status").ok()?;
+    let line = status.lines().find_map(|x| x.strip_prefix("VmHWM:"))?;
+    line.trim().strip_suffix("kB")?.trim().parse().ok()
+}
+
+impl Display for Stats {
+    fn fmt(&self, f: &mut std::fmt::Formatter<'_>) -> std::fmt::Result {
+        writeln!(f, "  {:<36} {:>12} {:>12}", "file", "bytes", "lex (us)")?;
+        for file in &self.files {
+            write!(f, "  {:<36} {:>12} ", file.path, file.bytes)?;
+            if file.cached {
+                writeln!(f, "{:>12}", "cached")?;
+            } else {
+                writeln!(f, "{:>12}", file.lex.as_micros())?;
+            }
+        }
+        writeln!(f, "  {:<36} {:>12}", "parse (us)", self.parse.as_micros())?;
+
+        writeln!(
+            f,
+            "  {:<36} {:>12} {:>12} {:>12} {:>12}",
+            "pass", "time (us)", "iterations", "visited", "changed"
+        )?;
+        for pass in &self.passes {
+            writeln!(
+                f,
+                "  {:<36} {:>12} {:>12} {:>12} {:>12}",
+                pass.name,
+                pass.time.as_micros(),
+                pass.counters.iterations,
+                pass.counters.visited,
+                pass.counters.changed
+            )?;
+        }
+
+        writeln!(f, "  {:<36} {:>12} {:>12}", "lint", "time (us)", "errors")?;
+        for lint in &self.lints {
+            writeln!(
+                f,
+                "  {:<36} {:>12} {:>12}",
+                lint.lint.name(),
+                lint.time.as_micros(),
+                lint.errors
+            )?;
+        }
+        write!(f, "  {:<36} {:>12}", "total (us)", self.total().as_micros())?;
+        if let Some(peak) = self.peak_rss {
+            write!(f, "\n  {:<36} {:>12}", "peak rss (kB)", peak)?;
+        }
+        Ok(())
+    }
+}
+
+/// Somewhere to record statistics, or nowhere.
+///
+/// Code that is generic over a recorder is compiled once for `NoStats`,
+/// where `stats` is always `None` and every measurement is removed, and once
+/// for `Stats`.
+pub trait Recorder {
+    /// What a pass counts its work with before handing it to `count`
+    type Counter: Count;
+
+    fn stats(&mut self) -> Option<&mut Stats>;
+
+    /// Add to the counters of the pass that is running.
+    fn count(&mut self, counter: Self::Counter);
+
+    /// Run a generation pass, recording its time and counters.
+    #[inline(always)]
+    fn pass<T>(&mut self, name: &'static str, f: impl FnOnce(&mut Self) -> T) -> T {
+        let Some(stats) = self.stats() else {
+            return f(self);
+        };
+        let index = stats.passes.len();
+        stats.passes.push(PassStats {
+            name,
+            time: Duration::ZERO,
+            counters: Counters::default(),
+        });
+        let start = Stopwatch::start();
+        let res = f(self);
+        let time = start.elapsed();
+        if let Some(pass) = self.stats().map(|x| &mut x.passes[index]) {
+            pass.time = time;
+        }
+        res
+    }
+}
+
+/// Records nothing.
+#[derive(Clone, Copy, Debug, Default)]
+pub struct NoStats;
+
+impl Count for NoStats {
+    #[inline(always)]
+    fn add(&mut self, _: Counters) {}
+}
+
+impl Recorder for NoStats {
+    type Counter = NoStats;
+
+    #[inline(always)]
+    fn stats(&mut self) -> Option<&mut Stats> {
+        None
+    }
+
+    #[inline(always)]
+    fn count(&mut self, _: NoStats) {}
+}
+
+impl Recorder for Stats {
+    type Counter = Counters;
+
+    fn stats(&mut self) -> Option<&mut Stats> {
+        Some(self)
+    }
+
+    fn count(&mut self, counter: Counters) {
+        if let Some(pass) = self.passes.last_mut() {
+            pass.counters += counter;
+        }
+    }
+}
+
+/// Records into the statistics if there are any, for work that is only
+/// sometimes recorded and is done a bit at a time.
+impl Recorder for Option<Stats> {
+    type Counter = Counters;
+
+    fn stats(&mut self) -> Option<&mut Stats> {
+        self.as_mut()
+    }
+
+    fn count(&mut self, counter: Counters) {
+        if let Some(stats) = self {
+            stats.count(counter);
+        }
+    }
+}
+
+#[cfg(test)]
+mod test {
+    use super::{peak_rss, Count, Counters, NoStats, Recorder, Stats};
+
+    #[test]
+    fn counters_belong_to_their_pass() {
+        let counters = Counters {
+            iterations: 2,
+            visited: 3,
+            changed: 1,
+        };
+        let mut stats = Stats::new();
+        stats.pass("first", |x| x.count(counters));
+        stats.pass("second", |_| {});
+        // Nothing is kept when nothing is being recorded
+        NoStats.pass("third", |x| {
+            let mut counter = NoStats;
+            counter.add(counters);
+            x.count(counter);
+        });
+        stats.pass("fourth", |x| {
+            x.count(counters);
+            x.count(counters);
+        });
+
+        let counters = stats.passes.iter().map(|x| x.counters).collect::<Vec<_>>();
+        assert_eq!(counters[0].iterations, 2);
+        assert_eq!(counters[0].visited, 3);
+        assert_eq!(counters[1], Counters::default());
+        assert_eq!(counters[2].changed, 2);
+        assert_eq!(stats.passes.len(), 3);
+    }
+
+    #[test]
+    fn peak_rss_is_read_where_it_is_kept() {
+        let peak = peak_rss();
+        if cfg!(target_os = "linux") {
+            assert!(peak.is_some_and(|x| x > 0));
+        }
+    }
+}
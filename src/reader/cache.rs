@@ -0,0 +1,71 @@
+use std::collections::hash_map::DefaultHasher;
+use std::collections::HashMap;
+use std::hash::{Hash, Hasher};
+use std::sync::{Arc, Mutex};
+
+use crate::parser::{FileId, ParsedFile};
+
+/// Parsed files, kept by path along with a hash of their contents.
+///
+/// A file is only parsed again when its contents change, so a file that is
+/// included by many others is only parsed once. Every cached parse also
+/// keeps the includes of its file, which makes up the include graph of
+/// every file that has been read.
+///
+/// The nodes of a parse refer to the id of its file, so readers that share
+/// a cache also share its ids: every path is given an id of its own the
+/// first time that it is asked for.
+///
+/// The cache can be shared between threads.
+#[derive(Default)]
+pub struct ParseCache {
+    files: Mutex<HashMap<String, (u64, Arc<ParsedFile>)>>,
+    ids: Mutex<HashMap<String, FileId>>,
+}
+
+impl ParseCache {
+    pub fn new() -> Self {
+        ParseCache::default()
+    }
+
+    /// The id of the file at `path`, or `None` once every id has been
+    /// given out.
+    pub fn file_id(&self, path: &str) -> Option<FileId> {
+        let mut ids = self.ids.lock().ok()?;
+        if let Some(&id) = ids.get(path) {
+            return Some(id);
+        }
+        let id = FileId::new(ids.len())?;
+        ids.insert(path.to_owned(), id);
+        Some(id)
+    }
+
+    /// The parse of a file, if the contents of the file had `hash` when it
+    /// was parsed.
+    pub fn get(&self, path: &str, hash: u64) -> Option<Arc<ParsedFile>> {
+        let files = self.files.lock().ok()?;
+        files
+            .get(path)
+            .filter(|(x, _)| *x == hash)
+            .map(|(_, parsed)| Arc::clone(parsed))
+    }
+
+    pub fn insert(&self, path: &str, hash: u64, parsed: &Arc<ParsedFile>) {
+        if let Ok(mut files) = self.files.lock() {
+            files.insert(path.to_owned(), (hash, Arc::clone(parsed)));
+        }
+    }
+
+    pub fn remove(&self, path: &str) {
+        if let Ok(mut files) = self.files.lock() {
+            files.remove(path);
+        }
+    }
+}
+
+/// A hash of the contents of a file, for looking up its parse in a cache.
+pub fn content_hash(text: &str) -> u64 {
+    let mut hasher = DefaultHasher::new();
+    text.hash(&mut hasher);
+    hasher.finish()
+}
@@ -0,0 +1,208 @@
+use std::fs;
+use std::io::{self, Write};
+use std::path::{Path, PathBuf};
+use std::sync::atomic::{AtomicUsize, Ordering};
+
+use serde::{Deserialize, Serialize};
+
+use super::content_hash;
+
+/// A file that a result depends on, and the hash of its contents when the
+/// result was made. Includes that could not be read have no hash, since
+/// the result would change if they appeared.
+pub type Input = (String, Option<u64>);
+
+/// The output of linting a file, as it was kept by a `DiskCache`.
+#[derive(Clone, Debug, PartialEq, Eq)]
+pub struct CachedOutput {
+    /// The file and everything that it included
+    pub inputs: Vec<Input>,
+    /// The number of diagnostics in `output`
+    pub written: usize,
+    pub output: Vec<u8>,
+}
+
+/// Everything in an entry but the output, which follows it on its own bytes.
+#[derive(Serialize, Deserialize)]
+struct Header {
+    version: String,
+    inputs: Vec<Input>,
+    written: usize,
+}
+
+/// Gives every temporary file that this process writes its own name.
+static TEMPORARY: AtomicUsize = AtomicUsize::new(0);
+
+/// Results of linting files, kept in a directory between runs.
+///
+/// An entry is found by the path of the file that was linted, both exactly
+/// as it was given and canonicalized, the options that were used and the
+/// version of the tool. It is
+/// only used if the file and every file that it included, transitively,
+/// still hash the same, so changing any of them makes its result stale
+/// without looking anything up.
+pub struct DiskCache {
+    dir: PathBuf,
+}
+
+impl DiskCache {
+    pub fn new(dir: &Path) -> io::Result<Self> {
+        fs::create_dir_all(dir)?;
+        Ok(DiskCache {
+            dir: dir.to_owned(),
+        })
+    }
+
+    /// The key of the result of linting `path` with `options`, which
+    /// should describe everything that changes the output.
+    ///
+    /// The output names files by the path that was given, so it is part of
+    /// the key. So is the file that it leads to, since the same relative
+    /// path given in another directory is a different file.
+    pub fn key(path: &Path, options: &str) -> u64 {
+        DiskCache::key_from(&std::env::current_dir().unwrap_or_default(), path, options)
+    }
+
+    /// The key of `path`, when it is relative to `dir`.
+    fn key_from(dir: &Path, path: &Path, options: &str) -> u64 {
+        let full = dir.join(path);
+        let root = full.canonicalize().unwrap_or(full);
+        content_hash(&format!(
+            "{}\n{}\n{}\n{}",
+            env!("CARGO_PKG_VERSION"),
+            options,
+            path.display(),
+            root.display()
+        ))
+    }
+
+    fn entry(&self, key: u64) -> PathBuf {
+        self.dir.join(format!("{key:016x}.entry"))
+    }
+
+    /// The kept result for `key`, if none of its inputs have changed since.
+    pub fn get(&self, key: u64) -> Option<CachedOutput> {
+        let mut bytes = fs::read(self.entry(key)).ok()?;
+        let split = bytes.iter().position(|&x| x == b'\n')?;
+        let header = serde_json::from_slice::<Header>(bytes.get(..split)?).ok()?;
+        if header.version != env!("CARGO_PKG_VERSION") {
+            return None;
+        }
+        for (path, hash) in &header.inputs {
+            let now = fs::read_to_string(path).ok().map(|x| content_hash(&x));
+            if now != *hash {
+                return None;
+            }
+        }
+        // The output can be large, so it is kept where it was read
+        bytes.drain(..=split);
+        Some(CachedOutput {
+            inputs: header.inputs,
+            written: header.written,
+            output: bytes,
+        })
+    }
+
+    /// Keep a result for `key`, replacing any result that was kept before.
+    ///
+    /// The entry is written to a file of its own and then moved into
+    /// place, so other runs never read half of it.
+    pub fn insert(&self, key: u64, result: &CachedOutput) -> io::Result<()> {
+        let header = Header {
+            version: env!("CARGO_PKG_VERSION").to_owned(),
+            inputs: result.inputs.clone(),
+            written: result.written,
+        };
+        let temporary = self.dir.join(format!(
+            "{key:016x}.{}.{}.tmp",
+            std::process::id(),
+            TEMPORARY.fetch_add(1, Ordering::Relaxed)
+        ));
+        let mut file = io::BufWriter::new(fs::File::create(&temporary)?);
+        serde_json::to_writer(&mut file, &header)?;
+        file.write_all(b"\n")?;
+        file.write_all(&result.output)?;
+        file.into_inner().map_err(io::IntoInnerError::into_error)?;
+        fs::rename(&temporary, self.entry(key)).inspect_err(|_| {
+            let _ = fs::remove_file(&temporary);
+        })
+    }
+}
+
+#[cfg(test)]
+mod test {
+    use std::fs;
+
+    use super::{content_hash, CachedOutput, DiskCache};
+
+    #[test]
+    fn changed_inputs_are_stale() {
+        let dir = std::env::temp_dir().join(format!("riscv-disk-cache-{}", std::process::id()));
+        let cache = DiskCache::new(&dir).unwrap();
+        let (main, lib, missing) = (dir.join("main.s"), dir.join("lib.s"), dir.join("none.s"));
+        fs::write(&main, ".include \"lib.s\"\n").unwrap();
+        fs::write(&lib, "li a0, 1\n").unwrap();
+
+        let input = |path: &std::path::Path, text: Option<&str>| {
+            (path.to_str().unwrap().to_owned(), text.map(content_hash))
+        };
+        let result = CachedOutput {
+            inputs: vec![
+                input(&main, Some(".include \"lib.s\"\n")),
+                input(&lib, Some("li a0, 1\n")),
+                input(&missing, None),
+            ],
+            written: 1,
+            output: b"first line\nsecond line\n".to_vec(),
+        };
+        let key = DiskCache::key(&main, "text");
+        assert_ne!(key, DiskCache::key(&main, "jsonl"));
+        assert_ne!(key, DiskCache::key(&dir.join(".").join("main.s"), "text"));
+        assert_eq!(cache.get(key), None);
+        cache.insert(key, &result).unwrap();
+        assert_eq!(cache.get(key), Some(result));
+
+        // An include changing is enough, as is one appearing
+        fs::write(&lib, "li a0, 2\n").unwrap();
+        assert_eq!(cache.get(key), None);
+        fs::write(&lib, "li a0, 1\n").unwrap();
+        assert!(cache.get(key).is_some());
+        fs::write(&missing, "").unwrap();
+        assert_eq!(cache.get(key), None);
+
+        fs::remove_dir_all(&dir).unwrap();
+    }
+
+    #[test]
+    fn same_relative_path_in_another_directory_misses() {
+        let dir = std::env::temp_dir().join(format!("riscv-disk-cache-cwd-{}", std::process::id()));
+        let (x, y) = (dir.join("x"), dir.join("y"));
+        fs::create_dir_all(&x).unwrap();
+        fs::create_dir_all(&y).unwrap();
+        fs::write(x.join("a.s"), "li a0, 1\n").unwrap();
+        fs::write(y.join("a.s"), "li a0, 2\n").unwrap();
+        let cache = DiskCache::new(&dir.join("cache")).unwrap();
+
+        // `lint a.s` in x is kept with the canonical path that was read
+        let path = std::path::Path::new("a.s");
+        let read = x.join("a.s").canonicalize().unwrap();
+        let result = CachedOutput {
+            inputs: vec![(
+                read.to_str().unwrap().to_owned(),
+                Some(content_hash("li a0, 1\n")),
+            )],
+            written: 1,
+            output: b"a.s: first\n".to_vec(),
+        };
+        let key = DiskCache::key_from(&x, path, "text");
+        cache.insert(key, &result).unwrap();
+        assert_eq!(cache.get(key), Some(result));
+
+        // `lint a.s` in y is another file, so x's output is not replayed
+        let other = DiskCache::key_from(&y, path, "text");
+        assert_ne!(key, other);
+        assert_eq!(cache.get(other), None);
+
+        fs::remove_dir_all(&dir).unwrap();
+    }
+}
@@ -0,0 +1,112 @@
+use std::collections::HashMap;
+
+use crate::parser::FileId;
+
+/// The files that a reader has read, looked up by id or by path.
+///
+/// Ids are small, so a file is found by its id with a single index into a
+/// table, and by its path with a single hash. Diagnostics look up the path
+/// of their file, and every include looks up its parent, so neither is a
+/// scan over every file.
+#[derive(Clone, Debug, Default)]
+pub struct FileTable {
+    paths: Vec<String>,
+    ids: Vec<FileId>,
+    by_path: HashMap<String, usize>,
+    /// The index of the file with each id, if there is one
+    by_id: Vec<Option<usize>>,
+}
+
+impl FileTable {
+    pub fn new() -> Self {
+        FileTable::default()
+    }
+
+    /// Add a file. Returns false, without adding it, if a file with the
+    /// same path or id was already added.
+    pub fn insert(&mut self, path: String, id: FileId) -> bool {
+        if self.by_path.contains_key(&path) || self.index(id).is_some() {
+            return false;
+        }
+        let index = self.paths.len();
+        if self.by_id.len() <= id.index() {
+            self.by_id.resize(id.index() + 1, None);
+        }
+        self.by_id[id.index()] = Some(index);
+        self.by_path.insert(path.clone(), index);
+        self.paths.push(path);
+        self.ids.push(id);
+        true
+    }
+
+    fn index(&self, id: FileId) -> Option<usize> {
+        self.by_id.get(id.index()).copied().flatten()
+    }
+
+    /// An id that no file has, trying the next one in order first. Returns
+    /// `None` if every id is taken.
+    pub fn unused_id(&self) -> Option<FileId> {
+        let next = self.paths.len();
+        (next..=usize::from(u16::MAX))
+            .chain(0..next)
+            .filter_map(FileId::new)
+            .find(|&x| self.index(x).is_none())
+    }
+
+    pub fn path(&self, id: FileId) -> Option<&str> {
+        self.index(id).map(|x| self.paths[x].as_str())
+    }
+
+    pub fn id(&self, path: &str) -> Option<FileId> {
+        self.by_path.get(path).map(|&x| self.ids[x])
+    }
+
+    pub fn contains_path(&self, path: &str) -> bool {
+        self.by_path.contains_key(path)
+    }
+
+    /// Every file and its path, in the order that they were added.
+    pub fn iter(&self) -> impl Iterator<Item = (FileId, &str)> {
+        self.ids
+            .iter()
+            .copied()
+            .zip(self.paths.iter().map(String::as_str))
+    }
+
+    pub fn len(&self) -> usize {
+        self.paths.len()
+    }
+
+    pub fn is_empty(&self) -> bool {
+        self.paths.is_empty()
+    }
+}
+
+#[cfg(test)]
+mod test {
+    use crate::parser::FileId;
+
+    use super::FileTable;
+
+    fn id(index: usize) -> FileId {
+        FileId::new(index).unwrap()
+    }
+
+    #[test]
+    fn files_are_found_both_ways() {
+        let (a, b) = (id(0), id(7));
+        let mut files = FileTable::new();
+        assert!(files.insert("/a.s".to_owned(), a));
+        assert!(files.insert("/b.s".to_owned(), b));
+        assert!(!files.insert("/a.s".to_owned(), id(3)));
+        assert!(!files.insert("/c.s".to_owned(), b));
+
+        assert_eq!(files.path(b), Some("/b.s"));
+        assert_eq!(files.id("/a.s"), Some(a));
+        assert_eq!(files.path(id(3)), None);
+        assert_eq!(files.path(id(100)), None);
+        assert!(!files.contains_path("/c.s"));
+        assert_eq!(files.len(), 2);
+        assert_eq!(files.unused_id(), Some(id(2)));
+    }
+}
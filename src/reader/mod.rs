@@ -1,8 +1,16 @@
 use std::iter::Peekable;
+use std::sync::Arc;
 
-use uuid::Uuid;
+use crate::parser::{FileId, Lexer, ParsedFile, With};
 
-use crate::parser::{Lexer, With};
+mod cache;
+pub use cache::*;
+
+mod disk;
+pub use disk::*;
+
+mod files;
+pub use files::*;
 
 #[derive(Debug)]
 pub enum FileReaderError {
@@ -17,8 +25,20 @@ pub trait FileReader: Sized {
     fn import_file(
         &mut self,
         path: &str,
-        in_file: Option<uuid::Uuid>,
-    ) -> Result<(Uuid, Peekable<Lexer>), FileReaderError>;
+        in_file: Option<FileId>,
+    ) -> Result<(FileId, Peekable<Lexer>), FileReaderError>;
+
+    fn get_filename(&self, id: FileId) -> Option<String>;
+
+    /// An earlier parse of the file that was just imported with this id, if
+    /// the file has not changed since.
+    ///
+    /// If there is one, the lexer returned by `import_file` is not used.
+    fn cached_parse(&self, _id: FileId) -> Option<Arc<ParsedFile>> {
+        None
+    }
 
-    fn get_filename(&self, uuid: uuid::Uuid) -> Option<String>;
+    /// Called with the parse of every imported file that had no cached
+    /// parse, so that the reader can keep it for later.
+    fn store_parse(&mut self, _parsed: &Arc<ParsedFile>) {}
 }
@@ -0,0 +1,611 @@
+// LANGUAGE SERVER
+// ===============
+
+use std::collections::{BTreeSet, HashMap, VecDeque};
+use std::io::{self, BufRead, Write};
+use std::sync::atomic::{AtomicBool, Ordering};
+use std::sync::mpsc::{Receiver, RecvTimeoutError, Sender};
+use std::sync::{Arc, Condvar, Mutex};
+use std::time::{Duration, Instant};
+
+use lsp_types::{Diagnostic, Range};
+use serde::Deserialize;
+use serde_json::{json, Value};
+
+use crate::lsp::Session;
+
+/// How the server schedules its work.
+#[derive(Clone, Copy, Debug)]
+pub struct Options {
+    /// The number of threads that analyse documents
+    pub jobs: usize,
+    /// How long the documents have to stay the same before they are
+    /// analysed
+    pub debounce: Duration,
+}
+
+/// Something for the server to handle, from the editor or from a worker.
+pub enum Event {
+    Message(Value),
+    Analysed(Analysed),
+    /// The editor closed its end of the connection
+    End,
+}
+
+/// The diagnostics of the documents that a root read, from a worker.
+pub struct Analysed {
+    root: String,
+    cancelled: Arc<AtomicBool>,
+    diagnostics: Vec<(String, Vec<Diagnostic>)>,
+}
+
+/// The text of every open document, with a version that changes whenever
+/// the text does.
+type Documents = HashMap<String, (u64, Arc<str>)>;
+
+/// A root document to analyse with the documents as they were when it was
+/// asked for.
+struct Task {
+    root: String,
+    documents: Arc<Documents>,
+    /// Set once a newer edit makes the result useless
+    cancelled: Arc<AtomicBool>,
+}
+
+/// The tasks waiting for a worker, with the most urgent at the front.
+#[derive(Default)]
+struct Queue {
+    /// The tasks, and whether the queue was closed
+    state: Mutex<(VecDeque<Task>, bool)>,
+    ready: Condvar,
+}
+
+impl Queue {
+    fn push_front(&self, task: Task) {
+        if let Ok(mut state) = self.state.lock() {
+            state.0.push_front(task);
+            self.ready.notify_one();
+        }
+    }
+
+    /// Wait for the next task. Returns `None` once the queue is closed.
+    fn pop(&self) -> Option<Task> {
+        let mut state = self.state.lock().ok()?;
+        loop {
+            if state.1 {
+                return None;
+            }
+            if let Some(task) = state.0.pop_front() {
+                return Some(task);
+            }
+            state = self.ready.wait(state).ok()?;
+        }
+    }
+
+    fn close(&self) {
+        if let Ok(mut state) = self.state.lock() {
+            state.1 = true;
+            self.ready.notify_all();
+        }
+    }
+}
+
+/// Analyse tasks until the queue is closed.
+///
+/// Each worker keeps a session of its own, so the lines and parses of the
+/// documents it analysed before are reused for as long as they are the
+/// same.
+fn work(queue: &Queue, events: &Sender<Event>) {
+    let mut session = Session::new();
+    let mut versions = HashMap::<String, u64>::new();
+    while let Some(task) = queue.pop() {
+        if task.cancelled.load(Ordering::Relaxed) {
+            continue;
+        }
+        versions.retain(|uri, _| {
+            let open = task.documents.contains_key(uri);
+            if !open {
+                session.close(uri);
+            }
+            open
+        });
+        for (uri, (version, text)) in task.documents.iter() {
+            if versions.insert(uri.clone(), *version) != Some(*version) {
+                session.open(uri, text);
+            }
+        }
+
+        let cancelled = || task.cancelled.load(Ordering::Relaxed);
+        if let Some(diagnostics) = session.analyse_root(&task.root, cancelled) {
+            let analysed = Analysed {
+                root: task.root,
+                cancelled: task.cancelled,
+                diagnostics,
+            };
+            if events.send(Event::Analysed(analysed)).is_err() {
+                return;
+            }
+        }
+    }
+}
+
+/// Read one message, which is a `Content-Length` header and a JSON body.
+/// Returns `None` at the end of the input.
+pub fn read_message(input: &mut impl BufRead) -> io::Result<Option<Value>> {
+    let mut length = None;
+    loop {
+        let mut line = String::new();
+        if input.read_line(&mut line)? == 0 {
+            return Ok(None);
+        }
+        let line = line.trim_end();
+        if line.is_empty() && length.is_some() {
+            break;
+        }
+        if let Some((name, value)) = line.split_once(':') {
+            if name.eq_ignore_ascii_case("content-length") {
+                length = value.trim().parse::<usize>().ok();
+            }
+        }
+    }
+    let mut body = vec![0; length.unwrap_or_default()];
+    input.read_exact(&mut body)?;
+    Ok(Some(serde_json::from_slice(&body)?))
+}
+
+pub fn write_message(out: &mut impl Write, message: &Value) -> io::Result<()> {
+    let body = serde_json::to_vec(message)?;
+    write!(out, "Content-Length: {}\r\n\r\n", body.len())?;
+    out.write_all(&body)?;
+    out.flush()
+}
+
+/// Send every message in `input` to the server, until it ends.
+fn read_messages(mut input: impl BufRead, events: &Sender<Event>) {
+    loop {
+        let event = match read_message(&mut input) {
+            Ok(Some(message)) => Event::Message(message),
+            // A body that is not JSON still has the length it said it had,
+            // so the messages after it can be read
+            Err(err) if err.kind() == io::ErrorKind::InvalidData => {
+                eprintln!("Unable to read message: {err}");
+                continue;
+            }
+            Ok(None) | Err(_) => Event::End,
+        };
+        let end = matches!(event, Event::End);
+        if events.send(event).is_err() || end {
+            return;
+        }
+    }
+}
+
+#[derive(Deserialize)]
+struct TextDocument {
+    uri: String,
+    #[serde(default)]
+    text: String,
+}
+
+/// A change to the text of a document, in the form of an LSP
+/// `TextDocumentContentChangeEvent`.
+#[derive(Deserialize)]
+struct Change {
+    range: Option<Range>,
+    text: String,
+}
+
+/// The parameters of `didOpen`, `didChange` and `didClose`.
+#[derive(Deserialize)]
+#[serde(rename_all = "camelCase")]
+struct DocumentParams {
+    text_document: TextDocument,
+    #[serde(default)]
+    content_changes: Vec<Change>,
+}
+
+/// The state of the server, which runs on a single thread and hands the
+/// analysis to the workers.
+///
+/// Edits are applied as they arrive, but nothing is analysed until no edit
+/// has arrived for the debounce time. Then every root document that read an
+/// edited document is queued, the most recently edited first, and the
+/// tasks that were queued or running for those roots are cancelled.
+struct Server<'a, W: Write> {
+    out: W,
+    queue: &'a Queue,
+    debounce: Duration,
+    /// The documents, which the edits are applied to, and which know the
+    /// includes of each document
+    session: Session,
+    documents: Documents,
+    /// The documents that changed since they were last analysed, with the
+    /// time of their last change
+    dirty: HashMap<String, u64>,
+    clock: u64,
+    /// When the dirty documents are analysed, if there are any
+    deadline: Option<Instant>,
+    /// The diagnostics from the last analysis of each root
+    results: HashMap<String, Vec<(String, Vec<Diagnostic>)>>,
+    /// The task that is queued or running for each root
+    pending: HashMap<String, Arc<AtomicBool>>,
+}
+
+impl<'a, W: Write> Server<'a, W> {
+    fn new(out: W, queue: &'a Queue, debounce: Duration) -> Self {
+        Server {
+            out,
+            queue,
+            debounce,
+            session: Session::new(),
+            documents: HashMap::new(),
+            dirty: HashMap::new(),
+            clock: 0,
+            deadline: None,
+            results: HashMap::new(),
+            pending: HashMap::new(),
+        }
+    }
+
+    fn run(&mut self, events: &Receiver<Event>) -> io::Result<()> {
+        loop {
+            let event = match self.deadline {
+                Some(deadline) => {
+                    match events.recv_timeout(deadline.saturating_duration_since(Instant::now())) {
+                        Ok(event) => event,
+                        Err(RecvTimeoutError::Timeout) => {
+                            self.schedule()?;
+                            continue;
+                        }
+                        Err(RecvTimeoutError::Disconnected) => return Ok(()),
+                    }
+                }
+                None => match events.recv() {
+                    Ok(event) => event,
+                    Err(_) => return Ok(()),
+                },
+            };
+            match event {
+                Event::Message(message) => {
+                    if self.handle(&message)? {
+                        return Ok(());
+                    }
+                }
+                Event::Analysed(analysed) => self.finish(analysed)?,
+                Event::End => return Ok(()),
+            }
+        }
+    }
+
+    /// Handle a message from the editor. Returns true once it asks the
+    /// server to exit.
+    fn handle(&mut self, message: &Value) -> io::Result<bool> {
+        let method = message["method"].as_str().unwrap_or_default();
+        let params = || DocumentParams::deserialize(&message["params"]).ok();
+        match (method, message.get("id")) {
+            ("initialize", Some(id)) => self.respond(
+                id,
+                &json!({
+                    "capabilities": {
+                        // Changes are sent as ranges
+                        "textDocumentSync": { "openClose": true, "change": 2 },
+                    },
+                    "serverInfo": {
+                        "name": env!("CARGO_PKG_NAME"),
+                        "version": env!("CARGO_PKG_VERSION"),
+                    },
+                }),
+            )?,
+            ("shutdown", Some(id)) => self.respond(id, &Value::Null)?,
+            ("exit", _) => return Ok(true),
+            ("textDocument/didOpen", None) => {
+                if let Some(params) = params() {
+                    let doc = params.text_document;
+                    self.session.open(&doc.uri, &doc.text);
+                    self.touch(doc.uri);
+                }
+            }
+            ("textDocument/didChange", None) => {
+                if let Some(params) = params() {
+                    let uri = params.text_document.uri;
+                    for change in params.content_changes {
+                        self.session.change(&uri, change.range, &change.text);
+                    }
+                    self.touch(uri);
+                }
+            }
+            ("textDocument/didClose", None) => {
+                if let Some(params) = params() {
+                    let uri = params.text_document.uri;
+                    self.session.close(&uri);
+                    self.documents.remove(&uri);
+                    self.publish(&uri, &[])?;
+                    self.touch(uri);
+                }
+            }
+            (_, Some(id)) => write_message(
+                &mut self.out,
+                &json!({
+                    "jsonrpc": "2.0",
+                    "id": id,
+                    "error": { "code": -32601, "message": format!("Unknown method {method}") },
+                }),
+            )?,
+            _ => {}
+        }
+        Ok(false)
+    }
+
+    fn respond(&mut self, id: &Value, result: &Value) -> io::Result<()> {
+        write_message(
+            &mut self.out,
+            &json!({ "jsonrpc": "2.0", "id": id, "result": result }),
+        )
+    }
+
+    fn publish(&mut self, uri: &str, diagnostics: &[Diagnostic]) -> io::Result<()> {
+        write_message(
+            &mut self.out,
+            &json!({
+                "jsonrpc": "2.0",
+                "method": "textDocument/publishDiagnostics",
+                "params": { "uri": uri, "diagnostics": diagnostics },
+            }),
+        )
+    }
+
+    /// Record that a document changed, and wait for the debounce time
+    /// before analysing it.
+    fn touch(&mut self, uri: String) {
+        self.clock += 1;
+        self.dirty.insert(uri, self.clock);
+        self.deadline = Some(Instant::now() + self.debounce);
+    }
+
+    /// Queue every root that read a dirty document, or that was never
+    /// analysed.
+    fn schedule(&mut self) -> io::Result<()> {
+        self.deadline = None;
+        let dirty = std::mem::take(&mut self.dirty);
+        for (uri, &version) in &dirty {
+            if let Some(text) = self.session.text(uri) {
+                self.documents
+                    .insert(uri.clone(), (version, Arc::from(text)));
+            }
+        }
+
+        // Documents that stopped being roots are analysed by whatever
+        // includes them now
+        let roots = self.session.roots();
+        let mut stale = BTreeSet::new();
+        self.pending.retain(|root, cancelled| {
+            let keep = roots.contains(root);
+            if !keep {
+                cancelled.store(true, Ordering::Relaxed);
+            }
+            keep
+        });
+        self.results.retain(|root, diagnostics| {
+            let keep = roots.contains(root);
+            if !keep {
+                stale.extend(diagnostics.iter().map(|x| x.0.clone()));
+            }
+            keep
+        });
+
+        let mut queued = roots
+            .into_iter()
+            .filter_map(|root| {
+                let last = match self.results.get(&root) {
+                    Some(read) => read.iter().filter_map(|x| dirty.get(&x.0)).max(),
+                    None => Some(dirty.get(&root).unwrap_or(&0)),
+                };
+                last.map(|&x| (x, root))
+            })
+            .collect::<Vec<_>>();
+        queued.sort_unstable();
+        let documents = Arc::new(self.documents.clone());
+        for (_, root) in queued {
+            let cancelled = Arc::new(AtomicBool::new(false));
+            if let Some(old) = self.pending.insert(root.clone(), Arc::clone(&cancelled)) {
+                old.store(true, Ordering::Relaxed);
+            }
+            self.queue.push_front(Task {
+                root,
+                documents: Arc::clone(&documents),
+                cancelled,
+            });
+        }
+        self.republish(stale)
+    }
+
+    /// Keep the diagnostics of a root, and publish every document that
+    /// they changed.
+    fn finish(&mut self, analysed: Analysed) -> io::Result<()> {
+        if analysed.cancelled.load(Ordering::Relaxed) {
+            return Ok(());
+        }
+        self.pending.remove(&analysed.root);
+        let mut changed = analysed
+            .diagnostics
+            .iter()
+            .map(|x| x.0.clone())
+            .collect::<BTreeSet<_>>();
+        let old = self.results.insert(analysed.root, analysed.diagnostics);
+        changed.extend(old.into_iter().flatten().map(|x| x.0));
+        self.republish(changed)
+    }
+
+    /// Publish the diagnostics of every open document in `uris`, from the
+    /// last analysis of each root that read it.
+    fn republish(&mut self, uris: BTreeSet<String>) -> io::Result<()> {
+        let mut roots = self.results.keys().collect::<Vec<_>>();
+        roots.sort_unstable();
+        let updates = uris
+            .into_iter()
+            .filter(|x| self.documents.contains_key(x))
+            .map(|uri| {
+                let diagnostics = roots
+                    .iter()
+                    .flat_map(|x| &self.results[*x])
+                    .filter(|x| x.0 == uri)
+                    .flat_map(|x| x.1.iter().cloned())
+                    .collect::<Vec<_>>();
+                (uri, diagnostics)
+            })
+            .collect::<Vec<_>>();
+        for (uri, diagnostics) in updates {
+            self.publish(&uri, &diagnostics)?;
+        }
+        Ok(())
+    }
+}
+
+/// Run the server until the editor asks it to exit, reading events from
+/// `events`. Workers send their results through `sender`.
+pub fn serve<W: Write>(
+    events: &Receiver<Event>,
+    sender: &Sender<Event>,
+    out: W,
+    options: Options,
+) -> io::Result<()> {
+    let queue = Queue::default();
+    std::thread::scope(|scope| {
+        for _ in 0..options.jobs.max(1) {
+            let sender = sender.clone();
+            let queue = &queue;
+            scope.spawn(move || work(queue, &sender));
+        }
+        let mut server = Server::new(out, &queue, options.debounce);
+        let res = server.run(events);
+        for cancelled in server.pending.values() {
+            cancelled.store(true, Ordering::Relaxed);
+        }
+        queue.close();
+        res
+    })
+}
+
+/// Speak LSP over stdin and stdout until the editor asks the server to
+/// exit.
+pub fn serve_stdio(options: Options) -> io::Result<()> {
+    let (sender, events) = std::sync::mpsc::channel();
+    let reader = sender.clone();
+    // The reader is left waiting on stdin when the server exits, which
+    // ends with the process
+    std::thread::spawn(move || read_messages(io::stdin().lock(), &reader));
+    serve(&events, &sender, io::stdout().lock(), options)
+}
+
+#[cfg(test)]
+mod test {
+    use std::io::{self, Cursor, Write};
+    use std::sync::mpsc::{self, Receiver, Sender};
+    use std::time::Duration;
+
+    use serde_json::{json, Value};
+
+    use super::{read_message, serve, write_message, Event, Options};
+
+    /// Sends each message that the server writes to the test.
+    struct Messages(Vec<u8>, Sender<Value>);
+
+    impl Write for Messages {
+        fn write(&mut self, buf: &[u8]) -> io::Result<usize> {
+            self.0.extend_from_slice(buf);
+            Ok(buf.len())
+        }
+
+        fn flush(&mut self) -> io::Result<()> {
+            let mut input = Cursor::new(std::mem::take(&mut self.0));
+            while let Some(message) = read_message(&mut input)? {
+                let _ = self.1.send(message);
+            }
+            Ok(())
+        }
+    }
+
+    fn published(written: &Receiver<Value>, uri: &str) -> Vec<Value> {
+        loop {
+            let message = written.recv_timeout(Duration::from_secs(10)).unwrap();
+            if message["method"] == "textDocument/publishDiagnostics"
+                && message["params"]["uri"] == uri
+            {
+                return message["params"]["diagnostics"].as_array().unwrap().clone();
+            }
+        }
+    }
+
+    #[test]
+    fn messages_are_framed() {
+        let mut out = Vec::new();
+        write_message(&mut out, &json!({ "id": 1 })).unwrap();
+        write_message(&mut out, &json!({ "id": "two" })).unwrap();
+        assert!(out.starts_with(b"Content-Length: 8\r\n\r\n{\"id\":1}"));
+        let mut input = Cursor::new(out);
+        assert_eq!(read_message(&mut input).unwrap(), Some(json!({ "id": 1 })));
+        assert_eq!(
+            read_message(&mut input).unwrap(),
+            Some(json!({ "id": "two" }))
+        );
+        assert_eq!(read_message(&mut input).unwrap(), None);
+    }
+
+    #[test]
+    fn edits_are_published() {
+        let (sender, events) = mpsc::channel();
+        let (output, written) = mpsc::channel();
+        let server = {
+            let sender = sender.clone();
+            std::thread::spawn(move || {
+                let options = Options {
+                    jobs: 2,
+                    debounce: Duration::from_millis(1),
+                };
+                serve(&events, &sender, Messages(Vec::new(), output), options)
+            })
+        };
+        let send = |message: Value| sender.send(Event::Message(message)).unwrap();
+
+        send(json!({ "jsonrpc": "2.0", "id": 1, "method": "initialize", "params": {} }));
+        let init = written.recv().unwrap();
+        assert_eq!(init["id"], 1);
+        assert_eq!(
+            init["result"]["capabilities"]["textDocumentSync"]["change"],
+            2
+        );
+
+        let uri = "file:///main.s";
+        send(json!({
+            "jsonrpc": "2.0",
+            "method": "textDocument/didOpen",
+            "params": { "textDocument": {
+                "uri": uri,
+                "languageId": "riscv",
+                "version": 1,
+                "text": "main:\n  li zero, 1\n  li a7, 10\n  ecall\n",
+            } },
+        }));
+        assert_eq!(published(&written, uri).len(), 2);
+
+        send(json!({
+            "jsonrpc": "2.0",
+            "method": "textDocument/didChange",
+            "params": {
+                "textDocument": { "uri": uri, "version": 2 },
+                "contentChanges": [{
+                    "range": {
+                        "start": { "line": 1, "character": 5 },
+                        "end": { "line": 1, "character": 9 },
+                    },
+                    "text": "a0",
+                }],
+            },
+        }));
+        assert_eq!(published(&written, uri).len(), 1);
+
+        send(json!({ "jsonrpc": "2.0", "id": 2, "method": "shutdown" }));
+        send(json!({ "jsonrpc": "2.0", "method": "exit" }));
+        server.join().unwrap().unwrap();
+    }
+}